@@ -0,0 +1,187 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sched.h>
+#include <algorithm>
+
+#include "cpu.hpp"
+#include "bench.hpp"
+#include "tsc_clock.hpp"
+
+namespace cube {
+    namespace {
+        /**
+         * \brief Smallest delta between two back-to-back ticks_serialized() calls, the pair that brackets a sample
+         *      Taken on the CPU the samples run on; the best of many pairs, interrupts only ever add time
+         */
+        auto serialized_overhead() -> std::uint64_t {
+            std::uint64_t best = std::numeric_limits<std::uint64_t>::max();
+            for (std::size_t i = 0x0; i < 0x400; ++i) {
+                std::uint64_t start = tsc_clock::ticks_serialized();
+                std::uint64_t end = tsc_clock::ticks_serialized();
+                best = std::min(best, end - start);
+            }
+            return best;
+        }
+    }
+
+    /**
+     * \brief Function-local registry, so registration from static initializers is order-safe
+     * @return all registered benchmarks in registration order
+     */
+    auto bench::registry() -> std::vector<bench::entry> & {
+        static std::vector<bench::entry> entries;
+        return entries;
+    }
+
+    /**
+     * \brief Registers a benchmark, normally through CUBE_BENCHMARK()
+     * @param name Unique name, used by the filter
+     * @param body Function timed once per sample
+     * @param batch Iterations the function performs per call
+     * @return always true, so it can initialize a static
+     */
+    auto bench::add(std::string name, bench::function body, std::size_t batch) -> bool {
+        bench::registry().push_back({ std::move(name), std::move(body), std::max<std::size_t>(batch, 0x1) });
+        return true;
+    }
+
+    /**
+     * \brief Names of all registered benchmarks
+     * @return names in registration order
+     */
+    auto bench::names() -> std::vector<std::string> {
+        std::vector<std::string> result;
+        for (bench::entry const & e : bench::registry()) result.push_back(e.name);
+        return result;
+    }
+
+    /**
+     * \brief Pins the calling thread to one logical CPU
+     * @param cpu Logical CPU number
+     * @return false when the affinity could not be set
+     */
+    auto bench::pin(int cpu) -> bool {
+        return cpu::pin_thread(cpu);
+    }
+
+    /**
+     * \brief Times one benchmark
+     *      The minimum delta of two back-to-back ticks_serialized() calls, the same pair that brackets every
+     *      sample, is subtracted from every sample as timer overhead before the per-iteration time is computed
+     * @param name Name for the report
+     * @param body Function under test
+     * @param batch Iterations per call
+     * @param options Warmup and sample counts
+     * @return distribution of the per-iteration latency
+     */
+    auto bench::run_one(std::string const & name, bench::function const & body, std::size_t batch,
+                        bench_options const & options) -> bench_result {
+        std::vector<double> samples(std::max<std::size_t>(options.samples, 0x1));
+
+        for (std::size_t i = 0x0; i < options.warmup; ++i) body();
+        std::uint64_t const overhead = serialized_overhead();
+
+        for (double & sample : samples) {
+            std::uint64_t start = tsc_clock::ticks_serialized();
+            body();
+            std::uint64_t end = tsc_clock::ticks_serialized();
+
+            std::uint64_t elapsed = end - start;
+            elapsed = (elapsed > overhead) ? elapsed - overhead : 0x0;
+            sample = static_cast<double>(tsc_clock::to_duration(elapsed).count()) / static_cast<double>(batch);
+        }
+
+        bench_result result;
+        result.name = name;
+        result.batch = batch;
+        result.samples = samples.size();
+        result.overhead = static_cast<double>(tsc_clock::to_duration(overhead).count());
+
+        for (double sample : samples) {
+            result.mean += sample;
+            std::size_t bucket = (sample < 1.0) ? 0x0 : static_cast<std::size_t>(std::log2(sample));
+            ++result.histogram[std::min(bucket, result.histogram.size() - 0x1)];
+        }
+        result.mean /= static_cast<double>(samples.size());
+
+        std::sort(samples.begin(), samples.end());
+        result.min = samples.front();
+        result.median = samples[samples.size() / 0x2];
+        result.p99 = samples[std::min(samples.size() - 0x1, samples.size() * 0x63 / 0x64)];
+        result.max = samples.back();
+        return result;
+    }
+
+    /**
+     * \brief Runs every registered benchmark whose name contains options.filter
+     *      The thread is pinned to options.cpu, or to the CPU it currently runs on
+     * @param options Runner configuration
+     * @return one result per benchmark that ran
+     */
+    auto bench::run(bench_options const & options) -> std::vector<bench_result> {
+        bench::pin(options.cpu >= 0x0 ? options.cpu : sched_getcpu());
+
+        std::vector<bench_result> results;
+        for (bench::entry const & e : bench::registry()) {
+            if (!options.filter.empty() && e.name.find(options.filter) == std::string::npos) continue;
+            results.push_back(bench::run_one(e.name, e.body, e.batch, options));
+        }
+        return results;
+    }
+
+    /**
+     * \brief Prints a summary table followed by the histogram of every benchmark
+     * @param results Output of run()
+     */
+    auto bench::print_table(std::vector<bench_result> const & results) -> void {
+        std::printf("%-32s %9s %10s %10s %10s %10s %10s\n",
+                    "benchmark", "samples", "min ns", "median ns", "p99 ns", "max ns", "mean ns");
+
+        for (bench_result const & r : results) {
+            std::printf("%-32s %9zu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                        r.name.c_str(), r.samples, r.min, r.median, r.p99, r.max, r.mean);
+        }
+
+        for (bench_result const & r : results) {
+            std::uint64_t peak = *std::max_element(r.histogram.begin(), r.histogram.end());
+            std::printf("\n%s (timer overhead %.1f ns subtracted)\n", r.name.c_str(), r.overhead);
+
+            for (std::size_t i = 0x0; i < r.histogram.size(); ++i) {
+                if (r.histogram[i] == 0x0) continue;
+                int width = static_cast<int>(0x32 * r.histogram[i] / peak);
+                std::printf("  [%10llu ns, %10llu ns) %9llu %.*s\n",
+                            i ? 1ULL << i : 0ULL, 1ULL << (i + 0x1),
+                            static_cast<unsigned long long>(r.histogram[i]),
+                            std::max(width, 0x1), "##################################################");
+            }
+        }
+    }
+
+    /**
+     * \brief Prints the results as one JSON document on stdout
+     * @param results Output of run()
+     */
+    auto bench::print_json(std::vector<bench_result> const & results) -> void {
+        std::printf("{\"benchmarks\":[");
+
+        for (std::size_t i = 0x0; i < results.size(); ++i) {
+            bench_result const & r = results[i];
+            std::printf("%s{\"name\":\"%s\",\"samples\":%zu,\"batch\":%zu,\"overhead_ns\":%.3f,"
+                        "\"min_ns\":%.3f,\"median_ns\":%.3f,\"p99_ns\":%.3f,\"max_ns\":%.3f,\"mean_ns\":%.3f,"
+                        "\"histogram_log2_ns\":[",
+                        i ? "," : "", r.name.c_str(), r.samples, r.batch, r.overhead,
+                        r.min, r.median, r.p99, r.max, r.mean);
+            for (std::size_t b = 0x0; b < r.histogram.size(); ++b) {
+                std::printf("%s%llu", b ? "," : "", static_cast<unsigned long long>(r.histogram[b]));
+            }
+            std::printf("]}");
+        }
+        std::printf("]}\n");
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_BENCH_HPP
+#define CUBE_BENCH_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace cube {
+    struct bench_options {
+        std::size_t warmup { 0x3E8 };
+        std::size_t samples { 0x2710 };
+        int cpu { -0x1 };
+        std::string filter;
+        bool json { false };
+    };
+
+    /**
+     * \brief Latency distribution of one benchmark, all times in nanoseconds per iteration
+     *      histogram[i] counts samples in [2^i, 2^(i+1)) ns, bucket 0x0 also holds everything below 1 ns
+     */
+    struct bench_result {
+        std::string name;
+        std::size_t samples { 0x0 };
+        std::size_t batch { 0x1 };
+        double overhead { 0.0 };
+        double min { 0.0 };
+        double median { 0.0 };
+        double p99 { 0.0 };
+        double max { 0.0 };
+        double mean { 0.0 };
+        std::array<std::uint64_t, 0x20> histogram { };
+    };
+
+    /**
+     * \brief Registry and runner for named microbenchmarks
+     *      One sample is one call of the registered function, timed with the TSC.
+     *      A function may run "batch" iterations per call, results are reported per iteration
+     */
+    class bench {
+    public:
+        using function = std::function<void()>;
+
+        static auto add(std::string name, function body, std::size_t batch = 0x1) -> bool;
+        static auto names() -> std::vector<std::string>;
+        static auto run(bench_options const & options) -> std::vector<bench_result>;
+        static auto run_one(std::string const & name, function const & body, std::size_t batch,
+                            bench_options const & options) -> bench_result;
+        static auto pin(int cpu) -> bool;
+        static auto print_table(std::vector<bench_result> const & results) -> void;
+        static auto print_json(std::vector<bench_result> const & results) -> void;
+
+    private:
+        struct entry {
+            std::string name;
+            function body;
+            std::size_t batch;
+        };
+
+        static auto registry() -> std::vector<entry> &;
+    };
+
+    /**
+     * \brief Keeps the compiler from discarding a value computed inside a benchmark
+     */
+    template <typename T>
+    inline auto do_not_optimize(T const & value) -> void {
+        __asm__ __volatile__ ("" : : "r,m" (value) : "memory");
+    }
+}
+
+#define CUBE_BENCHMARK_BATCH(name, batch)                                                   \
+    static auto name() -> void;                                                            \
+    [[maybe_unused]] static bool const name##_registered = cube::bench::add(#name, name, batch); \
+    static auto name() -> void
+
+#define CUBE_BENCHMARK(name) CUBE_BENCHMARK_BATCH(name, 0x1)
+
+#endif //CUBE_BENCH_HPP
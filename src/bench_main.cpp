@@ -0,0 +1,51 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "bench.hpp"
+#include "dispatch.hpp"
+
+/**
+ * \brief Prints the command line help of cube_bench
+ */
+static auto usage() -> void {
+    std::printf("Usage: cube_bench [--list] [--filter TEXT] [--cpu N] [--samples N] [--warmup N] [--json]\n");
+}
+
+auto main(int argc, const char* argv[]) -> int {
+    cube::bench_options options;
+
+    for (int i = 0x1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        char const * value = (i + 0x1 < argc) ? argv[i + 0x1] : nullptr;
+
+        if (arg == "--list") {
+            for (std::string const & name : cube::bench::names()) std::printf("%s\n", name.c_str());
+            return 0x0;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--filter" && value) {
+            options.filter = argv[++i];
+        } else if (arg == "--cpu" && value) {
+            options.cpu = std::atoi(argv[++i]);
+        } else if (arg == "--samples" && value) {
+            options.samples = std::strtoull(argv[++i], nullptr, 0xA);
+        } else if (arg == "--warmup" && value) {
+            options.warmup = std::strtoull(argv[++i], nullptr, 0xA);
+        } else {
+            usage();
+            return 0x1;
+        }
+    }
+
+    cube::isa::initialize();
+    std::vector<cube::bench_result> results = cube::bench::run(options);
+    if (options.json) cube::bench::print_json(results);
+    else cube::bench::print_table(results);
+    return 0x0;
+}
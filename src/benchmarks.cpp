@@ -0,0 +1,157 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include "cpu.hpp"
+#include "bench.hpp"
+#include "clocks.hpp"
+#include "kernels.hpp"
+#include "procfs.hpp"
+#include "process.hpp"
+#include "sampler.hpp"
+#include "thermal.hpp"
+#include "tsc_clock.hpp"
+
+/*  ------------------------------------  /proc/stat parsing  ------------------------------------  */
+
+/**
+ * \brief Parses every "cpu" line of "/proc/stat" the way cpu_percentage() used to:
+ *      a fresh std::ifstream, a std::string per line and a std::istringstream per line
+ */
+CUBE_BENCHMARK(procfs_stat_istringstream) {
+    std::ifstream stat_file(CPU_STAT);
+    std::uint64_t checksum = 0x0;
+
+    for (std::string line; std::getline(stat_file, line); ) {
+        if (line.compare(0x0, 0x3, "cpu") != 0x0) break;
+        std::istringstream iss(line);
+        std::string token;
+        iss >> token;
+
+        ll user = 0x0, nice = 0x0, system = 0x0, idle = 0x0, iowait = 0x0, irq = 0x0,
+                softirq = 0x0, steal = 0x0, guest = 0x0, guest_nice = 0x0;
+        iss >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal >> guest >> guest_nice;
+        checksum += user + nice + system + idle + iowait + irq + softirq + steal + guest + guest_nice;
+    }
+    cube::do_not_optimize(checksum);
+}
+
+/**
+ * \brief Parses the same lines through a persistent proc_file and proc_scanner
+ */
+CUBE_BENCHMARK(procfs_stat_scanner) {
+    static proc_file stat_file(CPU_STAT, 0x4000);
+    std::uint64_t checksum = 0x0;
+
+    for (proc_scanner scanner(stat_file.read()); scanner.starts_with("cpu"); scanner.next_line()) {
+        scanner.next_word();
+        for (std::size_t field = 0x0; field < 0xA; ++field) checksum += scanner.next_u64();
+    }
+    cube::do_not_optimize(checksum);
+}
+
+/*  ------------------------------------  Collectors  ------------------------------------  */
+
+/**
+ * \brief Copies the newest sampler frame, the cost every TUI frame pays for CPU usage
+ */
+CUBE_BENCHMARK(sampler_frame) {
+    static std::vector<float> frame = [] {
+        sampler::start();
+        return std::vector<float>(sampler::cpus() + 0x1);
+    }();
+    sampler::frame(frame.data(), frame.size());
+    cube::do_not_optimize(frame.front());
+}
+
+/**
+ * \brief Re-reads every cached temperature input
+ */
+CUBE_BENCHMARK(thermal_refresh) {
+    static bool available = thermal::init();
+    if (available) cube::do_not_optimize(thermal::refresh());
+}
+
+/**
+ * \brief One incremental pass of the process table followed by a top-20 selection, the per-second cost of a process view
+ */
+CUBE_BENCHMARK(process_table_refresh) {
+    static process_table table;
+    cube::do_not_optimize(table.refresh());
+    cube::do_not_optimize(table.top(0x14, process_order::cpu).size());
+}
+
+/*  ------------------------------------  Clocks  ------------------------------------  */
+
+CUBE_BENCHMARK_BATCH(tsc_clock_now, 0x64) {
+    for (std::size_t i = 0x0; i < 0x64; ++i) cube::do_not_optimize(cube::tsc_clock::now());
+}
+
+CUBE_BENCHMARK_BATCH(tsc_clock_now_unserialized, 0x64) {
+    for (std::size_t i = 0x0; i < 0x64; ++i) cube::do_not_optimize(cube::tsc_clock::now_unserialized());
+}
+
+CUBE_BENCHMARK_BATCH(steady_clock_now, 0x64) {
+    for (std::size_t i = 0x0; i < 0x64; ++i) cube::do_not_optimize(std::chrono::steady_clock::now());
+}
+
+/**
+ * \brief Every reader of the clocks suite as "clock_<label>", through its function pointer
+ */
+[[maybe_unused]] static bool const clocks_registered = [] {
+    for (clock_source const & source : clocks::sources()) {
+        cube::bench::add(std::string("clock_") + source.label, [read = source.read] {
+            for (std::size_t i = 0x0; i < 0x64; ++i) cube::do_not_optimize(read());
+        }, 0x64);
+    }
+    return true;
+}();
+
+/*  ------------------------------------  Dispatched kernels  ------------------------------------  */
+
+/**
+ * \brief Registers one benchmark per variant of a dispatched kernel that this CPU can run,
+ *      named "kernel_<name>/<level>", each on a 16 KiB input (CUBE_ISA caps which variants are registered)
+ * @param target Kernel whose variants are compared
+ * @param call Runs one variant on the shared input
+ * @return always true, so it can initialize a static
+ */
+template <typename Kernel, typename Call>
+static auto add_variants(Kernel & target, Call call) -> bool {
+    for (auto const & variant : target.variants()) {
+        if (variant.level > cube::isa::current()) continue;
+        std::string name = std::string("kernel_") + target.name() + "/" + std::string(cube::isa::name(variant.level));
+        cube::bench::add(name, [body = variant.body, call] { call(body); });
+    }
+    return true;
+}
+
+/**
+ * \brief 16 KiB of pseudo random words without any 0xFF byte, so find_byte scans all of it
+ */
+static auto kernel_input() -> std::vector<std::uint32_t> const & {
+    static std::vector<std::uint32_t> const input = [] {
+        std::vector<std::uint32_t> values(0x1000);
+        for (std::uint32_t i = 0x0; i < values.size(); ++i) values[i] = (i * 0x9E3779B1) & 0x7F7F7F7F;
+        return values;
+    }();
+    return input;
+}
+
+[[maybe_unused]] static bool const checksum_registered = add_variants(cube::reference_kernels::checksum(), [](auto body) {
+    cube::do_not_optimize(body(kernel_input().data(), kernel_input().size() * sizeof(std::uint32_t)));
+});
+
+[[maybe_unused]] static bool const find_byte_registered = add_variants(cube::reference_kernels::find_byte(), [](auto body) {
+    cube::do_not_optimize(body(kernel_input().data(), kernel_input().size() * sizeof(std::uint32_t), 0xFF));
+});
+
+[[maybe_unused]] static bool const sum_registered = add_variants(cube::reference_kernels::sum(), [](auto body) {
+    cube::do_not_optimize(body(kernel_input().data(), kernel_input().size()));
+});
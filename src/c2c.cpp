@@ -0,0 +1,223 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <set>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <sched.h>
+#include <algorithm>
+
+#include "c2c.hpp"
+#include "cpu.hpp"
+#include "cache.hpp"
+#include "tsc_clock.hpp"
+
+/**
+ * \brief The bounced line, alone in its cache line so nothing else shares the traffic
+ */
+struct alignas(0x40) c2c_line {
+    std::atomic<std::uint64_t> value { 0x0 };
+    char padding[0x40 - sizeof(std::atomic<std::uint64_t>)];
+};
+
+/**
+ * \brief Bounces a cache line between two CPUs
+ *      The first thread writes an odd value and spins until the second answers with the next even one,
+ *      so every round trip is two cache line transfers. Each sample times options.round_trips round trips;
+ *      the fastest sample is kept, as interrupts and frequency ramps only ever add time
+ * @param first CPU of the timing thread
+ * @param second CPU of the echoing thread
+ * @param options Round trips per sample and sample count
+ * @return nanoseconds per round trip, negative when a CPU could not be pinned
+ */
+auto c2c::measure_pair(int first, int second, c2c_options const & options) -> double {
+    c2c_line line;
+    std::atomic<int> ready { 0x0 };
+    std::uint64_t const total = options.round_trips * options.samples;
+
+    std::thread echo([&line, &ready, second, total] {
+        if (!cpu::pin_thread(second)) {
+            ready.store(-0x1, std::memory_order_release);
+            return;
+        }
+        ready.store(0x1, std::memory_order_release);
+        for (std::uint64_t expected = 0x1; expected < 0x2 * total; expected += 0x2) {
+            while (line.value.load(std::memory_order_acquire) != expected) { }
+            line.value.store(expected + 0x1, std::memory_order_release);
+        }
+    });
+
+    cpu_set_t original;
+    sched_getaffinity(0x0, sizeof(original), &original);
+    bool pinned = cpu::pin_thread(first);
+
+    int state;
+    while ((state = ready.load(std::memory_order_acquire)) == 0x0) { }
+
+    double best = -1.0;
+    if (state > 0x0) {
+        std::uint64_t value = 0x0;
+        for (std::size_t sample = 0x0; sample < options.samples; ++sample) {
+            std::uint64_t start = cube::tsc_clock::ticks_serialized();
+            for (std::size_t i = 0x0; i < options.round_trips; ++i) {
+                line.value.store(++value, std::memory_order_release);
+                ++value;
+                while (line.value.load(std::memory_order_acquire) != value) { }
+            }
+            std::uint64_t end = cube::tsc_clock::ticks_serialized();
+
+            double ns = static_cast<double>(cube::tsc_clock::to_duration(end - start).count()) /
+                        static_cast<double>(options.round_trips);
+            if (best < 0.0 || ns < best) best = ns;
+        }
+    }
+    echo.join();
+    sched_setaffinity(0x0, sizeof(original), &original);
+    return pinned ? best : -1.0;
+}
+
+/**
+ * \brief Pairs to measure, as indices into matrix.cpus with i < j
+ *      Without a budget (or when it covers everything) all pairs are returned. Otherwise every CPU
+ *      keeps its SMT siblings, its neighbour core in the same L3 group, the first CPU of the next L3
+ *      group and of the next package, so every relation class is represented for every CPU, and the
+ *      remaining budget is filled with pseudo random pairs
+ * @param layout Topology of the measured CPUs
+ * @param matrix Matrix with cpus and l3_group filled in
+ * @param options max_pairs budget and seed
+ * @return pairs, sorted
+ */
+auto c2c::select_pairs(cpu_topology const & layout, c2c_matrix const & matrix,
+                       c2c_options const & options) -> std::vector<std::pair<std::size_t, std::size_t>> {
+    std::size_t const count = matrix.cpus.size();
+    std::size_t const all = count * (count - std::min<std::size_t>(count, 0x1)) / 0x2;
+    std::set<std::pair<std::size_t, std::size_t>> pairs;
+
+    auto add = [&pairs](std::size_t i, std::size_t j) {
+        if (i != j) pairs.emplace(std::min(i, j), std::max(i, j));
+    };
+
+    if (options.max_pairs == 0x0 || options.max_pairs >= all) {
+        for (std::size_t i = 0x0; i < count; ++i) for (std::size_t j = i + 0x1; j < count; ++j) add(i, j);
+        return { pairs.begin(), pairs.end() };
+    }
+
+    for (std::size_t i = 0x0; i < count; ++i) {
+        bool neighbour = false, next_group = false, next_package = false;
+        for (std::size_t step = 0x1; step < count; ++step) {
+            std::size_t j = (i + step) % count;
+            switch (c2c::relation(layout, matrix, i, j)) {
+                case cpu_relation::smt_sibling: add(i, j); break;
+                case cpu_relation::shared_l3: if (!neighbour) add(i, j); neighbour = true; break;
+                case cpu_relation::same_package: if (!next_group) add(i, j); next_group = true; break;
+                case cpu_relation::cross_package: if (!next_package) add(i, j); next_package = true; break;
+            }
+        }
+    }
+
+    std::uint64_t state = options.seed | 0x1;
+    while (pairs.size() < options.max_pairs) {
+        state ^= state << 0xD;
+        state ^= state >> 0x7;
+        state ^= state << 0x11;
+        add(static_cast<std::size_t>(state % count), static_cast<std::size_t>((state >> 0x20) % count));
+    }
+    return { pairs.begin(), pairs.end() };
+}
+
+/**
+ * \brief Classifies a pair of matrix rows
+ * @return closest relation of the two CPUs
+ */
+auto c2c::relation(cpu_topology const & layout, c2c_matrix const & matrix, std::size_t i, std::size_t j) -> cpu_relation {
+    logical_cpu const * a = layout.find(matrix.cpus[i]);
+    logical_cpu const * b = layout.find(matrix.cpus[j]);
+    if (a->package != b->package) return cpu_relation::cross_package;
+    if (a->die == b->die && a->core == b->core) return cpu_relation::smt_sibling;
+    if (matrix.l3_group[i] >= 0x0 && matrix.l3_group[i] == matrix.l3_group[j]) return cpu_relation::shared_l3;
+    return cpu_relation::same_package;
+}
+
+/**
+ * \brief Measures the selected pairs, CPUs ordered by package, die, core and thread
+ * @param layout Topology from topology::enumerate()
+ * @param options Measurement options, max_pairs > 0x0 selects the sampled mode
+ * @return symmetric latency matrix
+ */
+auto c2c::run(cpu_topology const & layout, c2c_options const & options) -> c2c_matrix {
+    c2c_matrix matrix;
+    for (logical_cpu const & entry : layout.cpus) matrix.cpus.push_back(entry.cpu);
+
+    std::vector<cache_level> caches = cache_hierarchy::enumerate();
+    cache_level const * l3 = cache_hierarchy::find(caches, 0x3, cache_type::unified);
+    for (int id : matrix.cpus) {
+        int group = -0x1;
+        for (std::size_t k = 0x0; l3 && k < l3->instances.size(); ++k) {
+            std::vector<int> const & members = l3->instances[k];
+            if (std::find(members.begin(), members.end(), id) != members.end()) group = static_cast<int>(k);
+        }
+        matrix.l3_group.push_back(group);
+    }
+
+    std::size_t const count = matrix.cpus.size();
+    matrix.latency.assign(count * count, -1.0);
+    for (std::size_t i = 0x0; i < count; ++i) matrix.latency[i * count + i] = 0.0;
+
+    for (auto const & [i, j] : c2c::select_pairs(layout, matrix, options)) {
+        double ns = c2c::measure_pair(matrix.cpus[i], matrix.cpus[j], options);
+        matrix.latency[i * count + j] = ns;
+        matrix.latency[j * count + i] = ns;
+    }
+    return matrix;
+}
+
+/**
+ * \brief Prints the matrix (up to 64 CPUs) and min/median/max per relation class
+ *      Row labels are "cpu package/L3 group"; a bimodal same-package class usually means
+ *      sub-NUMA clustering (SNC/NPS) splits the package
+ * @param layout Topology used for the run
+ * @param matrix Output of run()
+ */
+auto c2c::print(cpu_topology const & layout, c2c_matrix const & matrix) -> void {
+    std::size_t const count = matrix.cpus.size();
+
+    if (count <= 0x40) {
+        std::printf("Round-trip latency in ns (. = not measured)\n%12s", "");
+        for (int id : matrix.cpus) std::printf("%6d", id);
+        std::printf("\n");
+
+        for (std::size_t i = 0x0; i < count; ++i) {
+            logical_cpu const * entry = layout.find(matrix.cpus[i]);
+            std::printf("%4d %3u/%-3d ", matrix.cpus[i], entry->package, matrix.l3_group[i]);
+            for (std::size_t j = 0x0; j < count; ++j) {
+                double ns = matrix.at(i, j);
+                if (i == j) std::printf("%6s", "-");
+                else if (ns < 0.0) std::printf("%6s", ".");
+                else std::printf("%6.0f", ns);
+            }
+            std::printf("\n");
+        }
+        std::printf("\n");
+    }
+
+    static constexpr char const * names[] = { "SMT sibling", "shared L3", "same package", "cross package" };
+    std::vector<double> classes[0x4];
+    for (std::size_t i = 0x0; i < count; ++i) {
+        for (std::size_t j = i + 0x1; j < count; ++j) {
+            if (matrix.at(i, j) < 0.0) continue;
+            classes[static_cast<std::size_t>(c2c::relation(layout, matrix, i, j))].push_back(matrix.at(i, j));
+        }
+    }
+
+    std::printf("%-14s %7s %9s %9s %9s\n", "relation", "pairs", "min ns", "median ns", "max ns");
+    for (std::size_t k = 0x0; k < 0x4; ++k) {
+        std::vector<double> & values = classes[k];
+        if (values.empty()) continue;
+        std::sort(values.begin(), values.end());
+        std::printf("%-14s %7zu %9.1f %9.1f %9.1f\n", names[k], values.size(),
+                    values.front(), values[values.size() / 0x2], values.back());
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_C2C_HPP
+#define CUBE_C2C_HPP
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "topology.hpp"
+
+struct c2c_options {
+    std::size_t round_trips { 0x7D0 };
+    std::size_t samples { 0x7 };
+    std::size_t max_pairs { 0x0 };
+    std::uint64_t seed { 0x9E3779B97F4A7C15 };
+};
+
+/**
+ * \brief Relation of two logical CPUs, from closest to farthest
+ */
+enum class cpu_relation : std::uint8_t { smt_sibling, shared_l3, same_package, cross_package };
+
+/**
+ * \brief Round-trip latency in nanoseconds between every measured pair, CPUs in topology order
+ *      latency[i * cpus.size() + j] is negative for pairs that were not measured
+ */
+struct c2c_matrix {
+    std::vector<int> cpus;
+    std::vector<int> l3_group;
+    std::vector<double> latency;
+
+    [[nodiscard]] auto at(std::size_t i, std::size_t j) const -> double { return latency[i * cpus.size() + j]; }
+};
+
+/**
+ * \brief Core-to-core latency: two threads pinned to a pair of CPUs bounce one cache line,
+ *      each round trip moves it to the other core and back
+ */
+class c2c {
+public:
+    static auto measure_pair(int first, int second, c2c_options const & options) -> double;
+    static auto select_pairs(cpu_topology const & layout, c2c_matrix const & matrix,
+                             c2c_options const & options) -> std::vector<std::pair<std::size_t, std::size_t>>;
+    static auto run(cpu_topology const & layout, c2c_options const & options) -> c2c_matrix;
+    static auto relation(cpu_topology const & layout, c2c_matrix const & matrix, std::size_t i, std::size_t j) -> cpu_relation;
+    static auto print(cpu_topology const & layout, c2c_matrix const & matrix) -> void;
+};
+
+#endif //CUBE_C2C_HPP
@@ -0,0 +1,182 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <map>
+#include <bit>
+#include <cstdio>
+#include <sched.h>
+
+#include "cpu.hpp"
+#include "cache.hpp"
+#include "cpuid.hpp"
+#include "procfs.hpp"
+
+/**
+ * \brief Short name in the usual notation (L1d, L1i, L2, L3)
+ * @return name of the cache
+ */
+auto cache_level::name() const -> std::string {
+    std::string result = "L" + std::to_string(level);
+    if (type == cache_type::data) result += 'd';
+    else if (type == cache_type::instruction) result += 'i';
+    return result;
+}
+
+/**
+ * \brief Walks the subleaves of a deterministic cache parameters leaf until the null descriptor
+ * @param leaf 0x4 on Intel, 0x8000001D on AMD
+ * @return one entry per cache, without instances
+ */
+auto cache_hierarchy::deterministic(std::uint32_t leaf) -> std::vector<cache_level> {
+    std::vector<cache_level> caches;
+    cpuid_snapshot const & snapshot = cpuid_snapshot::get();
+
+    for (std::uint32_t subleaf = 0x0; subleaf < 0x20; ++subleaf) {
+        auto [eax, ebx, ecx, edx] = snapshot.query(leaf, subleaf);
+
+        std::uint32_t type = eax & 0x1F;
+        if (type == 0x0) break;
+
+        cache_level cache;
+        cache.type = (type == 0x1) ? cache_type::data : (type == 0x2) ? cache_type::instruction : cache_type::unified;
+        cache.level = (eax >> 0x5) & 0x7;
+        cache.fully_associative = (eax >> 0x9) & 0x1;
+        cache.sharing = ((eax >> 0xE) & 0xFFF) + 0x1;
+        cache.line_size = (ebx & 0xFFF) + 0x1;
+        cache.partitions = ((ebx >> 0xC) & 0x3FF) + 0x1;
+        cache.ways = ((ebx >> 0x16) & 0x3FF) + 0x1;
+        cache.sets = ecx + 0x1;
+        cache.inclusive = (edx >> 0x1) & 0x1;
+        cache.complex_indexing = (edx >> 0x2) & 0x1;
+        cache.size = static_cast<std::uint64_t>(cache.ways) * cache.partitions * cache.line_size * cache.sets;
+        caches.push_back(std::move(cache));
+    }
+    return caches;
+}
+
+/**
+ * \brief Pre-Zen AMD parts only describe their caches in 80000005H (L1) and 80000006H (L2/L3)
+ *      Sharing is not enumerated there, so those caches have no instances
+ * @return caches reported by the legacy leaves
+ */
+auto cache_hierarchy::legacy_amd() -> std::vector<cache_level> {
+    static constexpr std::uint32_t ways_encoding[0x10] = {
+            0x0, 0x1, 0x2, 0x3, 0x4, 0x6, 0x8, 0x0, 0x10, 0x0, 0x20, 0x30, 0x40, 0x60, 0x80, 0x0 };
+    std::vector<cache_level> caches;
+    cpuid_snapshot const & snapshot = cpuid_snapshot::get();
+
+    auto add = [&caches](std::uint32_t level, cache_type type, std::uint64_t size, std::uint32_t ways, std::uint32_t line) {
+        if (size == 0x0 || line == 0x0) return;
+        cache_level cache;
+        cache.level = level;
+        cache.type = type;
+        cache.size = size;
+        cache.line_size = line;
+        cache.partitions = 0x1;
+        cache.fully_associative = ways == 0x0;
+        cache.ways = ways ? ways : static_cast<std::uint32_t>(size / line);
+        cache.sets = static_cast<std::uint32_t>(size / (static_cast<std::uint64_t>(cache.ways) * line));
+        caches.push_back(std::move(cache));
+    };
+
+    if (snapshot.max_extended_leaf() >= 0x80000005) {
+        auto [eax, ebx, ecx, edx] = snapshot.query(0x80000005);
+        add(0x1, cache_type::data, (ecx >> 0x18) * 0x400ULL, ((ecx >> 0x10) & 0xFF) == 0xFF ? 0x0 : (ecx >> 0x10) & 0xFF, ecx & 0xFF);
+        add(0x1, cache_type::instruction, (edx >> 0x18) * 0x400ULL, ((edx >> 0x10) & 0xFF) == 0xFF ? 0x0 : (edx >> 0x10) & 0xFF, edx & 0xFF);
+    }
+    if (snapshot.max_extended_leaf() >= 0x80000006) {
+        auto [eax, ebx, ecx, edx] = snapshot.query(0x80000006);
+        add(0x2, cache_type::unified, (ecx >> 0x10) * 0x400ULL, ways_encoding[(ecx >> 0xC) & 0xF], ecx & 0xFF);
+        add(0x3, cache_type::unified, (edx >> 0x12) * 0x80000ULL, ways_encoding[(edx >> 0xC) & 0xF], edx & 0xFF);
+    }
+    return caches;
+}
+
+/**
+ * \brief Works out which logical CPUs share every cache instance
+ *      Runs on each online CPU in turn to read its APIC ID; CPUs whose APIC IDs agree once
+ *      the low ceil(log2(sharing)) bits are dropped share one instance of the cache
+ * @param caches Caches with the sharing field filled in
+ */
+auto cache_hierarchy::assign_instances(std::vector<cache_level> & caches) -> void {
+    cpu_set_t original;
+    if (sched_getaffinity(0x0, sizeof(original), &original) != 0x0) return;
+
+    std::vector<std::pair<int, std::uint32_t>> apic_ids;
+    for (int id : cpu::online_cpus()) {
+        if (cpu::pin_thread(id)) apic_ids.emplace_back(id, cpu::apic_id());
+    }
+    sched_setaffinity(0x0, sizeof(original), &original);
+
+    for (cache_level & cache : caches) {
+        if (cache.sharing == 0x0) continue;
+        auto shift = static_cast<std::uint32_t>(std::bit_width(cache.sharing - 0x1));
+
+        std::map<std::uint32_t, std::vector<int>> groups;
+        for (auto const & [id, apic] : apic_ids) groups[apic >> shift].push_back(id);
+        for (auto & group : groups) cache.instances.push_back(std::move(group.second));
+    }
+}
+
+/**
+ * \brief Enumerates every cache level and type of the processor
+ * @return caches ordered as the CPU reports them (usually L1d, L1i, L2, L3)
+ */
+auto cache_hierarchy::enumerate() -> std::vector<cache_level> {
+    std::vector<cache_level> caches;
+    std::string vendor = cpu::vendor_id();
+    cpuid_snapshot const & snapshot = cpuid_snapshot::get();
+
+    if (vendor == "AuthenticAMD" || vendor == "HygonGenuine") {
+        bool topology_extensions = (snapshot.query(0x80000001).ecx >> 0x16) & 0x1;
+        caches = topology_extensions ? cache_hierarchy::deterministic(0x8000001D) : cache_hierarchy::legacy_amd();
+    } else if (snapshot.max_leaf() >= 0x4) {
+        caches = cache_hierarchy::deterministic(0x4);
+    }
+
+    cache_hierarchy::assign_instances(caches);
+    return caches;
+}
+
+/**
+ * \brief Looks up one cache by level and type
+ * @param caches Output of enumerate()
+ * @param level Cache level (1, 2, 3, ...)
+ * @param type Data, instruction or unified
+ * @return pointer into caches, nullptr when there is no such cache
+ */
+auto cache_hierarchy::find(std::vector<cache_level> const & caches, std::uint32_t level, cache_type type) -> cache_level const * {
+    for (cache_level const & cache : caches) {
+        if (cache.level == level && cache.type == type) return &cache;
+    }
+    return nullptr;
+}
+
+/**
+ * \brief Prints one line per cache followed by the CPUs sharing each instance
+ * @param caches Output of enumerate()
+ */
+auto cache_hierarchy::print(std::vector<cache_level> const & caches) -> void {
+    std::printf("%-5s %10s %6s %8s %7s %9s %8s %9s\n",
+                "Cache", "Size", "Line", "Ways", "Sets", "Inclusive", "Sharing", "Instances");
+
+    for (cache_level const & cache : caches) {
+        char ways[0x10];
+        if (cache.fully_associative) std::snprintf(ways, sizeof(ways), "full");
+        else std::snprintf(ways, sizeof(ways), "%u", cache.ways);
+
+        std::printf("%-5s %7llu KiB %4u B %8s %7u %9s %8u %9zu\n",
+                    cache.name().c_str(), static_cast<unsigned long long>(cache.size / 0x400),
+                    cache.line_size, ways, cache.sets, cache.inclusive ? "yes" : "no",
+                    cache.sharing, cache.instances.size());
+    }
+
+    for (cache_level const & cache : caches) {
+        if (cache.instances.empty()) continue;
+        std::printf("%-5s", cache.name().c_str());
+        for (std::vector<int> const & instance : cache.instances) std::printf(" [%s]", format_cpu_list(instance).c_str());
+        std::printf("\n");
+    }
+}
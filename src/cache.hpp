@@ -0,0 +1,53 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_CACHE_HPP
+#define CUBE_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum class cache_type { data, instruction, unified };
+
+/**
+ * \brief One cache as described by a deterministic cache parameters subleaf
+ *      instances lists, for every physical copy of this cache, the logical CPUs sharing it
+ */
+struct cache_level {
+    std::uint32_t level { 0x0 };
+    cache_type type { cache_type::unified };
+    std::uint64_t size { 0x0 };
+    std::uint32_t line_size { 0x0 };
+    std::uint32_t ways { 0x0 };
+    std::uint32_t partitions { 0x0 };
+    std::uint32_t sets { 0x0 };
+    std::uint32_t sharing { 0x0 };
+    bool inclusive { false };
+    bool fully_associative { false };
+    bool complex_indexing { false };
+    std::vector<std::vector<int>> instances;
+
+    [[nodiscard]] auto name() const -> std::string;
+};
+
+/**
+ * \brief Cache hierarchy from CPUID leaf 4 (Intel) or 8000001DH (AMD with topology extensions),
+ *      with the legacy AMD leaves 80000005H/80000006H as fallback
+ */
+class cache_hierarchy {
+public:
+    static auto enumerate() -> std::vector<cache_level>;
+    static auto find(std::vector<cache_level> const & caches, std::uint32_t level, cache_type type) -> cache_level const *;
+    static auto print(std::vector<cache_level> const & caches) -> void;
+
+private:
+    static auto deterministic(std::uint32_t leaf) -> std::vector<cache_level>;
+    static auto legacy_amd() -> std::vector<cache_level>;
+    static auto assign_instances(std::vector<cache_level> & caches) -> void;
+};
+
+#endif //CUBE_CACHE_HPP
@@ -0,0 +1,410 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#include "cpu.hpp"
+#include "cgroup.hpp"
+
+namespace {
+    /**
+     * \brief memory.max, memory.high and the quota of cpu.max hold either a number or "max"
+     */
+    auto parse_limit(proc_scanner & scanner) -> std::uint64_t {
+        scanner.skip_spaces();
+        if (scanner.done() || scanner.starts_with("max")) {
+            scanner.next_word();
+            return cgroup_stats::unlimited;
+        }
+        return scanner.next_u64();
+    }
+
+    struct stat_field {
+        std::string_view key;
+        std::uint64_t cgroup_stats::* member;
+    };
+
+    constexpr stat_field cpu_fields[] {
+        { "usage_usec", &cgroup_stats::usage_usec },
+        { "user_usec", &cgroup_stats::user_usec },
+        { "system_usec", &cgroup_stats::system_usec },
+        { "nr_periods", &cgroup_stats::nr_periods },
+        { "nr_throttled", &cgroup_stats::nr_throttled },
+        { "throttled_usec", &cgroup_stats::throttled_usec },
+    };
+
+    constexpr stat_field memory_fields[] {
+        { "anon", &cgroup_stats::anon },
+        { "file", &cgroup_stats::file },
+        { "kernel", &cgroup_stats::kernel },
+        { "shmem", &cgroup_stats::shmem },
+        { "sock", &cgroup_stats::sock },
+        { "file_dirty", &cgroup_stats::file_dirty },
+        { "pgmajfault", &cgroup_stats::pgmajfault },
+    };
+
+    constexpr stat_field event_fields[] {
+        { "high", &cgroup_stats::events_high },
+        { "max", &cgroup_stats::events_max },
+        { "oom_kill", &cgroup_stats::events_oom_kill },
+    };
+
+    /**
+     * \brief Reads "key value" lines into the members named by the table, unknown keys are skipped
+     * @return false when the file is empty or missing
+     */
+    template <std::size_t N>
+    auto read_keyed(proc_file & file, stat_field const (& fields)[N], cgroup_stats & out) -> bool {
+        std::string_view text = file.read();
+        for (proc_scanner scanner(text); !scanner.done(); scanner.next_line()) {
+            std::string_view key = scanner.next_word();
+            for (stat_field const & field : fields) {
+                if (field.key != key) continue;
+                out.*field.member = scanner.next_u64();
+                break;
+            }
+        }
+        return !text.empty();
+    }
+
+    /**
+     * \brief Checks a space separated controller list such as cgroup.controllers
+     */
+    auto lists_controller(std::string const & file, std::string_view name) -> bool {
+        proc_file controllers(file.c_str(), 0x100);
+        proc_scanner scanner(controllers.read());
+        for (std::string_view word = scanner.next_word(); !word.empty(); word = scanner.next_word()) {
+            if (word == name) return true;
+        }
+        return false;
+    }
+
+    /**
+     * \brief Checks whether a controller is attached to a cgroup v1 hierarchy, from the "ID:CONTROLLERS:PATH"
+     *      lines of /proc/self/cgroup (hybrid hosts keep memory and cpu there and leave cgroup2 almost empty)
+     */
+    auto v1_controller(std::string_view name) -> bool {
+        proc_file membership(PROC_SELF_CGROUP, 0x1000);
+        for (proc_scanner scanner(membership.read()); !scanner.done(); scanner.next_line()) {
+            std::string_view line = scanner.next_word();
+            std::size_t first = line.find(':'), second = line.find(':', first + 0x1);
+            if (first == std::string_view::npos || second == std::string_view::npos || line.substr(0x0, first) == "0") continue;
+
+            std::string_view list = line.substr(first + 0x1, second - first - 0x1);
+            while (!list.empty()) {
+                std::size_t comma = list.find(',');
+                if (list.substr(0x0, comma) == name) return true;
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 0x1);
+            }
+        }
+        return false;
+    }
+
+    auto gib(std::uint64_t bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0);
+    }
+
+    auto mib(std::uint64_t bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+/**
+ * \brief Opens the interface files of one group, or only remembers where they are
+ * @param directory Directory of the group in the cgroup2 mount
+ * @param path Path of the group relative to the mount, for reports
+ * @param keep_open false to open the files for each refresh and close them again
+ */
+cgroup_reader::cgroup_reader(std::string directory, std::string path, bool keep_open)
+        : directory(std::move(directory)),
+          keep_open(keep_open) {
+    current.path = std::move(path);
+    if (keep_open) cgroup_reader::open();
+}
+
+auto cgroup_reader::open() -> void {
+    cpu_max = proc_file((directory + "/cpu.max").c_str(), 0x40);
+    cpu_stat = proc_file((directory + "/cpu.stat").c_str(), 0x200);
+    cpuset = proc_file((directory + "/cpuset.cpus.effective").c_str(), 0x100);
+    memory_current = proc_file((directory + "/memory.current").c_str(), 0x20);
+    memory_max = proc_file((directory + "/memory.max").c_str(), 0x20);
+    memory_high = proc_file((directory + "/memory.high").c_str(), 0x20);
+    memory_swap = proc_file((directory + "/memory.swap.current").c_str(), 0x20);
+    memory_stat = proc_file((directory + "/memory.stat").c_str(), 0x1000);
+    memory_events = proc_file((directory + "/memory.events").c_str(), 0x100);
+}
+
+auto cgroup_reader::close() -> void {
+    for (proc_file * file : { &cpu_max, &cpu_stat, &cpuset, &memory_current, &memory_max, &memory_high, &memory_swap,
+                              &memory_stat, &memory_events }) {
+        file->close();
+    }
+}
+
+/**
+ * \brief Re-reads every open file and derives the rates against the previous refresh
+ *      Utilization is usage over wall time divided by the quota in CPUs, or by the cpuset size without a quota
+ * @return false when neither the CPU nor the memory files could be read (the group is gone)
+ */
+auto cgroup_reader::refresh() -> bool {
+    if (!keep_open) cgroup_reader::open();
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - stamp).count();
+    previous = current;
+
+    proc_scanner limit(cpu_max.read());
+    current.quota_usec = parse_limit(limit);
+    if (std::uint64_t period = limit.next_u64()) current.period_usec = period;
+
+    std::string_view text = cpuset.read();
+    if (!text.empty()) current.cpus = proc_scanner(text).next_cpu_list();
+    else if (current.cpus.empty()) current.cpus = cpu::online_cpus();
+
+    current.has_cpu = read_keyed(cpu_stat, cpu_fields, current);
+
+    text = memory_current.read();
+    current.has_memory = !text.empty();
+    if (current.has_memory) {
+        current.memory_current = proc_scanner(text).next_u64();
+        proc_scanner maximum(memory_max.read());
+        current.memory_max = parse_limit(maximum);
+        proc_scanner high(memory_high.read());
+        current.memory_high = parse_limit(high);
+        current.swap_current = proc_scanner(memory_swap.read()).next_u64();
+        read_keyed(memory_stat, memory_fields, current);
+        read_keyed(memory_events, event_fields, current);
+    }
+
+    if (primed && seconds > 0.0) {
+        auto delta = [&](std::uint64_t cgroup_stats::* member) {
+            return current.*member >= previous.*member ? static_cast<double>(current.*member - previous.*member) : 0.0;
+        };
+
+        current.cores_used = delta(&cgroup_stats::usage_usec) / 1e6 / seconds;
+        current.user_cores = delta(&cgroup_stats::user_usec) / 1e6 / seconds;
+        double capacity = current.quota_cores() > 0.0 ? current.quota_cores() : static_cast<double>(std::max<std::size_t>(current.cpus.size(), 0x1));
+        current.quota_percent = current.cores_used / capacity * 100.0;
+
+        double periods = delta(&cgroup_stats::nr_periods);
+        current.throttled_percent = periods > 0.0 ? delta(&cgroup_stats::nr_throttled) / periods * 100.0 : 0.0;
+        current.throttled_ms_per_second = delta(&cgroup_stats::throttled_usec) / 1e3 / seconds;
+        current.major_faults_per_second = delta(&cgroup_stats::pgmajfault) / seconds;
+        current.rates = true;
+    }
+
+    stamp = now;
+    primed = true;
+    if (!keep_open) cgroup_reader::close();
+    return current.has_cpu || current.has_memory;
+}
+
+/**
+ * \brief Finds the cgroup2 mount in /proc/self/mountinfo, once
+ *      Line format: "ID PARENT MAJ:MIN ROOT MOUNTPOINT OPTIONS [OPTIONAL...] - FSTYPE SOURCE SUPER_OPTIONS"
+ * @return mount point and the group mounted there (ROOT), both empty when no cgroup2 hierarchy is mounted
+ */
+auto cgroup::mount() -> std::pair<std::string, std::string> const & {
+    static std::pair<std::string, std::string> const found = [] {
+        proc_file mountinfo(PROC_SELF_MOUNTINFO, 0x4000);
+        for (proc_scanner scanner(mountinfo.read()); !scanner.done(); scanner.next_line()) {
+            for (int field = 0x0; field < 0x3; ++field) scanner.next_word();
+            std::string_view root = scanner.next_word();
+            std::string_view point = scanner.next_word();
+
+            std::string_view word;
+            while (!(word = scanner.next_word()).empty() && word != "-") { }
+            if (scanner.next_word() == "cgroup2") return std::make_pair(std::string(point), std::string(root));
+        }
+        return std::pair<std::string, std::string>();
+    }();
+    return found;
+}
+
+auto cgroup::mount_point() -> std::string const & {
+    return cgroup::mount().first;
+}
+
+/**
+ * \brief Group the mount point shows, "/" unless a container runtime bind-mounted only its own subtree
+ */
+auto cgroup::mount_root() -> std::string const & {
+    return cgroup::mount().second;
+}
+
+/**
+ * \brief The own group from the "0::PATH" line of /proc/self/cgroup
+ *      The line is relative to the hierarchy root (or the cgroup namespace). Without a namespace, a container
+ *      may see "0::/docker/ID" while its mount already shows /docker/ID as ROOT; that prefix is removed
+ * @return path relative to the mount, "/" when the line is missing
+ */
+auto cgroup::self_path() -> std::string {
+    proc_file membership(PROC_SELF_CGROUP, 0x1000);
+    for (proc_scanner scanner(membership.read()); !scanner.done(); scanner.next_line()) {
+        if (!scanner.starts_with("0::")) continue;
+        std::string_view line = scanner.next_word();
+        line.remove_prefix(0x3);
+
+        std::string_view root = cgroup::mount_root();
+        while (!root.empty() && root.back() == '/') root.remove_suffix(0x1);
+        if (!root.empty() && line.substr(0x0, root.size()) == root && (line.size() == root.size() || line[root.size()] == '/')) {
+            line.remove_prefix(root.size());
+        }
+        return line.empty() ? std::string("/") : std::string(line);
+    }
+    return "/";
+}
+
+/**
+ * \brief Directory of a group given relative to the mount or as a path that already includes it
+ */
+auto cgroup::directory(std::string_view path) -> std::string {
+    std::string const & mount = cgroup::mount_point();
+    if (path.substr(0x0, mount.size()) == mount && (path.size() == mount.size() || path[mount.size()] == '/')) return std::string(path);
+    if (path.empty() || path == "/") return mount;
+    return mount + (path.front() == '/' ? "" : "/") + std::string(path);
+}
+
+/**
+ * \brief Opens the own group and takes the first sample, only the first call does work
+ * @return false without a cgroup2 hierarchy or when the group has no readable files
+ */
+auto cgroup::init() -> bool {
+    std::call_once(cgroup::initialized, [] {
+        if (cgroup::mount_point().empty()) return;
+        std::string path = cgroup::self_path();
+        cgroup::reader = std::make_unique<cgroup_reader>(cgroup::directory(path), path);
+        cgroup::available = cgroup::reader->refresh();
+    });
+    return cgroup::available;
+}
+
+auto cgroup::refresh() -> bool {
+    return cgroup::reader && cgroup::reader->refresh();
+}
+
+auto cgroup::self() -> cgroup_stats const & {
+    static cgroup_stats const empty;
+    return cgroup::reader ? cgroup::reader->stats() : empty;
+}
+
+/**
+ * \brief Finds a group and its descendants up to depth levels below it
+ *      The readers open their files only while refreshing, so a subtree of thousands of groups holds no
+ *      descriptors between the two samples of a report
+ * @param path Root of the subtree, relative to the mount or including it
+ * @param depth Levels below the root, 0x0 for the root alone
+ * @return one reader per group, root first, each refreshed once
+ */
+auto cgroup::subtree(std::string_view path, int depth) -> std::vector<std::unique_ptr<cgroup_reader>> {
+    std::vector<std::unique_ptr<cgroup_reader>> readers;
+    std::string const & mount = cgroup::mount_point();
+    std::string root = cgroup::directory(path);
+
+    auto add = [&](std::string const & directory) {
+        std::string relative = directory.size() > mount.size() ? directory.substr(mount.size()) : std::string("/");
+        readers.push_back(std::make_unique<cgroup_reader>(directory, relative, false));
+        readers.back()->refresh();
+    };
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) return readers;
+    add(root);
+    if (depth <= 0x0) return readers;
+
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (auto it = std::filesystem::recursive_directory_iterator(root, options, error);
+         it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (error) break;
+        if (!it->is_directory(error)) continue;
+        if (it.depth() + 0x1 >= depth) it.disable_recursion_pending();
+        add(it->path().string());
+    }
+    return readers;
+}
+
+/**
+ * \brief Samples twice, interval apart, and prints the own group; with a subtree also one line per group in it
+ * @param interval Time between the two samples
+ * @param subtree Root of the breakdown, empty for none
+ * @return process exit code
+ */
+auto cgroup::print(std::chrono::milliseconds interval, std::string_view subtree) -> int {
+    if (!cgroup::init()) {
+        std::fprintf(stderr, "no cgroup v2 hierarchy is mounted, or %s is not readable\n", PROC_SELF_CGROUP);
+        return 0x1;
+    }
+
+    std::vector<std::unique_ptr<cgroup_reader>> groups;
+    if (!subtree.empty()) groups = cgroup::subtree(subtree, 0x3);
+    std::this_thread::sleep_for(interval);
+    cgroup::refresh();
+    for (auto & group : groups) group->refresh();
+
+    cgroup_stats const & self = cgroup::self();
+    std::printf("Cgroup %s (cgroup2 at %s)\n", self.path.c_str(), cgroup::mount_point().c_str());
+
+    if (!self.has_cpu) {
+        std::printf("CPU     cpu.stat not readable\n");
+    } else {
+        if (self.quota_cores() > 0.0) {
+            std::printf("CPU     quota %.2f CPUs (%llu us per %llu us), cpuset %s (%zu CPUs)\n", self.quota_cores(),
+                        static_cast<unsigned long long>(self.quota_usec), static_cast<unsigned long long>(self.period_usec),
+                        format_cpu_list(self.cpus).c_str(), self.cpus.size());
+        } else {
+            std::printf("CPU     no quota, cpuset %s (%zu CPUs)\n", format_cpu_list(self.cpus).c_str(), self.cpus.size());
+        }
+        std::printf("        using %.2f CPUs (%.2f user) = %.1f%% of the %s over %lld ms\n", self.cores_used, self.user_cores,
+                    self.quota_percent, self.quota_cores() > 0.0 ? "quota" : "cpuset", static_cast<long long>(interval.count()));
+        std::printf("        throttled in %.1f%% of periods, %.1f ms/s; %llu of %llu periods throttled in total\n",
+                    self.throttled_percent, self.throttled_ms_per_second, static_cast<unsigned long long>(self.nr_throttled),
+                    static_cast<unsigned long long>(self.nr_periods));
+    }
+
+    if (!self.has_memory) {
+        if (lists_controller(cgroup::mount_point() + "/cgroup.controllers", "memory")) {
+            std::printf("Memory  memory controller not enabled for this group\n");
+        } else if (v1_controller("memory")) {
+            std::printf("Memory  memory controller is on cgroup v1 (hybrid hierarchy), not accounted in cgroup2\n");
+        } else {
+            std::printf("Memory  memory controller not available in this cgroup2 hierarchy\n");
+        }
+    } else {
+        if (self.memory_max == cgroup_stats::unlimited) std::printf("Memory  %.2f GiB, no limit", gib(self.memory_current));
+        else if (self.memory_max == 0x0) std::printf("Memory  %.2f GiB, limit 0 (memory.max is 0)", gib(self.memory_current));
+        else std::printf("Memory  %.2f of %.2f GiB (%.1f%%), headroom %.2f GiB", gib(self.memory_current), gib(self.memory_max),
+                         static_cast<double>(self.memory_current) / static_cast<double>(self.memory_max) * 100.0, gib(self.headroom()));
+        if (self.memory_high != cgroup_stats::unlimited) std::printf(", high %.2f GiB", gib(self.memory_high));
+        std::printf(", swap %.2f GiB\n", gib(self.swap_current));
+        std::printf("        anon %.0f MiB, file %.0f MiB (%.0f MiB dirty), kernel %.0f MiB, shmem %.0f MiB, sock %.0f MiB\n",
+                    mib(self.anon), mib(self.file), mib(self.file_dirty), mib(self.kernel), mib(self.shmem), mib(self.sock));
+        std::printf("        %.1f major faults/s; events: high %llu, max %llu, oom_kill %llu\n", self.major_faults_per_second,
+                    static_cast<unsigned long long>(self.events_high), static_cast<unsigned long long>(self.events_max),
+                    static_cast<unsigned long long>(self.events_oom_kill));
+    }
+
+    if (subtree.empty()) return 0x0;
+    if (groups.empty()) {
+        std::fprintf(stderr, "%s is not a cgroup\n", cgroup::directory(subtree).c_str());
+        return 0x1;
+    }
+
+    std::stable_sort(groups.begin(), groups.end(), [](auto const & a, auto const & b) { return a->stats().cores_used > b->stats().cores_used; });
+    std::printf("\n%8s %8s %8s %10s %10s %10s %10s  %s\n", "CPUs", "Quota", "Use %", "Thr %", "Thr ms/s", "Mem MiB", "Limit MiB", "Group");
+    for (auto const & group : groups) {
+        cgroup_stats const & stats = group->stats();
+        char quota[0x10], limit[0x10];
+        if (stats.quota_cores() > 0.0) std::snprintf(quota, sizeof(quota), "%.2f", stats.quota_cores());
+        else std::snprintf(quota, sizeof(quota), "max");
+        if (stats.memory_max != cgroup_stats::unlimited) std::snprintf(limit, sizeof(limit), "%.0f", mib(stats.memory_max));
+        else std::snprintf(limit, sizeof(limit), stats.has_memory ? "max" : "-");
+
+        std::printf("%8.2f %8s %8.1f %10.1f %10.1f %10.0f %10s  %s\n", stats.cores_used, quota, stats.quota_percent,
+                    stats.throttled_percent, stats.throttled_ms_per_second, mib(stats.memory_current), limit, stats.path.c_str());
+    }
+    return 0x0;
+}
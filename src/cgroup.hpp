@@ -0,0 +1,138 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_CGROUP_HPP
+#define CUBE_CGROUP_HPP
+
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+#include "procfs.hpp"
+
+#define PROC_SELF_CGROUP "/proc/self/cgroup"
+#define PROC_SELF_MOUNTINFO "/proc/self/mountinfo"
+
+/**
+ * \brief CPU and memory accounting of one cgroup v2 directory
+ *      Counters are as read, the rates cover the time between the last two refreshes. Without a CPU quota the
+ *      utilization is measured against the CPUs of cpuset.cpus.effective. Controllers that are not enabled for the
+ *      group leave has_cpu / has_memory false
+ */
+struct cgroup_stats {
+    static constexpr std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+
+    std::string path;
+    std::uint64_t quota_usec { unlimited };
+    std::uint64_t period_usec { 0x186A0 };
+    std::vector<int> cpus;
+    std::uint64_t usage_usec { 0x0 };
+    std::uint64_t user_usec { 0x0 };
+    std::uint64_t system_usec { 0x0 };
+    std::uint64_t nr_periods { 0x0 };
+    std::uint64_t nr_throttled { 0x0 };
+    std::uint64_t throttled_usec { 0x0 };
+    double cores_used { 0.0 };
+    double user_cores { 0.0 };
+    double quota_percent { 0.0 };
+    double throttled_percent { 0.0 };
+    double throttled_ms_per_second { 0.0 };
+
+    std::uint64_t memory_current { 0x0 };
+    std::uint64_t memory_max { unlimited };
+    std::uint64_t memory_high { unlimited };
+    std::uint64_t swap_current { 0x0 };
+    std::uint64_t anon { 0x0 };
+    std::uint64_t file { 0x0 };
+    std::uint64_t kernel { 0x0 };
+    std::uint64_t shmem { 0x0 };
+    std::uint64_t sock { 0x0 };
+    std::uint64_t file_dirty { 0x0 };
+    std::uint64_t pgmajfault { 0x0 };
+    std::uint64_t events_high { 0x0 };
+    std::uint64_t events_max { 0x0 };
+    std::uint64_t events_oom_kill { 0x0 };
+    double major_faults_per_second { 0.0 };
+
+    bool has_cpu { false };
+    bool has_memory { false };
+    bool rates { false };
+
+    [[nodiscard]] auto quota_cores() const -> double {
+        return quota_usec == unlimited ? -1.0 : static_cast<double>(quota_usec) / static_cast<double>(period_usec);
+    }
+    [[nodiscard]] auto headroom() const -> std::uint64_t {
+        return memory_max == unlimited ? unlimited : memory_max > memory_current ? memory_max - memory_current : 0x0;
+    }
+    [[nodiscard]] auto limited() const -> bool { return quota_usec != unlimited || memory_max != unlimited; }
+};
+
+/**
+ * \brief Reads the interface files of one cgroup and turns them into cgroup_stats
+ *      By default the files stay open and those of disabled controllers fail to open once and are skipped from
+ *      then on; without keep_open every refresh opens and closes them (nine descriptors for the duration)
+ */
+class cgroup_reader {
+public:
+    cgroup_reader(std::string directory, std::string path, bool keep_open = true);
+
+    auto refresh() -> bool;
+    [[nodiscard]] auto stats() const -> cgroup_stats const & { return current; }
+
+private:
+    std::string directory;
+    bool keep_open;
+    proc_file cpu_max;
+    proc_file cpu_stat;
+    proc_file cpuset;
+    proc_file memory_current;
+    proc_file memory_max;
+    proc_file memory_high;
+    proc_file memory_swap;
+    proc_file memory_stat;
+    proc_file memory_events;
+    cgroup_stats current;
+    cgroup_stats previous;
+    std::chrono::steady_clock::time_point stamp;
+    bool primed { false };
+
+    auto open() -> void;
+    auto close() -> void;
+};
+
+/**
+ * \brief The cgroup v2 hierarchy as seen by this process
+ *      The mount point comes from /proc/self/mountinfo (cgroup2 may sit at /sys/fs/cgroup or, on hybrid hosts,
+ *      /sys/fs/cgroup/unified), the own group from the "0::" line of /proc/self/cgroup, made relative to the
+ *      group the mount shows
+ */
+class cgroup {
+public:
+    static auto mount_point() -> std::string const &;
+    static auto mount_root() -> std::string const &;
+    static auto self_path() -> std::string;
+    static auto init() -> bool;
+    static auto refresh() -> bool;
+    static auto self() -> cgroup_stats const &;
+    static auto subtree(std::string_view path, int depth) -> std::vector<std::unique_ptr<cgroup_reader>>;
+    static auto print(std::chrono::milliseconds interval, std::string_view subtree) -> int;
+
+private:
+    static inline std::once_flag initialized;
+    static inline bool available { false };
+    static inline std::unique_ptr<cgroup_reader> reader;
+
+    static auto mount() -> std::pair<std::string, std::string> const &;
+    static auto directory(std::string_view path) -> std::string;
+};
+
+#endif //CUBE_CGROUP_HPP
@@ -0,0 +1,211 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <sched.h>
+#include <algorithm>
+#include <x86intrin.h>
+
+#include "cpu.hpp"
+#include "bench.hpp"
+#include "clocks.hpp"
+#include "procfs.hpp"
+#include "tsc_clock.hpp"
+
+namespace {
+    auto read_rdtsc() noexcept -> std::uint64_t {
+        return cpu::read_cycle_count();
+    }
+
+    auto read_rdtscp() noexcept -> std::uint64_t {
+        unsigned int aux;
+        return __rdtscp(&aux);
+    }
+
+    auto read_lfence_rdtsc() noexcept -> std::uint64_t {
+        _mm_lfence();
+        return cpu::read_cycle_count();
+    }
+
+    template <clockid_t Id>
+    auto read_clock() noexcept -> std::uint64_t {
+        timespec now { };
+        clock_gettime(Id, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 0x3B9ACA00 + static_cast<std::uint64_t>(now.tv_nsec);
+    }
+
+    template <typename Clock>
+    auto read_chrono() noexcept -> std::uint64_t {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+    }
+
+    auto ticks_to_ns(double ticks) -> double {
+        return ticks * 1e9 / cube::tsc_clock::calibration().hz;
+    }
+
+    /**
+     * \brief Call cost, observed granularity and backward steps of one reader on the current CPU
+     *      The cost is the best of three timed loops, interrupts only ever add time. The step loop keeps reading
+     *      until it has seen 256 changes or 50 ms passed, so the coarse clocks (one step per tick) still show theirs
+     */
+    template <auto (* Read)() noexcept -> std::uint64_t>
+    auto measure(clock_source const & source, std::size_t calls) -> clock_result {
+        clock_result result;
+        std::uint64_t sink = 0x0;
+        for (std::size_t i = 0x0; i < 0x100; ++i) sink ^= Read();
+
+        double best = std::numeric_limits<double>::max();
+        for (int repeat = 0x0; repeat < 0x3; ++repeat) {
+            std::uint64_t start = cube::tsc_clock::ticks_serialized();
+            for (std::size_t i = 0x0; i < calls; ++i) sink ^= Read();
+            std::uint64_t end = cube::tsc_clock::ticks_serialized();
+            best = std::min(best, ticks_to_ns(static_cast<double>(end - start)) / static_cast<double>(calls));
+        }
+        cube::do_not_optimize(sink);
+        result.cost_ns = best;
+
+        std::uint64_t const deadline = cube::tsc_clock::ticks() + static_cast<std::uint64_t>(cube::tsc_clock::calibration().hz / 0x14);
+        std::uint64_t step = std::numeric_limits<std::uint64_t>::max(), changes = 0x0;
+        std::uint64_t previous = Read();
+        for (std::uint64_t i = 0x1; ; ++i) {
+            result.reads = i;
+            std::uint64_t current = Read();
+            if (current < previous) ++result.backwards;
+            else if (current > previous) {
+                step = std::min(step, current - previous);
+                ++changes;
+            }
+            previous = current;
+
+            if (i >= calls && changes >= 0x100) break;
+            if ((i & 0x3FF) == 0x0 && cube::tsc_clock::ticks() > deadline) break;
+        }
+
+        if (changes) result.granularity_ns = source.ticks ? ticks_to_ns(static_cast<double>(step)) : static_cast<double>(step);
+        timespec resolution { };
+        if (source.clock_id >= 0x0 && clock_getres(source.clock_id, &resolution) == 0x0) {
+            result.resolution_ns = static_cast<double>(resolution.tv_sec) * 1e9 + static_cast<double>(resolution.tv_nsec);
+        }
+        return result;
+    }
+
+    /* REALTIME may be stepped by NTP or settimeofday, a backward step there is not a clock fault */
+    constexpr clock_source source_table[] {
+        { "rdtsc", "rdtsc", read_rdtsc, measure<read_rdtsc>, -0x1, true, true },
+        { "rdtscp", "rdtscp", read_rdtscp, measure<read_rdtscp>, -0x1, true, true },
+        { "lfence+rdtsc", "lf+tsc", read_lfence_rdtsc, measure<read_lfence_rdtsc>, -0x1, true, true },
+        { "CLOCK_MONOTONIC", "mono", read_clock<CLOCK_MONOTONIC>, measure<read_clock<CLOCK_MONOTONIC>>, CLOCK_MONOTONIC, false, true },
+        { "CLOCK_MONOTONIC_RAW", "raw", read_clock<CLOCK_MONOTONIC_RAW>, measure<read_clock<CLOCK_MONOTONIC_RAW>>, CLOCK_MONOTONIC_RAW, false, true },
+        { "CLOCK_MONOTONIC_COARSE", "mono_c", read_clock<CLOCK_MONOTONIC_COARSE>, measure<read_clock<CLOCK_MONOTONIC_COARSE>>,
+          CLOCK_MONOTONIC_COARSE, false, true },
+        { "CLOCK_BOOTTIME", "boot", read_clock<CLOCK_BOOTTIME>, measure<read_clock<CLOCK_BOOTTIME>>, CLOCK_BOOTTIME, false, true },
+        { "CLOCK_REALTIME", "real", read_clock<CLOCK_REALTIME>, measure<read_clock<CLOCK_REALTIME>>, CLOCK_REALTIME, false, false },
+        { "CLOCK_REALTIME_COARSE", "real_c", read_clock<CLOCK_REALTIME_COARSE>, measure<read_clock<CLOCK_REALTIME_COARSE>>,
+          CLOCK_REALTIME_COARSE, false, false },
+        { "steady_clock", "steady", read_chrono<std::chrono::steady_clock>, measure<read_chrono<std::chrono::steady_clock>>,
+          -0x1, false, true },
+        { "high_resolution_clock", "hires", read_chrono<std::chrono::high_resolution_clock>,
+          measure<read_chrono<std::chrono::high_resolution_clock>>, -0x1, false, std::chrono::high_resolution_clock::is_steady },
+    };
+}
+
+auto clock_report::at(std::size_t cpu, std::size_t source) const -> clock_result const & {
+    return results[cpu * clocks::sources().size() + source];
+}
+
+/**
+ * \brief Every clock of the suite, in report order
+ */
+auto clocks::sources() -> std::span<clock_source const> {
+    return source_table;
+}
+
+/**
+ * \brief The kernel clocksource clock_gettime is built on
+ * @return e.g. "tsc", "kvm-clock", "hpet"; empty when sysfs does not say
+ */
+auto clocks::current_source() -> std::string {
+    proc_file current(CLOCKSOURCE_SYSFS "/current_clocksource", 0x40);
+    return std::string(proc_scanner(current.read()).next_word());
+}
+
+/**
+ * \brief Pins to every online CPU in turn and measures every source there
+ * @param calls Readings per timed loop
+ * @return report, CPUs that could not be pinned are left out
+ */
+auto clocks::run(std::size_t calls) -> clock_report {
+    clock_report report;
+    report.clocksource = clocks::current_source();
+    proc_file listing(CLOCKSOURCE_SYSFS "/available_clocksource", 0x100);
+    std::string_view available = listing.read();
+    while (!available.empty() && (available.back() == '\n' || available.back() == ' ')) available.remove_suffix(0x1);
+    report.available = available;
+
+    cpu_set_t original;
+    sched_getaffinity(0x0, sizeof(original), &original);
+
+    for (int id : cpu::online_cpus()) {
+        if (!cpu::pin_thread(id)) continue;
+        report.cpus.push_back(id);
+        for (clock_source const & source : clocks::sources()) report.results.push_back(source.measure(source, calls));
+    }
+
+    sched_setaffinity(0x0, sizeof(original), &original);
+    return report;
+}
+
+/**
+ * \brief Prints the call cost of every clock on every CPU, then granularity and monotonicity per clock
+ *      A clocksource other than tsc is flagged: the vDSO then falls back to a slower clock or a system call
+ * @param report Output of run()
+ * @return 0x0, or 0x1 when the clocksource is not tsc or a monotonic clock went backwards (usable by scripts)
+ */
+auto clocks::print(clock_report const & report) -> int {
+    std::span<clock_source const> const all = clocks::sources();
+    bool healthy = true;
+
+    std::printf("Clocksource %s (available: %s)\n", report.clocksource.empty() ? "unknown" : report.clocksource.c_str(),
+                report.available.empty() ? "unknown" : report.available.c_str());
+    if (!report.clocksource.empty() && report.clocksource != "tsc") {
+        std::printf("WARNING: clocksource is not tsc, clock_gettime and std::chrono may leave the vDSO for a system call "
+                    "(echo tsc > %s/current_clocksource if tsc is listed)\n", CLOCKSOURCE_SYSFS);
+        healthy = false;
+    }
+
+    std::printf("\nCall cost in ns\n%5s", "CPU");
+    for (clock_source const & source : all) std::printf(" %7s", source.label);
+    std::printf("\n");
+    for (std::size_t i = 0x0; i < report.cpus.size(); ++i) {
+        std::printf("%5d", report.cpus[i]);
+        for (std::size_t k = 0x0; k < all.size(); ++k) std::printf(" %7.1f", report.at(i, k).cost_ns);
+        std::printf("\n");
+    }
+
+    std::printf("\n%-24s %9s %9s %12s %12s %10s\n", "Clock", "Min ns", "Max ns", "Step ns", "Res ns", "Backwards");
+    for (std::size_t k = 0x0; k < all.size(); ++k) {
+        double low = std::numeric_limits<double>::max(), high = 0.0, step = 0.0;
+        std::uint64_t backwards = 0x0;
+        for (std::size_t i = 0x0; i < report.cpus.size(); ++i) {
+            clock_result const & result = report.at(i, k);
+            low = std::min(low, result.cost_ns);
+            high = std::max(high, result.cost_ns);
+            step = std::max(step, result.granularity_ns);
+            backwards += result.backwards;
+        }
+        if (report.cpus.empty()) low = 0.0;
+        if (all[k].monotonic && backwards) healthy = false;
+
+        double resolution = report.cpus.empty() ? -1.0 : report.at(0x0, k).resolution_ns;
+        std::printf("%-24s %9.1f %9.1f %12.1f ", all[k].name, low, high, step);
+        if (resolution < 0.0) std::printf("%12s", "-");
+        else std::printf("%12.0f", resolution);
+        std::printf(" %10llu%s\n", static_cast<unsigned long long>(backwards), all[k].monotonic && backwards ? "  NOT MONOTONIC" : "");
+    }
+    return healthy ? 0x0 : 0x1;
+}
@@ -0,0 +1,70 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_CLOCKS_HPP
+#define CUBE_CLOCKS_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define CLOCKSOURCE_SYSFS "/sys/devices/system/clocksource/clocksource0"
+
+/**
+ * \brief Measured properties of one clock on one CPU, everything in nanoseconds
+ *      granularity is the smallest non-zero step between consecutive readings, resolution what clock_getres
+ *      reports (negative for the TSC instructions and the std::chrono clocks)
+ */
+struct clock_result {
+    double cost_ns { 0.0 };
+    double granularity_ns { 0.0 };
+    double resolution_ns { -1.0 };
+    std::uint64_t backwards { 0x0 };
+    std::uint64_t reads { 0x0 };
+};
+
+/**
+ * \brief One way of reading the time
+ *      read returns TSC ticks when ticks is set and nanoseconds otherwise; measure is the same reader
+ *      instantiated into the measuring loop, so the loop pays no indirect call per reading
+ */
+struct clock_source {
+    char const * name;
+    char const * label;
+    auto (* read)() noexcept -> std::uint64_t;
+    auto (* measure)(clock_source const & source, std::size_t calls) -> clock_result;
+    int clock_id;
+    bool ticks;
+    bool monotonic;
+};
+
+/**
+ * \brief Results of every source on every CPU, results[cpu index * sources + source index]
+ */
+struct clock_report {
+    std::vector<int> cpus;
+    std::vector<clock_result> results;
+    std::string clocksource;
+    std::string available;
+
+    [[nodiscard]] auto at(std::size_t cpu, std::size_t source) const -> clock_result const &;
+};
+
+/**
+ * \brief Timestamping cost suite: rdtsc, rdtscp, lfence+rdtsc, the clock_gettime clocks and the std::chrono clocks,
+ *      measured on every online CPU. clock_gettime only stays in the vDSO while the kernel clocksource can be read
+ *      from user space (tsc); with hpet or acpi_pm every call becomes a system call
+ */
+class clocks {
+public:
+    static auto sources() -> std::span<clock_source const>;
+    static auto current_source() -> std::string;
+    static auto run(std::size_t calls) -> clock_report;
+    static auto print(clock_report const & report) -> int;
+};
+
+#endif //CUBE_CLOCKS_HPP
@@ -11,30 +11,32 @@
 #include <cstring>
 #include <fstream>
 #include <filesystem>
-#include <sensors/sensors.h>
-#include <x86intrin.h>
+#include <sched.h>
+#include <unistd.h>
 
 #include "architecture.hpp"
+#include "cache.hpp"
+#include "cpuid.hpp"
+#include "dispatch.hpp"
+#include "features.hpp"
+#include "procfs.hpp"
+#include "sampler.hpp"
+#include "thermal.hpp"
+#include "topology.hpp"
 
 #ifdef UNIX
 #include "cpu.hpp"
 #endif
 
 /**
- * \brief "mov $0x0, %eax" will return the processor's manufacture string
- *             and highest function parameters possible (EAX=0)
+ * \brief CPUID leaf 0 (EAX=0) returns the processor's manufacture string in EBX, EDX, ECX
+ *             and the highest function parameter possible in EAX
  * @return ID of the vendor (GenuineIntel) for example
  */
 auto cpu::vendor_id() -> std::string {
-#if defined(X86)
-    __asm__ __volatile__ ("mov $0x0, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::vendor_output[0x0]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::vendor_output[0x1]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::vendor_output[0x2]));
-
-    return std::string{ (const char *)cpu::vendor_output };
-#endif
+    cpuid_regs regs = cpuid_snapshot::get().query(0x0);
+    std::uint32_t vendor[0x3] = { regs.ebx, regs.edx, regs.ecx };
+    return { reinterpret_cast<char const *>(vendor), sizeof(vendor) };
 }
 
 #if defined(X86)
@@ -89,17 +91,6 @@ auto cpu::format_SI(double interval, int width, char unit) -> std::string {
     return os.str();
 }
 
-/**
- * \brief Reads cycle count with assembly instruction
- * \code __asm__ __volatile__ ("rdtsc" : "=a" (some_variable), "=d" (some_other_variable))
- *                                          equals
- * \code __rdtsc() function
- * @return value returned from cpu after instruction
- */
-inline auto cpu::read_cycle_count()-> std::uint64_t {
-    return __rdtsc();
-}
-
 /**
  * \brief Measures time stamp counter tick with steady_clock
  *          as documentation recommends it against hrtime
@@ -133,18 +124,11 @@ auto cpu::measure_TSC_tick() -> double {
  * @return boolean value
  */
 auto cpu::supports_invariantTSC() -> bool {
-    __asm__ __volatile__ ("mov $0x80000007, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::invariantTSC[0x0]));
-    __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::invariantTSC[0x1]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::invariantTSC[0x2]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::invariantTSC[0x3]));
-
-    return (cpu::invariantTSC[0x3] & (0x1 << 0x8)) != 0x0;
+    return cpu_features::supported().has(feature::invariant_tsc);
 }
 
 /**
- * \brief Extract the value from CPUID information
+ * \brief Extract the value from CPUID information, silently fails when the leaf is missing or empty
  * “TSC frequency” = “core crystal clock frequency” * EBX/EAX
  * EAX Bits 31 - 00: An unsigned integer which is the denominator of the TSC/”core crystal clock” ratio
  * EBX Bits 31 - 00: An unsigned integer which is the numerator of the TSC/”core crystal clock” ratio
@@ -154,70 +138,56 @@ auto cpu::supports_invariantTSC() -> bool {
  * @return boolean value
  */
 auto cpu::extract_leaf_15H(double * time) -> bool {
-    __asm__ __volatile__ ("mov $0x0, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::leaf_extract[0x0]));
-    __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::leaf_extract[0x1]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::leaf_extract[0x2]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::leaf_extract[0x3]));
-
-    if (cpu::leaf_extract[0x0] < 0x15) {
-        std::cout << "cpuid leaf 15H is not supported" << std::endl;
-        return false;
-    }
-
-    __asm__ __volatile__ ("xor %eax, %eax\n\t");
-    __asm__ __volatile__ ("xor %ebx, %ebx\n\t");
-    __asm__ __volatile__ ("xor %ecx, %ecx\n\t");
-    __asm__ __volatile__ ("xor %edx, %edx\n\t");
-
-    __asm__ __volatile__ ("mov $0x15, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::leaf_extract[0x0]));
-    __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::leaf_extract[0x1]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::leaf_extract[0x2]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::leaf_extract[0x3]));
-
-    if (cpu::leaf_extract[0x1] == 0x0 || cpu::leaf_extract[0x2] == 0x0) {
-        std::cout << "cpuid leaf 15H does not give frequency" << std::endl;
-        return false;
-    }
+    cpuid_snapshot const & snapshot = cpuid_snapshot::get();
+    if (snapshot.max_leaf() < 0x15) return false;
 
-    double core_crystal_frequency = cpu::leaf_extract[0x2];
-    *time = cpu::leaf_extract[0x0] / (cpu::leaf_extract[0x1] * core_crystal_frequency);
-    printf("cpuid leaf 15H: coreCrystal = %g, eax=%u, ebx=%u, ecx=%u "
-           "=> %s\n",
-           core_crystal_frequency,
-           cpu::leaf_extract[0x0],
-           cpu::leaf_extract[0x1],
-           cpu::leaf_extract[0x2],
+    cpuid_regs leaf = snapshot.query(0x15);
+    if (leaf.eax == 0x0 || leaf.ebx == 0x0 || leaf.ecx == 0x0) return false;
 
-           cpu::format_SI(*time, 0x9, 's').c_str());
+    double core_crystal_frequency = leaf.ecx;
+    *time = leaf.eax / (leaf.ebx * core_crystal_frequency);
     return true;
 }
 
 /**
- * \brief Try to extract hardware tick from the brand string
+ * \brief Reads the 48 byte processor brand string from CPUID leaves 80000002H through 80000004H
+ * @return brand string without the trailing padding, empty when the leaves are not supported
+ */
+auto cpu::brand_string() -> std::string {
+    cpuid_snapshot const & snapshot = cpuid_snapshot::get();
+    if (snapshot.max_extended_leaf() < 0x80000004) return { };
+
+    cpuid_regs regs[0x3];
+    for (std::uint32_t leaf = 0x0; leaf < 0x3; ++leaf) regs[leaf] = snapshot.query(0x80000002 + leaf);
+
+    std::string brand(reinterpret_cast<char const *>(regs), strnlen(reinterpret_cast<char const *>(regs), sizeof(regs)));
+    brand.erase(brand.find_last_not_of(' ') + 0x1);
+    return brand;
+}
+
+/**
+ * \brief Try to extract hardware tick from the brand string ("... @ 3.00GHz")
  * @param time
  * @return boolean value
  */
 auto cpu::read_HW_tick_from_name(double * time) -> bool {
-    std::string model_name = cpu::vendor_id();
+    std::string model_name = cpu::brand_string();
 
-    if (model_name.find("Apple") != std::string::npos) return false;
+    if (model_name.size() < 0x4 || model_name.find("Apple") != std::string::npos) return false;
 
     char const * model = model_name.c_str();
-    char const * end = model + std::strlen(model) - 0x3;
+    char const * end = model + model_name.size() - 0x3;
     std::uint64_t multiplier;
     if (*end == 'M') multiplier = 1000LL * 1000LL;
     else if (*end == 'G') multiplier = 1000LL * 1000LL * 1000LL;
     else if (*end == 'T') multiplier = 1000LL * 1000LL * 1000LL * 1000LL;
     else return false;
 
-    while (*end != ' ' && end >= model) end--;
+    while (end > model && *end != ' ') end--;
+    if (*end == ' ') end++;
 
     char * uninteresting;
-    double freq = strtod(end + 0x1, &uninteresting);
+    double freq = strtod(end, &uninteresting);
     
     if (freq == 0.0) return false;
 
@@ -284,245 +254,100 @@ auto cpu::read_HW_tick_from_name(double * time) -> bool {
  *             Also checks Hyper-Threading support
  */
 [[maybe_unused]] auto cpu::get_both_cores() -> void {
-    __asm__ __volatile__ ("mov $0x1, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::cores_register[0x0]));
-    __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::cores_register[0x1]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::cores_register[0x2]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::cores_register[0x3]));
-
-    std::uint32_t cpu_features = cpu::cores_register[0x3];
-    std::uint32_t logical_cores = (cpu::cores_register[0x1] >> 0x10) & 0xff;
-    std::cout << "Logical: " << logical_cores << std::endl;
-    std::uint32_t physical_cores = logical_cores;
-
-    if (cpu::vendor_id() == "GenuineIntel") {
-        __asm__ __volatile__ ("xor %eax, %eax\n\t");
-        __asm__ __volatile__ ("xor %ebx, %ebx\n\t");
-        __asm__ __volatile__ ("xor %ecx, %ecx\n\t");
-        __asm__ __volatile__ ("xor %edx, %edx\n\t");
-
-        __asm__ __volatile__ ("mov $0x4, %eax\n\t");
-        __asm__ __volatile__ ("cpuid\n\t");
-        __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::cores_register[0x0]));
-        __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::cores_register[0x1]));
-        __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::cores_register[0x2]));
-        __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::cores_register[0x3]));
-
-        physical_cores = ((std::uint32_t)(cpu::cores_register[0x0] >> 0x1A) & 0x3f) + 0x1;
-
-    } else if (cpu::vendor_id() == "AuthenticAMD") {
-        __asm__ __volatile__ ("xor %eax, %eax\n\t");
-        __asm__ __volatile__ ("xor %ebx, %ebx\n\t");
-        __asm__ __volatile__ ("xor %ecx, %ecx\n\t");
-        __asm__ __volatile__ ("xor %edx, %edx\n\t");
-
-        __asm__ __volatile__ ("mov $0x80000008, %eax\n\t");
-        __asm__ __volatile__ ("cpuid\n\t");
-        __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::cores_register[0x0]));
-        __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::cores_register[0x1]));
-        __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::cores_register[0x2]));
-        __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::cores_register[0x3]));
-        physical_cores = ((std::uint32_t)(cpu::cores_register[0x2] & 0xff)) + 0x1;
-    }
+    cpu_topology layout = topology::enumerate();
+    std::size_t physical_cores = layout.core_count();
 
+    std::cout << "Logical: " << layout.cpus.size() << std::endl;
     std::cout << "Physical: " << physical_cores << std::endl;
+    std::cout << "Sockets: " << layout.packages.size() << std::endl;
 
-    bool has_hyper_threads = cpu_features & (0x1 << 0x1C) && physical_cores < logical_cores;
+    bool has_hyper_threads = physical_cores < layout.cpus.size();
     std::cout << "Hyper-Threads: " << (has_hyper_threads ? "true" : "false") << std::endl;
 }
 #endif
 
 /**
- * \brief "mov $0x1 , %eax" will give processor features
- *             and model related information (EAX=1)
+ * \brief Reports the cpu usage from "/proc/stat" without blocking
+ *      The first call starts the background sampler, later calls only read its newest frame
+ * @return CPU usage as string using std::to_string() method
  */
-auto cpu::instruction_set_checker() -> void {
-#if defined(X86)
-    __asm__ __volatile__ ("mov $0x1, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::instruction_detection[0x2]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::instruction_detection[0x0]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::instruction_detection[0x1]));
-
-    instruction_set::instructions["SSE3"] = (cpu::instruction_detection[0x0] & (0x1 << 0x0)) != 0x0;
-    instruction_set::instructions["PCLMUL"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1)) != 0x0;
-    instruction_set::instructions["DTES64"] = (cpu::instruction_detection[0x0] & (0x1 << 0x2)) != 0x0;
-    instruction_set::instructions["MONITOR"] = (cpu::instruction_detection[0x0] & (0x1 << 0x3)) != 0x0;
-    instruction_set::instructions["DS_CPL"] = (cpu::instruction_detection[0x0] & (0x1 << 0x4)) != 0x0;
-    instruction_set::instructions["VMX"] = (cpu::instruction_detection[0x0] & (0x1 << 0x5)) != 0x0;
-    instruction_set::instructions["SMX"] = (cpu::instruction_detection[0x0] & (0x1 << 0x6)) != 0x0;
-    instruction_set::instructions["EST"] = (cpu::instruction_detection[0x0] & (0x1 << 0x7)) != 0x0;
-    instruction_set::instructions["TM2"] = (cpu::instruction_detection[0x0] & (0x1 << 0x8)) != 0x0;
-    instruction_set::instructions["SSSE3"] = (cpu::instruction_detection[0x0] & (0x1 << 0x9)) != 0x0;
-    instruction_set::instructions["CID"] = (cpu::instruction_detection[0x0] & (0x1 << 0xA)) != 0x0;
-    instruction_set::instructions["SDBG"] = (cpu::instruction_detection[0x0] & (0x1 << 0xB)) != 0x0;
-    instruction_set::instructions["FMA"] = (cpu::instruction_detection[0x0] & (0x1 << 0xC)) != 0x0;
-    instruction_set::instructions["CX16"] = (cpu::instruction_detection[0x0] & (0x1 << 0xD)) != 0x0;
-    instruction_set::instructions["XTPR"] = (cpu::instruction_detection[0x0] & (0x1 << 0xE)) != 0x0;
-    instruction_set::instructions["PDCM"] = (cpu::instruction_detection[0x0] & (0x1 << 0xF)) != 0x0;
-    instruction_set::instructions["PCID"] = (cpu::instruction_detection[0x0] & (0x1 << 0x11)) != 0x0;
-    instruction_set::instructions["DCA"] = (cpu::instruction_detection[0x0] & (0x1 << 0x12)) != 0x0;
-    instruction_set::instructions["SSE4_1"] = (cpu::instruction_detection[0x0] & (0x1 << 0x13)) != 0x0;
-    instruction_set::instructions["SSE4_2"] = (cpu::instruction_detection[0x0] & (0x1 << 0x14)) != 0x0;
-    instruction_set::instructions["X2APIC"] = (cpu::instruction_detection[0x0] & (0x1 << 0x15)) != 0x0;
-    instruction_set::instructions["MOVBE"] = (cpu::instruction_detection[0x0] & (0x1 << 0x16)) != 0x0;
-    instruction_set::instructions["POPCNT"] = (cpu::instruction_detection[0x0] & (0x1 << 0x17)) != 0x0;
-    instruction_set::instructions["TSC"] = (cpu::instruction_detection[0x0] & (0x1 << 0x18)) != 0x0;
-    instruction_set::instructions["AES"] = (cpu::instruction_detection[0x0] & (0x1 << 0x19)) != 0x0;
-    instruction_set::instructions["XSAVE"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1A)) != 0x0;
-    instruction_set::instructions["OSXSAVE"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1B)) != 0x0;
-    instruction_set::instructions["AVX"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1C)) != 0x0;
-    instruction_set::instructions["F16C"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1D)) != 0x0;
-    instruction_set::instructions["RDRAND"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1E)) != 0x0;
-    instruction_set::instructions["Hyper-Visor"] = (cpu::instruction_detection[0x0] & (0x1 << 0x1F)) != 0x0;
-
-    instruction_set::instructions["FPU"] = (cpu::instruction_detection[0x1] & (0x1 << 0x0)) != 0x0;
-    instruction_set::instructions["VME"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1)) != 0x0;
-    instruction_set::instructions["DE"] = (cpu::instruction_detection[0x1] & (0x1 << 0x2)) != 0x0;
-    instruction_set::instructions["PSE"] = (cpu::instruction_detection[0x1] & (0x1 << 0x3)) != 0x0;
-    instruction_set::instructions["MSR"] = (cpu::instruction_detection[0x1] & (0x1 << 0x5)) != 0x0;
-    instruction_set::instructions["PAE"] = (cpu::instruction_detection[0x1] & (0x1 << 0x6)) != 0x0;
-    instruction_set::instructions["MCE"] = (cpu::instruction_detection[0x1] & (0x1 << 0x7)) != 0x0;
-    instruction_set::instructions["CX8"] = (cpu::instruction_detection[0x1] & (0x1 << 0x8)) != 0x0;
-    instruction_set::instructions["APIC"] = (cpu::instruction_detection[0x1] & (0x1 << 0x9)) != 0x0;
-    instruction_set::instructions["SEP"] = (cpu::instruction_detection[0x1] & (0x1 << 0xB)) != 0x0;
-    instruction_set::instructions["MTRR"] = (cpu::instruction_detection[0x1] & (0x1 << 0xC)) != 0x0;
-    instruction_set::instructions["PGE"] = (cpu::instruction_detection[0x1] & (0x1 << 0xD)) != 0x0;
-    instruction_set::instructions["MCA"] = (cpu::instruction_detection[0x1] & (0x1 << 0xE)) != 0x0;
-    instruction_set::instructions["CMOV"] = (cpu::instruction_detection[0x1] & (0x1 << 0xF)) != 0x0;
-    instruction_set::instructions["PAT"] = (cpu::instruction_detection[0x1] & (0x1 << 0x10)) != 0x0;
-    instruction_set::instructions["PSE36"] = (cpu::instruction_detection[0x1] & (0x1 << 0x11)) != 0x0;
-    instruction_set::instructions["PSN"] = (cpu::instruction_detection[0x1] & (0x1 << 0x12)) != 0x0;
-    instruction_set::instructions["CLFLUSH"] = (cpu::instruction_detection[0x1] & (0x1 << 0x13)) != 0x0;
-    instruction_set::instructions["DS"] = (cpu::instruction_detection[0x1] & (0x1 << 0x13)) != 0x0;
-    instruction_set::instructions["DS"] = (cpu::instruction_detection[0x1] & (0x1 << 0x15)) != 0x0;
-    instruction_set::instructions["ACPI"] = (cpu::instruction_detection[0x1] & (0x1 << 0x16)) != 0x0;
-    instruction_set::instructions["MMX"] = (cpu::instruction_detection[0x1] & (0x1 << 0x17)) != 0x0;
-    instruction_set::instructions["FXSR"] = (cpu::instruction_detection[0x1] & (0x1 << 0x18)) != 0x0;
-    instruction_set::instructions["SSE"] = (cpu::instruction_detection[0x1] & (0x1 << 0x19)) != 0x0;
-    instruction_set::instructions["SSE2"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1A)) != 0x0;
-    instruction_set::instructions["SS"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1B)) != 0x0;
-    instruction_set::instructions["HTT"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1C)) != 0x0;
-    instruction_set::instructions["TM"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1D)) != 0x0;
-    instruction_set::instructions["IA64"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1E)) != 0x0;
-    instruction_set::instructions["PBE"] = (cpu::instruction_detection[0x1] & (0x1 << 0x1F)) != 0x0;
-
-#endif
+auto cpu::cpu_percentage() -> std::string {
+    if (!sampler::running()) sampler::start();
+    return std::to_string(sampler::aggregate());
 }
 
 /**
- * \brief Calculates the cpu usage from "/proc/cpuinfo" file
- * @return CPU usage as string using std::to_string() method
+ * \brief Prints every cache level with size, geometry and the logical CPUs sharing it
+ *      (CPUID leaf 4 on Intel, 8000001DH or 80000005H/80000006H on AMD)
  */
-auto cpu::cpu_percentage() -> std::string {
-    std::ifstream stat_file(CPU_STAT);
-    if (!stat_file.is_open()) cpu::fatal_error("Error: Failed to open /proc/stat");
-    std::string line;
-    std::getline(stat_file, line);
-
-    std::istringstream iss(line);
-    std::string token;
-    iss >> token;
-
-    ll user = 0x0, nice = 0x0, system = 0x0, idle = 0x0, iowait = 0x0, irq = 0x0,
-            softirq = 0x0, steal = 0x0, guest = 0x0, guest_nice = 0x0;
-    iss >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal >> guest >> guest_nice;
-
-    ll total_time = user + nice + system + idle + iowait + irq + softirq + steal;
-    ll idle_time = idle + iowait;
-
-    stat_file.close();
-
-    std::this_thread::sleep_for(std::chrono::seconds(0x1));
-
-    stat_file.open(CPU_STAT);
-    std::getline(stat_file, line);
-
-    std::istringstream iss2(line);
-    iss2 >> token;
-    iss2 >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal >> guest >> guest_nice;
-
-    ll total_time_2 = user + nice + system + idle + iowait + irq + softirq + steal;
-    ll idle_time_2 = idle + iowait;
-
-    stat_file.close();
+[[maybe_unused]] auto cpu::get_cache_info() -> void {
+    cache_hierarchy::print(cache_hierarchy::enumerate());
+}
 
-    double usage = (double)(total_time_2 - total_time - (idle_time_2 - idle_time))
-                   / (double)(total_time_2 - total_time) * 0x64;
+/**
+ * \brief Reads the APIC ID of the CPU the calling thread currently runs on
+ *      Prefers the 32 bit x2APIC ID from leaf 0BH, falls back to the 8 bit initial APIC ID of leaf 1
+ * @return APIC ID, only meaningful while the thread is pinned
+ */
+auto cpu::apic_id() -> std::uint32_t {
+    if (cpuid_snapshot::live(0x0).eax >= 0xB) {
+        cpuid_regs leaf = cpuid_snapshot::live(0xB);
+        if (leaf.ebx != 0x0) return leaf.edx;
+    }
+    return cpuid_snapshot::live(0x1).ebx >> 0x18;
+}
 
-    return std::to_string(usage);
+/**
+ * \brief Pins the calling thread to one logical CPU
+ * @param cpu Logical CPU number
+ * @return false when the CPU does not exist or is outside the allowed set
+ */
+auto cpu::pin_thread(int cpu) -> bool {
+    if (cpu < 0x0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0x0, sizeof(set), &set) == 0x0;
 }
 
 /**
- * \brief Gets information about cache size (L1, L2, L3) from CPUID leaf 0x80000006H
- * \attention For now it only finds the L2 cache size
- *      and also it cannot calculate how many instances does the L2 has
+ * \brief Lists the online logical CPUs from "/sys/devices/system/cpu/online"
+ * @return CPU numbers, every configured CPU when the file is missing
  */
-[[maybe_unused]] auto cpu::get_cache_info() -> void {
-    __asm__ __volatile__ ("mov $0x80000006, %eax\n\t");
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t" : "=r" (cpu::cache[0x2]));
+auto cpu::online_cpus() -> std::vector<int> {
+    proc_file online(CPU_ONLINE, 0x100);
+    std::vector<int> cpus = proc_scanner(online.read()).next_cpu_list();
 
-    std::uint32_t l2_cache_size = (cpu::cache[0x2] >> 0x10) & 0xffff;
-    std::cout << "L2 cache size: " << l2_cache_size << "KB" << std::endl;
+    if (cpus.empty()) {
+        long configured = sysconf(_SC_NPROCESSORS_CONF);
+        for (int id = 0x0; id < configured; ++id) cpus.push_back(id);
+    }
+    return cpus;
 }
 
 /**
  * \brief Prints the thermal sensor information for CPU using sensors library
- * @return thermal state in Celsius
+ *      The libsensors session is opened once, later calls only re-read the cached inputs
+ * @return hottest package temperature in Celsius, "N/A" when there is no sensor
  */
 auto cpu::print_thermal_state() -> std::string {
-    sensors_init(nullptr);
-
-    double _temp;
-    int nr = 0x0;
-    sensors_chip_name const * chip;
-
-    while ((chip = sensors_get_detected_chips(nullptr, &nr))) {
-        int nr_second = 0x0;
-        sensors_feature const * feature;
-
-        while ((feature = sensors_get_features(chip, &nr_second))) {
-            if (std::string(feature->name) == "temp1") {
-                double temp;
-                sensors_get_value(chip, feature->number, &temp);
-                _temp = temp;
-                break;
-            }
-        }
-    }
+    if (!thermal::init() || thermal::refresh() == 0x0) return "N/A";
+
+    thermal_channel const * channel = thermal::package();
+    if (!channel) return "N/A";
 
-    sensors_cleanup();
-    return std::to_string(_temp).substr(0x0, 0x2).append(" °C");
+    char buffer[0x10];
+    std::snprintf(buffer, sizeof(buffer), "%.1f", channel->celsius);
+    return std::string(buffer).append(" °C");
 }
 
 /**
  * \brief Prints instructions from instruction set
  */
 [[maybe_unused]] auto cpu::print_instructions() -> void {
-    std::uint64_t counter = 0x0;
-    cpu::instruction_set_checker();
-    for (auto const & elements : instruction_set::instructions) {
-        if (counter == 0x5) {
-            std::cout << std::endl;
-            counter = 0x0;
-        }
-
-        std::cout << " [ " << elements.first;
-        switch (elements.first.size()) {
-            case 0x2: std::cout << "          "; break;
-            case 0x3: std::cout << "         "; break;
-            case 0x4: std::cout << "        "; break;
-            case 0x5: std::cout << "       "; break;
-            case 0x6: std::cout << "      "; break;
-            case 0x7: std::cout << "     "; break;
-            case 0xB: std::cout << " "; break;
-        }
-        std::cout << ((elements.second) ? "[Y] ]" : "[N] ]");
-        counter++;
-    }
-    std::cout << std::endl;
+    cpu_features::print();
+    std::cout << "SIMD dispatch level: " << cube::isa::name(cube::isa::current())
+              << " (detected " << cube::isa::name(cube::isa::detected()) << ")" << std::endl;
 }
 
 /**
@@ -531,20 +356,14 @@ auto cpu::print_thermal_state() -> std::string {
  */
 auto cpu::model_name(std::uint32_t eax_values) -> void {
 #if defined(X86)
-    switch (eax_values) {
-        case 0x1: __asm__ __volatile__ ("mov $0x80000002, %eax\n\t"); break;
-        case 0x2: __asm__ __volatile__ ("mov $0x80000003, %eax\n\t"); break;
-        case 0x3: __asm__ __volatile__ ("mov $0x80000004, %eax\n\t"); break;
-        default: std::cout << "Something went wrong" << std::endl; break;
+    if (eax_values < 0x1 || eax_values > 0x3) {
+        std::cout << "Something went wrong" << std::endl;
+        return;
     }
 
-    __asm__ __volatile__ ("cpuid\n\t");
-    __asm__ __volatile__ ("mov %%eax, %0\n\t":"=r" (cpu::register_output[0x0]));
-    __asm__ __volatile__ ("mov %%ebx, %0\n\t":"=r" (cpu::register_output[0x1]));
-    __asm__ __volatile__ ("mov %%ecx, %0\n\t":"=r" (cpu::register_output[0x2]));
-    __asm__ __volatile__ ("mov %%edx, %0\n\t":"=r" (cpu::register_output[0x3]));
-
-    std::cout << std::string{ (const char *)&cpu::register_output[0x0] };
+    cpuid_regs regs = cpuid_snapshot::get().query(0x80000001 + eax_values);
+    std::uint32_t const register_output[0x4] = { regs.eax, regs.ebx, regs.ecx, regs.edx };
+    std::cout << std::string(reinterpret_cast<char const *>(register_output), sizeof(register_output)).c_str();
 
 #else
     #include <fstream>
@@ -572,11 +391,6 @@ auto cpu::model_name(std::uint32_t eax_values) -> void {
  */
 [[maybe_unused]] auto cpu::get_cpu_id() -> void {
 #if defined(X86)
-    __asm__ __volatile__ ("xor %eax, %eax\n\t");
-    __asm__ __volatile__ ("xor %ebx, %ebx\n\t");
-    __asm__ __volatile__ ("xor %ecx, %ecx\n\t");
-    __asm__ __volatile__ ("xor %edx, %edx\n\t");
-
     for (std::uint32_t values { 0x1 }; values <= 0x3; ++values) cpu::model_name(values);
 #endif
 }
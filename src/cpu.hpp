@@ -7,38 +7,32 @@
 #ifndef CUBE_CPU_HPP
 #define CUBE_CPU_HPP
 
-#include <unordered_map>
+#include <string>
+#include <vector>
+#include <x86intrin.h>
 
 #define CPU_STAT "/proc/stat"
 #define CPU_INFO "/proc/cpuinfo"
+#define CPU_ONLINE "/sys/devices/system/cpu/online"
 
 typedef long long ll;
 
-struct instruction_set {
-    static inline std::unordered_map<std::string, bool> instructions;
-};
-
 class cpu {
 public:
-    static inline std::uint32_t cache[0x4];
-    static inline std::uint32_t leaf_extract[0x4];
-    static inline std::uint32_t invariantTSC[0x4];
-    static inline std::uint32_t vendor_output[0x3];
-    static inline std::uint32_t cores_register[0x4];
-    static inline std::uint32_t register_output[0xA];
-    static inline std::uint32_t instruction_detection[0x3];
-
     static auto vendor_id() -> std::string;
+    static auto apic_id() -> std::uint32_t;
+    static auto pin_thread(int cpu) -> bool;
+    static auto online_cpus() -> std::vector<int>;
+    static auto brand_string() -> std::string;
     static auto measure_TSC_tick() -> double;
     static auto supports_invariantTSC() -> bool;
     static auto cpu_percentage() -> std::string;
-    static auto instruction_set_checker() -> void;
     static auto print_thermal_state() -> std::string;
     [[maybe_unused]] static auto get_cpu_id() -> void;
     static auto extract_leaf_15H(double * time) -> bool;
     [[maybe_unused]] static auto get_both_cores() -> void;
     [[maybe_unused]] static auto get_cache_info() -> void;
-    static inline auto read_cycle_count()-> std::uint64_t;
+    static inline auto read_cycle_count()-> std::uint64_t { return __rdtsc(); }
     static auto model_name(std::uint32_t eax_values) -> void;
     [[maybe_unused]] static auto print_instructions() -> void;
     static auto read_HW_tick_from_name(double * time) -> bool;
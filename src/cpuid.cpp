@@ -0,0 +1,256 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+
+#include "cpuid.hpp"
+
+/**
+ * \brief Executes one cpuid instruction
+ *      All four registers are outputs and ECX is also an input, so the compiler knows
+ *      exactly which registers the instruction clobbers
+ * @param leaf Value for EAX
+ * @param subleaf Value for ECX
+ * @return register contents after the instruction
+ */
+static auto execute(std::uint32_t leaf, std::uint32_t subleaf) -> cpuid_regs {
+    cpuid_regs regs;
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__ ("cpuid"
+                          : "=a" (regs.eax), "=b" (regs.ebx), "=c" (regs.ecx), "=d" (regs.edx)
+                          : "a" (leaf), "c" (subleaf));
+#endif
+    return regs;
+}
+
+/**
+ * \brief Reads XCR0 with xgetbv, only valid once the OS set CR4.OSXSAVE (CPUID.1:ECX[27])
+ * @return enabled XSAVE state components
+ */
+static auto read_xcr0() -> std::uint64_t {
+    std::uint32_t low = 0x0, high = 0x0;
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__ ("xgetbv" : "=a" (low), "=d" (high) : "c" (0x0));
+#endif
+    return (static_cast<std::uint64_t>(high) << 0x20) | low;
+}
+
+/**
+ * \brief Number of subleaves worth recording for leaves that take ECX as input
+ * @param leaf Leaf number
+ * @param first Registers of subleaf 0x0
+ * @return subleaf count; 0x0 means "until the leaf reports an invalid/null subleaf"
+ */
+static auto subleaf_count(std::uint32_t leaf, cpuid_regs const & first) -> std::uint32_t {
+    switch (leaf) {
+        case 0x4: case 0xB: case 0x1F: case 0x8000001D: case 0x80000026: return 0x0;
+        case 0x7: case 0x14: case 0x17: case 0x18: case 0x1D: case 0x20: case 0x23: return std::min(first.eax, 0x3Fu) + 0x1;
+        case 0xD: return 0x40;
+        case 0xF: case 0x10: case 0x12: case 0x80000020: return 0x4;
+        default: return 0x1;
+    }
+}
+
+/**
+ * \brief Checks whether a subleaf is the terminating one of an enumerated leaf
+ * @param leaf Leaf number
+ * @param regs Registers of the subleaf
+ * @return boolean value
+ */
+static auto is_terminator(std::uint32_t leaf, cpuid_regs const & regs) -> bool {
+    switch (leaf) {
+        case 0x4: case 0x8000001D: return (regs.eax & 0x1F) == 0x0;
+        case 0xB: case 0x1F: return ((regs.ecx >> 0x8) & 0xFF) == 0x0;
+        case 0x80000026: return ((regs.ecx >> 0x8) & 0xFF) == 0x0 && regs.eax == 0x0;
+        default: return false;
+    }
+}
+
+/**
+ * \brief Records every leaf in [first, last] with its subleaves
+ * @param first First leaf of the range (0x0, 0x40000000 or 0x80000000)
+ * @param last Highest leaf the range reports
+ */
+auto cpuid_snapshot::capture_range(std::uint32_t first, std::uint32_t last) -> void {
+    for (std::uint32_t leaf = first; leaf <= last && leaf - first < 0x100; ++leaf) {
+        cpuid_regs regs = execute(leaf, 0x0);
+        std::uint32_t count = subleaf_count(leaf, regs);
+
+        if (count == 0x0) {
+            for (std::uint32_t subleaf = 0x0; subleaf < 0x40; ++subleaf) {
+                cpuid_regs sub = execute(leaf, subleaf);
+                table.push_back({ leaf, subleaf, sub });
+                if (is_terminator(leaf, sub)) break;
+            }
+        } else {
+            table.push_back({ leaf, 0x0, regs });
+            for (std::uint32_t subleaf = 0x1; subleaf < count; ++subleaf) {
+                cpuid_regs sub = execute(leaf, subleaf);
+                if (leaf == 0xD && subleaf > 0x1 && !(sub.eax | sub.ebx | sub.ecx | sub.edx)) continue;
+                table.push_back({ leaf, subleaf, sub });
+            }
+        }
+    }
+}
+
+/**
+ * \brief Sorts the table so lookups can binary search it
+ */
+auto cpuid_snapshot::finish() -> void {
+    std::sort(table.begin(), table.end(), [](cpuid_entry const & a, cpuid_entry const & b) {
+        return a.leaf != b.leaf ? a.leaf < b.leaf : a.subleaf < b.subleaf;
+    });
+}
+
+/**
+ * \brief Dumps all standard, hypervisor (when present) and extended leaves of the current CPU
+ * @return new snapshot
+ */
+auto cpuid_snapshot::capture() -> cpuid_snapshot {
+    cpuid_snapshot snapshot;
+
+    snapshot.capture_range(0x0, execute(0x0, 0x0).eax);
+
+    std::uint32_t features = execute(0x1, 0x0).ecx;
+    if ((features >> 0x1B) & 0x1) snapshot.enabled_xstate = read_xcr0();
+
+    bool hypervisor = (features >> 0x1F) & 0x1;
+    std::uint32_t hypervisor_max = execute(0x40000000, 0x0).eax;
+    if (hypervisor && hypervisor_max >= 0x40000000 && hypervisor_max < 0x40000100) {
+        snapshot.capture_range(0x40000000, hypervisor_max);
+    }
+
+    std::uint32_t extended_max = execute(0x80000000, 0x0).eax;
+    if (extended_max >= 0x80000000) snapshot.capture_range(0x80000000, extended_max);
+
+    snapshot.finish();
+    return snapshot;
+}
+
+/**
+ * \brief Reads a snapshot written by save() (or by "cpuid -r -1")
+ *      Lines that do not look like "0xLEAF 0xSUB: eax=0x... ebx=0x... ecx=0x... edx=0x..." are ignored
+ *      A dump carries no XCR0, so every state component leaf 0DH reports as supported is assumed
+ *      enabled (as Linux does), provided the dumped CPU had OSXSAVE set
+ * @param path File to read
+ * @return snapshot, std::nullopt when the file cannot be opened or holds no leaf 0
+ */
+auto cpuid_snapshot::load(std::string const & path) -> std::optional<cpuid_snapshot> {
+    std::ifstream file(path);
+    if (!file.is_open()) return std::nullopt;
+
+    cpuid_snapshot snapshot;
+    for (std::string line; std::getline(file, line); ) {
+        cpuid_entry entry;
+        if (std::sscanf(line.c_str(), " 0x%x 0x%x: eax=0x%x ebx=0x%x ecx=0x%x edx=0x%x",
+                        &entry.leaf, &entry.subleaf, &entry.regs.eax, &entry.regs.ebx,
+                        &entry.regs.ecx, &entry.regs.edx) == 0x6) {
+            snapshot.table.push_back(entry);
+        }
+    }
+
+    snapshot.finish();
+    if (!snapshot.has(0x0)) return std::nullopt;
+
+    if ((snapshot.query(0x1).ecx >> 0x1B) & 0x1) {
+        cpuid_regs state = snapshot.query(0xD);
+        snapshot.enabled_xstate = (static_cast<std::uint64_t>(state.edx) << 0x20) | state.eax;
+    }
+    return snapshot;
+}
+
+/**
+ * \brief Writes the snapshot in the "cpuid -r" raw format
+ * @param path Destination file
+ * @return false when the file cannot be written
+ */
+auto cpuid_snapshot::save(std::string const & path) const -> bool {
+    std::FILE * file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "CPU:\n");
+    for (cpuid_entry const & e : table) {
+        std::fprintf(file, "   0x%08x 0x%02x: eax=0x%08x ebx=0x%08x ecx=0x%08x edx=0x%08x\n",
+                     e.leaf, e.subleaf, e.regs.eax, e.regs.ebx, e.regs.ecx, e.regs.edx);
+    }
+    return std::fclose(file) == 0x0;
+}
+
+/**
+ * \brief Makes the given snapshot the process wide one, must happen before the first get()
+ * @param snapshot Snapshot to use instead of the live CPU
+ * @return false when get() already captured the live CPU
+ */
+auto cpuid_snapshot::install(cpuid_snapshot snapshot) -> bool {
+    bool installed = false;
+    std::call_once(cpuid_snapshot::created, [&] {
+        cpuid_snapshot::instance = std::make_unique<cpuid_snapshot const>(std::move(snapshot));
+        cpuid_snapshot::replayed = true;
+        installed = true;
+    });
+    return installed;
+}
+
+/**
+ * \brief Process wide snapshot, captured on first use unless one was installed
+ * @return snapshot that every CPUID accessor reads from
+ */
+auto cpuid_snapshot::get() -> cpuid_snapshot const & {
+    std::call_once(cpuid_snapshot::created, [] {
+        cpuid_snapshot::instance = std::make_unique<cpuid_snapshot const>(cpuid_snapshot::capture());
+    });
+    return *cpuid_snapshot::instance;
+}
+
+/**
+ * \brief Snapshot of the live processor, captured separately only when a dump was installed
+ * @return get() itself unless install() replaced it
+ */
+auto cpuid_snapshot::host() -> cpuid_snapshot const & {
+    cpuid_snapshot const & current = cpuid_snapshot::get();
+    if (!cpuid_snapshot::replayed) return current;
+    static cpuid_snapshot const live = cpuid_snapshot::capture();
+    return live;
+}
+
+auto cpuid_snapshot::find(std::uint32_t leaf, std::uint32_t subleaf) const -> cpuid_entry const * {
+    auto it = std::lower_bound(table.begin(), table.end(), std::make_pair(leaf, subleaf),
+                               [](cpuid_entry const & e, std::pair<std::uint32_t, std::uint32_t> const & key) {
+        return e.leaf != key.first ? e.leaf < key.first : e.subleaf < key.second;
+    });
+    return (it != table.end() && it->leaf == leaf && it->subleaf == subleaf) ? &*it : nullptr;
+}
+
+/**
+ * \brief Executes cpuid on the CPU the calling thread runs on, bypassing the snapshot
+ *      Only for per-CPU data (APIC IDs, hybrid core type) read while pinned to that CPU
+ * @param leaf Leaf number (EAX)
+ * @param subleaf Subleaf number (ECX)
+ * @return register contents
+ */
+auto cpuid_snapshot::live(std::uint32_t leaf, std::uint32_t subleaf) -> cpuid_regs {
+    return execute(leaf, subleaf);
+}
+
+/**
+ * \brief Looks up one leaf/subleaf
+ * @param leaf Leaf number (EAX)
+ * @param subleaf Subleaf number (ECX)
+ * @return recorded registers, all zero when the leaf was not recorded (as cpuid reports unsupported leaves)
+ */
+auto cpuid_snapshot::query(std::uint32_t leaf, std::uint32_t subleaf) const -> cpuid_regs {
+    cpuid_entry const * entry = find(leaf, subleaf);
+    return entry ? entry->regs : cpuid_regs { };
+}
+
+/**
+ * \brief Checks whether a leaf/subleaf was recorded
+ * @return boolean value
+ */
+auto cpuid_snapshot::has(std::uint32_t leaf, std::uint32_t subleaf) const -> bool {
+    return find(leaf, subleaf) != nullptr;
+}
@@ -0,0 +1,69 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_CPUID_HPP
+#define CUBE_CPUID_HPP
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+struct cpuid_regs {
+    std::uint32_t eax { 0x0 };
+    std::uint32_t ebx { 0x0 };
+    std::uint32_t ecx { 0x0 };
+    std::uint32_t edx { 0x0 };
+};
+
+struct cpuid_entry {
+    std::uint32_t leaf { 0x0 };
+    std::uint32_t subleaf { 0x0 };
+    cpuid_regs regs;
+};
+
+/**
+ * \brief Immutable dump of every standard, hypervisor and extended CPUID leaf (with subleaves)
+ *      The process wide snapshot is taken once, on first use, on whatever CPU the calling
+ *      thread runs on; per-CPU data such as APIC IDs still has to be read live while pinned.
+ *      A snapshot can be saved in the "cpuid -r" text format and replayed with install()
+ *      XCR0 (the register state the OS enabled) is captured alongside, since feature checks need it
+ *      host() always describes the processor the code runs on; decisions about which instructions to
+ *      execute or which MSRs to touch go by it rather than by a replayed get()
+ */
+class cpuid_snapshot {
+public:
+    static auto capture() -> cpuid_snapshot;
+    static auto load(std::string const & path) -> std::optional<cpuid_snapshot>;
+    static auto install(cpuid_snapshot snapshot) -> bool;
+    static auto get() -> cpuid_snapshot const &;
+    static auto host() -> cpuid_snapshot const &;
+    static auto live(std::uint32_t leaf, std::uint32_t subleaf = 0x0) -> cpuid_regs;
+
+    auto save(std::string const & path) const -> bool;
+    [[nodiscard]] auto query(std::uint32_t leaf, std::uint32_t subleaf = 0x0) const -> cpuid_regs;
+    [[nodiscard]] auto has(std::uint32_t leaf, std::uint32_t subleaf = 0x0) const -> bool;
+    [[nodiscard]] auto max_leaf() const -> std::uint32_t { return query(0x0).eax; }
+    [[nodiscard]] auto max_extended_leaf() const -> std::uint32_t { return query(0x80000000).eax; }
+    [[nodiscard]] auto entries() const -> std::vector<cpuid_entry> const & { return table; }
+    [[nodiscard]] auto xcr0() const -> std::uint64_t { return enabled_xstate; }
+
+private:
+    std::vector<cpuid_entry> table;
+    std::uint64_t enabled_xstate { 0x0 };
+
+    static inline std::once_flag created;
+    static inline std::unique_ptr<cpuid_snapshot const> instance;
+    static inline bool replayed { false };
+
+    auto capture_range(std::uint32_t first, std::uint32_t last) -> void;
+    auto find(std::uint32_t leaf, std::uint32_t subleaf) const -> cpuid_entry const *;
+    auto finish() -> void;
+};
+
+#endif //CUBE_CPUID_HPP
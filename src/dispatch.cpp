@@ -0,0 +1,132 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <mutex>
+#include <cstdlib>
+
+#include "dispatch.hpp"
+#include "features.hpp"
+
+namespace cube {
+    namespace {
+        /**
+         * \brief Kernels and the cap, created by the first kernel so it outlives every registered one
+         */
+        struct registry {
+            std::mutex lock;
+            std::vector<kernel_base *> kernels;
+            std::optional<isa_level> cap { std::getenv("CUBE_ISA") ? isa::parse(std::getenv("CUBE_ISA")) : std::nullopt };
+            bool initialized { false };
+        };
+
+        auto state() -> registry & {
+            static registry instance;
+            return instance;
+        }
+    }
+
+    /**
+     * \brief Highest level whose features are all runnable (supported by the live CPU, enabled by the OS
+     *      and, under --cpuid-replay, also present in the dump)
+     * @return detected level
+     */
+    auto isa::detected() -> isa_level {
+        static isa_level const level = [] {
+            constexpr feature_set v2 { feature::sse4_2, feature::ssse3, feature::popcnt };
+            constexpr feature_set v3 { feature::avx, feature::avx2, feature::fma, feature::bmi1, feature::bmi2,
+                                       feature::f16c, feature::movbe, feature::lzcnt };
+            constexpr feature_set v4 { feature::avx512f, feature::avx512bw, feature::avx512cd,
+                                       feature::avx512dq, feature::avx512vl };
+
+            feature_set const & usable = cpu_features::runnable();
+            if (!usable.contains(v2)) return isa_level::scalar;
+            if (!usable.contains(v3)) return isa_level::sse4_2;
+            if (!usable.contains(v4)) return isa_level::avx2;
+            return isa_level::avx512;
+        }();
+        return level;
+    }
+
+    /**
+     * \brief Level kernels dispatch to, the detected one lowered to the cap when there is one
+     * @return current level
+     */
+    auto isa::current() -> isa_level {
+        registry & r = state();
+        std::lock_guard guard(r.lock);
+        return r.cap ? std::min(*r.cap, isa::detected()) : isa::detected();
+    }
+
+    /**
+     * \brief Resolves every kernel for the current level, kernels constructed later resolve on construction
+     */
+    auto isa::initialize() -> void {
+        {
+            registry & r = state();
+            std::lock_guard guard(r.lock);
+            r.initialized = true;
+        }
+        isa::resolve_all();
+    }
+
+    /**
+     * \brief Caps the dispatch level, a cap above the detected level has no effect
+     * @param level Highest level kernels may use
+     */
+    auto isa::cap(isa_level level) -> void {
+        {
+            registry & r = state();
+            std::lock_guard guard(r.lock);
+            r.cap = level;
+        }
+        isa::resolve_all();
+    }
+
+    auto isa::name(isa_level level) -> std::string_view {
+        switch (level) {
+            case isa_level::scalar: return "scalar";
+            case isa_level::sse4_2: return "sse4.2";
+            case isa_level::avx2: return "avx2";
+            case isa_level::avx512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    /**
+     * \brief Inverse of name()
+     * @param text Level name
+     * @return level, std::nullopt for unknown names
+     */
+    auto isa::parse(std::string_view text) -> std::optional<isa_level> {
+        for (isa_level level : { isa_level::scalar, isa_level::sse4_2, isa_level::avx2, isa_level::avx512 }) {
+            if (text == isa::name(level)) return level;
+        }
+        return std::nullopt;
+    }
+
+    auto isa::add(kernel_base * kernel) -> void {
+        registry & r = state();
+        bool initialized;
+        {
+            std::lock_guard guard(r.lock);
+            r.kernels.push_back(kernel);
+            initialized = r.initialized;
+        }
+        if (initialized) kernel->resolve(isa::current());
+    }
+
+    auto isa::remove(kernel_base * kernel) -> void {
+        registry & r = state();
+        std::lock_guard guard(r.lock);
+        std::erase(r.kernels, kernel);
+    }
+
+    auto isa::resolve_all() -> void {
+        isa_level level = isa::current();
+        registry & r = state();
+        std::lock_guard guard(r.lock);
+        for (kernel_base * kernel : r.kernels) kernel->resolve(level);
+    }
+}
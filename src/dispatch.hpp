@@ -0,0 +1,134 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_DISPATCH_HPP
+#define CUBE_DISPATCH_HPP
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <string_view>
+#include <initializer_list>
+
+namespace cube {
+    /**
+     * \brief SIMD tiers a kernel can be specialised for, each one implies all lower ones
+     *      sse4_2: SSE4.2, SSSE3, POPCNT
+     *      avx2: AVX, AVX2, FMA, BMI1, BMI2, F16C, MOVBE, LZCNT (x86-64-v3)
+     *      avx512: AVX-512 F, BW, CD, DQ, VL (x86-64-v4)
+     */
+    enum class isa_level : std::uint8_t { scalar, sse4_2, avx2, avx512 };
+
+    class kernel_base;
+
+    /**
+     * \brief Detected ISA level, the optional cap used to exercise fallbacks on capable hosts
+     *      and the registry of dispatched kernels
+     *      The cap comes from the CUBE_ISA environment variable (scalar, sse4.2, avx2, avx512) or from
+     *      cap(). Kernels run their scalar variant until initialize() resolves them, which main does once
+     *      its command line (and with it a replayed CPUID snapshot) has been processed
+     */
+    class isa {
+    public:
+        static auto detected() -> isa_level;
+        static auto current() -> isa_level;
+        static auto initialize() -> void;
+        static auto cap(isa_level level) -> void;
+        static auto name(isa_level level) -> std::string_view;
+        static auto parse(std::string_view text) -> std::optional<isa_level>;
+
+    private:
+        friend class kernel_base;
+
+        static auto add(kernel_base * kernel) -> void;
+        static auto remove(kernel_base * kernel) -> void;
+        static auto resolve_all() -> void;
+    };
+
+    /**
+     * \brief Type independent part of a dispatched kernel, registered with isa for resolution
+     */
+    class kernel_base {
+    public:
+        explicit kernel_base(char const * name) : label(name) { }
+        kernel_base(kernel_base const &) = delete;
+        auto operator=(kernel_base const &) -> kernel_base & = delete;
+        virtual ~kernel_base() { isa::remove(this); }
+
+        [[nodiscard]] auto name() const -> char const * { return label; }
+        virtual auto resolve(isa_level level) -> void = 0;
+
+    protected:
+        auto enroll() -> void { isa::add(this); }
+
+    private:
+        char const * label;
+    };
+
+    /**
+     * \brief Function with one implementation per ISA level, called through a resolved pointer
+     *      isa::initialize() (or a cap change) stores the highest variant not above isa::current();
+     *      a call is then one relaxed load and one indirect call, without any feature check
+     * @tparam Signature Function type, e.g. std::uint32_t(void const *, std::size_t)
+     */
+    template <typename Signature>
+    class kernel;
+
+    template <typename Result, typename... Args>
+    class kernel<Result(Args...)> final : public kernel_base {
+    public:
+        using function = Result (*)(Args...);
+
+        struct variant {
+            isa_level level;
+            function body;
+        };
+
+        /**
+         * \brief Registers the variants of a kernel, a scalar one is required as the last resort
+         * @param name Kernel name for reports
+         * @param variants Implementations in any order
+         */
+        kernel(char const * name, std::initializer_list<variant> variants) : kernel_base(name), table(variants) {
+            std::sort(table.begin(), table.end(), [](variant const & a, variant const & b) { return a.level < b.level; });
+            resolved.store(table.front().body, std::memory_order_relaxed);
+            enroll();
+        }
+
+        auto operator()(Args... args) const -> Result {
+            return resolved.load(std::memory_order_relaxed)(args...);
+        }
+
+        /**
+         * \brief Best variant for an ISA level
+         * @param level Highest level allowed
+         * @return variant, the lowest one when none fits
+         */
+        [[nodiscard]] auto select(isa_level level) const -> variant const & {
+            variant const * best = &table.front();
+            for (variant const & v : table) if (v.level <= level) best = &v;
+            return *best;
+        }
+
+        [[nodiscard]] auto variants() const -> std::vector<variant> const & { return table; }
+        [[nodiscard]] auto level() const -> isa_level { return active.load(std::memory_order_relaxed); }
+
+        auto resolve(isa_level level) -> void override {
+            variant const & best = select(level);
+            active.store(best.level, std::memory_order_relaxed);
+            resolved.store(best.body, std::memory_order_relaxed);
+        }
+
+    private:
+        std::vector<variant> table;
+        std::atomic<function> resolved;
+        std::atomic<isa_level> active { isa_level::scalar };
+    };
+}
+
+#endif //CUBE_DISPATCH_HPP
@@ -0,0 +1,429 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <thread>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <optional>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <condition_variable>
+
+#include "cpu.hpp"
+#include "perf.hpp"
+#include "cgroup.hpp"
+#include "memory.hpp"
+#include "rapl.hpp"
+#include "procfs.hpp"
+#include "sampler.hpp"
+#include "thermal.hpp"
+#include "dispatch.hpp"
+#include "exporter.hpp"
+#include "frequency.hpp"
+#include "tsc_clock.hpp"
+
+namespace {
+    std::atomic<bool> stopping { false };
+
+    auto on_signal(int) -> void {
+        stopping.store(true);
+    }
+
+    /**
+     * \brief Appends metric families in the text exposition format
+     */
+    struct metric_writer {
+        std::string & out;
+
+        auto family(char const * name, char const * type, char const * help) -> void {
+            out += "# HELP ";
+            out += name;
+            out += ' ';
+            out += help;
+            out += "\n# TYPE ";
+            out += name;
+            out += ' ';
+            out += type;
+            out += '\n';
+        }
+
+        /**
+         * \brief Writes one sample, labels are alternating names and values; values are escaped
+         */
+        auto sample(char const * name, std::initializer_list<std::string_view> labels, double value) -> void {
+            out += name;
+            if (labels.size() >= 0x2) {
+                out += '{';
+                bool first = true;
+                for (auto it = labels.begin(); it + 0x1 < labels.end(); it += 0x2) {
+                    if (!first) out += ',';
+                    first = false;
+                    out += *it;
+                    out += "=\"";
+                    for (char c : *(it + 0x1)) {
+                        if (c == '\\') out += "\\\\";
+                        else if (c == '"') out += "\\\"";
+                        else if (c == '\n') out += "\\n";
+                        else out += c;
+                    }
+                    out += '"';
+                }
+                out += '}';
+            }
+            char number[0x40];
+            std::snprintf(number, sizeof(number), " %.10g\n", value);
+            out += number;
+        }
+    };
+
+    /**
+     * \brief Removes a unix socket file, never anything else
+     * @param path Socket path
+     * @return false when the path exists and is not a socket (or cannot be removed)
+     */
+    auto remove_socket(char const * path) -> bool {
+        struct stat info { };
+        if (::lstat(path, &info) != 0x0) return errno == ENOENT;
+        return S_ISSOCK(info.st_mode) && ::unlink(path) == 0x0;
+    }
+
+    /**
+     * \brief Parses a TCP port strictly: decimal digits only, 1 to 65535
+     * @return port, std::nullopt for anything else
+     */
+    auto parse_port(std::string_view text) -> std::optional<std::uint16_t> {
+        if (text.empty() || text.size() > 0x5) return std::nullopt;
+        std::uint32_t value = 0x0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return std::nullopt;
+            value = value * 0xA + static_cast<std::uint32_t>(c - '0');
+        }
+        if (value == 0x0 || value > 0xFFFF) return std::nullopt;
+        return static_cast<std::uint16_t>(value);
+    }
+}
+
+/**
+ * \brief Details that never change while the process runs, rendered once
+ * @return exposition text
+ */
+static auto render_static() -> std::string const & {
+    static std::string const text = [] {
+        std::string out;
+        metric_writer writer { out };
+        cube::tsc_calibration const & tsc = cube::tsc_clock::calibration();
+
+        writer.family("cube_cpu_info", "gauge", "CPU identification from CPUID, always 1");
+        writer.sample("cube_cpu_info", { "vendor", cpu::vendor_id(), "brand", cpu::brand_string(),
+                                         "isa", cube::isa::name(cube::isa::current()) }, 1.0);
+        writer.family("cube_tsc_hz", "gauge", "Calibrated time stamp counter frequency");
+        writer.sample("cube_tsc_hz", { }, tsc.hz);
+        writer.family("cube_tsc_invariant", "gauge", "1 when the TSC is invariant (CPUID.80000007H:EDX[8])");
+        writer.sample("cube_tsc_invariant", { }, tsc.invariant ? 1.0 : 0.0);
+        return out;
+    }();
+    return text;
+}
+
+/**
+ * \brief Refreshes every collector and renders the complete page
+ *      Collectors that are unavailable on this host are left out instead of exporting zeros
+ * @return exposition text
+ */
+auto exporter::render() -> std::string {
+    auto begin = std::chrono::steady_clock::now();
+
+    std::string out = render_static();
+    metric_writer writer { out };
+
+    std::vector<float> usage(sampler::cpus() + 0x1);
+    if (sampler::frame(usage.data(), usage.size())) {
+        writer.family("cube_cpu_utilization_ratio", "gauge", "Busy share of the last sampler interval");
+        writer.sample("cube_cpu_utilization_ratio", { "cpu", "all" }, usage[0x0] / 100.0);
+        for (std::size_t i = 0x1; i < usage.size(); ++i) {
+            writer.sample("cube_cpu_utilization_ratio", { "cpu", std::to_string(i - 0x1) }, usage[i] / 100.0);
+        }
+    }
+
+    if (thermal::init() && thermal::refresh()) {
+        writer.family("cube_temperature_celsius", "gauge", "Temperature inputs from libsensors");
+        for (thermal_channel const & channel : thermal::channels()) {
+            if (channel.valid) writer.sample("cube_temperature_celsius", { "chip", channel.chip, "label", channel.label }, channel.celsius);
+        }
+    }
+
+    if (memory::init() && memory::refresh()) {
+        memory_info const & info = memory::info();
+        std::pair<char const *, std::uint64_t> const fields[] {
+            { "total", info.total }, { "free", info.free }, { "available", info.available }, { "buffers", info.buffers },
+            { "cached", info.cached }, { "shmem", info.shmem }, { "dirty", info.dirty }, { "writeback", info.writeback },
+            { "anon", info.anon_pages }, { "anon_huge", info.anon_huge }, { "slab_reclaimable", info.slab_reclaimable },
+            { "slab_unreclaimable", info.slab_unreclaimable }, { "swap_total", info.swap_total }, { "swap_free", info.swap_free },
+        };
+        writer.family("cube_memory_bytes", "gauge", "Fields of /proc/meminfo");
+        for (auto const & [field, value] : fields) {
+            writer.sample("cube_memory_bytes", { "field", field }, static_cast<double>(value));
+        }
+
+        memory_rates const & rates = memory::rates();
+        if (rates.valid) {
+            writer.family("cube_vmstat_rate", "gauge", "Events per second of /proc/vmstat over the last interval");
+            for (std::size_t i = 0x0; i < rates.per_second.size(); ++i) {
+                writer.sample("cube_vmstat_rate", { "event", memory::name(static_cast<vmstat_counter>(i)) }, rates.per_second[i]);
+            }
+        }
+
+        if (!memory::nodes().empty()) {
+            writer.family("cube_node_memory_bytes", "gauge", "Per NUMA node memory");
+            for (memory_node const & node : memory::nodes()) {
+                if (!node.valid) continue;
+                writer.sample("cube_node_memory_bytes", { "node", std::to_string(node.node), "field", "total" }, static_cast<double>(node.total));
+                writer.sample("cube_node_memory_bytes", { "node", std::to_string(node.node), "field", "used" }, static_cast<double>(node.used));
+            }
+            writer.family("cube_node_numa_miss_rate", "gauge", "Allocations per second that fell back to this node from another");
+            for (memory_node const & node : memory::nodes()) {
+                if (node.valid) writer.sample("cube_node_numa_miss_rate", { "node", std::to_string(node.node) }, node.numa_miss_rate);
+            }
+        }
+
+        if (!memory::hugepages().empty()) {
+            writer.family("cube_hugepages", "gauge", "Hugepage pools in pages");
+            for (hugepage_pool const & pool : memory::hugepages()) {
+                std::string size = std::to_string(pool.page_size);
+                writer.sample("cube_hugepages", { "page_size", size, "state", "total" }, static_cast<double>(pool.total));
+                writer.sample("cube_hugepages", { "page_size", size, "state", "free" }, static_cast<double>(pool.free));
+            }
+        }
+    }
+
+    if (cgroup::init() && cgroup::refresh()) {
+        cgroup_stats const & self = cgroup::self();
+        if (self.quota_cores() > 0.0) {
+            writer.family("cube_cgroup_cpu_quota_cores", "gauge", "cpu.max quota of the own cgroup in CPUs");
+            writer.sample("cube_cgroup_cpu_quota_cores", { "cgroup", self.path }, self.quota_cores());
+        }
+        if (self.has_cpu && self.rates) {
+            writer.family("cube_cgroup_cpu_usage_cores", "gauge", "CPUs used by the own cgroup over the last interval");
+            writer.sample("cube_cgroup_cpu_usage_cores", { "cgroup", self.path }, self.cores_used);
+            writer.family("cube_cgroup_cpu_throttled_ratio", "gauge", "Share of CFS periods the own cgroup was throttled in");
+            writer.sample("cube_cgroup_cpu_throttled_ratio", { "cgroup", self.path }, self.throttled_percent / 100.0);
+            writer.family("cube_cgroup_cpu_throttled_seconds_total", "counter", "Time the own cgroup spent throttled");
+            writer.sample("cube_cgroup_cpu_throttled_seconds_total", { "cgroup", self.path }, static_cast<double>(self.throttled_usec) / 1e6);
+        }
+        if (self.has_memory) {
+            writer.family("cube_cgroup_memory_bytes", "gauge", "memory.current and memory.max of the own cgroup");
+            writer.sample("cube_cgroup_memory_bytes", { "cgroup", self.path, "field", "current" }, static_cast<double>(self.memory_current));
+            if (self.memory_max != cgroup_stats::unlimited) {
+                writer.sample("cube_cgroup_memory_bytes", { "cgroup", self.path, "field", "max" }, static_cast<double>(self.memory_max));
+            }
+        }
+    }
+
+    if (frequency::init() && frequency::refresh()) {
+        writer.family("cube_cpu_frequency_hertz", "gauge", "Effective clock of every CPU over the last interval");
+        for (core_frequency const & core : frequency::cores()) {
+            if (core.valid) writer.sample("cube_cpu_frequency_hertz", { "cpu", std::to_string(core.cpu) }, core.effective_mhz * 1e6);
+        }
+    }
+
+    if (rapl::init() && rapl::refresh()) {
+        writer.family("cube_rapl_energy_joules_total", "counter", "RAPL energy since the exporter started");
+        for (rapl_reading const & reading : rapl::readings()) {
+            if (!reading.valid) continue;
+            std::string package = reading.domain == rapl_domain::psys ? "platform" : std::to_string(reading.package);
+            writer.sample("cube_rapl_energy_joules_total", { "package", package, "domain", rapl::name(reading.domain) }, reading.joules);
+        }
+    }
+
+    if (perf::init() && perf::refresh()) {
+        writer.family("cube_instructions_per_cycle", "gauge", "IPC over the last interval from the hardware counters");
+        writer.sample("cube_instructions_per_cycle", { "cpu", "all" }, perf::total().ipc());
+        for (perf_sample const & sample : perf::cores()) {
+            if (sample.valid) writer.sample("cube_instructions_per_cycle", { "cpu", std::to_string(sample.cpu) }, sample.ipc());
+        }
+    }
+
+    writer.family("cube_collect_duration_seconds", "gauge", "Time the last collection and render took");
+    writer.sample("cube_collect_duration_seconds", { }, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    return out;
+}
+
+auto exporter::publish(std::string text) -> void {
+    auto fresh = std::make_shared<std::string const>(std::move(text));
+    std::lock_guard guard(exporter::lock);
+    exporter::page.swap(fresh);
+}
+
+auto exporter::current() -> std::shared_ptr<std::string const> {
+    std::lock_guard guard(exporter::lock);
+    return exporter::page;
+}
+
+/**
+ * \brief Creates the listening socket
+ * @param address "HOST:PORT" or "unix:/PATH"; a stale unix socket file is replaced, any other file is left alone
+ * @return socket descriptor, -1 on failure with the reason printed
+ */
+auto exporter::listen_on(std::string_view address) -> int {
+    int fd = -0x1;
+    if (address.rfind("unix:", 0x0) == 0x0) {
+        sockaddr_un local { };
+        std::string path(address.substr(0x5));
+        if (path.empty() || path.size() >= sizeof(local.sun_path)) {
+            std::fprintf(stderr, "invalid unix socket path: %s\n", path.c_str());
+            return -0x1;
+        }
+        local.sun_family = AF_UNIX;
+        std::memcpy(local.sun_path, path.c_str(), path.size() + 0x1);
+        if (!remove_socket(path.c_str())) {
+            std::fprintf(stderr, "refusing to replace %s: it exists and is not a socket\n", path.c_str());
+            return -0x1;
+        }
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0x0);
+        if (fd >= 0x0 && ::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0x0) {
+            ::close(fd);
+            fd = -0x1;
+        }
+    } else {
+        std::size_t colon = address.rfind(':');
+        std::string host(colon == std::string_view::npos ? "127.0.0.1" : address.substr(0x0, colon));
+        std::string port(colon == std::string_view::npos ? address : address.substr(colon + 0x1));
+
+        std::optional<std::uint16_t> number = parse_port(port);
+        if (!number) {
+            std::fprintf(stderr, "invalid port: %s\n", port.c_str());
+            return -0x1;
+        }
+
+        sockaddr_in inet { };
+        inet.sin_family = AF_INET;
+        inet.sin_port = htons(*number);
+        if (::inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 0x1) {
+            std::fprintf(stderr, "invalid IPv4 address: %s\n", host.c_str());
+            return -0x1;
+        }
+
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0x0);
+        int reuse = 0x1;
+        if (fd >= 0x0) ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (fd >= 0x0 && ::bind(fd, reinterpret_cast<sockaddr *>(&inet), sizeof(inet)) != 0x0) {
+            ::close(fd);
+            fd = -0x1;
+        }
+    }
+
+    if (fd < 0x0 || ::listen(fd, 0x40) != 0x0) {
+        std::fprintf(stderr, "cannot listen on %.*s: %s\n", static_cast<int>(address.size()), address.data(), std::strerror(errno));
+        if (fd >= 0x0) ::close(fd);
+        return -0x1;
+    }
+    return fd;
+}
+
+/**
+ * \brief Answers one HTTP/1.0 request: GET /metrics (or /) gets the published page, everything else 404
+ *      Send and receive time out after a second, so a stuck client costs the server at most that
+ * @param client Connected socket, closed on return
+ */
+auto exporter::respond(int client) -> void {
+    timeval timeout { 0x1, 0x0 };
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[0x1000];
+    std::size_t size = 0x0;
+    while (size < sizeof(request)) {
+        ssize_t n = ::recv(client, request + size, sizeof(request) - size, 0x0);
+        if (n <= 0x0) break;
+        size += static_cast<std::size_t>(n);
+        if (std::string_view(request, size).find("\r\n\r\n") != std::string_view::npos) break;
+    }
+
+    std::string_view line(request, size);
+    line = line.substr(0x0, line.find('\r'));
+    bool found = line.rfind("GET /metrics ", 0x0) == 0x0 || line.rfind("GET / ", 0x0) == 0x0;
+
+    std::shared_ptr<std::string const> body = exporter::current();
+    std::string_view content = found && body ? std::string_view(*body) : std::string_view("not found\n");
+
+    char header[0x100];
+    int length = std::snprintf(header, sizeof(header),
+                               "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                               "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                               found && body ? "200 OK" : "404 Not Found", content.size());
+
+    iovec parts[0x2] { { header, static_cast<std::size_t>(length) },
+                       { const_cast<char *>(content.data()), content.size() } };
+    msghdr message { };
+    message.msg_iov = parts;
+    message.msg_iovlen = 0x2;
+    while (message.msg_iovlen > 0x0) {
+        ssize_t sent = ::sendmsg(client, &message, MSG_NOSIGNAL);
+        if (sent <= 0x0) break;
+        auto left = static_cast<std::size_t>(sent);
+        while (message.msg_iovlen > 0x0 && left >= message.msg_iov->iov_len) {
+            left -= message.msg_iov->iov_len;
+            ++message.msg_iov;
+            --message.msg_iovlen;
+        }
+        if (message.msg_iovlen > 0x0) {
+            message.msg_iov->iov_base = static_cast<char *>(message.msg_iov->iov_base) + left;
+            message.msg_iov->iov_len -= left;
+        }
+    }
+    ::close(client);
+}
+
+/**
+ * \brief Runs the exporter until SIGINT or SIGTERM
+ * @param options Endpoint and collection interval
+ * @return exit status, 1 when the socket cannot be opened
+ */
+auto exporter::serve(exporter_options const & options) -> int {
+    int server = exporter::listen_on(options.address);
+    if (server < 0x0) return 0x1;
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    sampler::start(options.interval);
+    exporter::publish(exporter::render());
+
+    std::mutex wait_lock;
+    std::condition_variable_any wake;
+    std::jthread collector([&](std::stop_token token) {
+        std::unique_lock<std::mutex> guard(wait_lock);
+        while (!wake.wait_for(guard, token, options.interval, [] { return false; })) {
+            if (token.stop_requested()) break;
+            guard.unlock();
+            exporter::publish(exporter::render());
+            guard.lock();
+        }
+    });
+
+    std::fprintf(stderr, "serving metrics on %s every %lld ms\n", options.address.c_str(),
+                 static_cast<long long>(options.interval.count()));
+    while (!stopping.load()) {
+        pollfd ready { server, POLLIN, 0x0 };
+        if (::poll(&ready, 0x1, 0x1F4) <= 0x0) continue;
+
+        int client = ::accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client >= 0x0) exporter::respond(client);
+    }
+
+    collector.request_stop();
+    ::close(server);
+    if (options.address.rfind("unix:", 0x0) == 0x0) remove_socket(options.address.c_str() + 0x5);
+    return 0x0;
+}
@@ -0,0 +1,49 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_EXPORTER_HPP
+#define CUBE_EXPORTER_HPP
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#define EXPORTER_DEFAULT_ADDRESS "127.0.0.1:9464"
+
+/**
+ * \brief Listening endpoint and collection schedule of --serve
+ *      address is "HOST:PORT" (IPv4, loopback by default) or "unix:/PATH"
+ */
+struct exporter_options {
+    std::string address { EXPORTER_DEFAULT_ADDRESS };
+    std::chrono::milliseconds interval { 0x3E8 };
+};
+
+/**
+ * \brief Prometheus text exposition (format 0.0.4) of the collectors
+ *      A collector thread refreshes every collector on its own schedule and renders the whole page into a
+ *      new string, which is then published by swapping one shared pointer. Scrapes only copy that pointer
+ *      and write the buffer out, so a slow or stalled client never delays sampling and a scrape never
+ *      touches /proc or the hardware. Static details (CPUID, TSC calibration) are rendered once
+ */
+class exporter {
+public:
+    static auto serve(exporter_options const & options) -> int;
+    static auto render() -> std::string;
+
+private:
+    static inline std::mutex lock;
+    static inline std::shared_ptr<std::string const> page;
+
+    static auto publish(std::string text) -> void;
+    static auto current() -> std::shared_ptr<std::string const>;
+    static auto listen_on(std::string_view address) -> int;
+    static auto respond(int client) -> void;
+};
+
+#endif //CUBE_EXPORTER_HPP
@@ -0,0 +1,110 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+
+#include "cpuid.hpp"
+#include "features.hpp"
+
+/**
+ * \brief Reads every feature bit from the snapshot, without looking at the OS enabled state
+ * @param snapshot CPUID dump to decode
+ * @return features the processor advertises
+ */
+auto cpu_features::detect(cpuid_snapshot const & snapshot) -> feature_set {
+    feature_set result;
+
+    for (feature_info const & info : feature_table) {
+        cpuid_regs regs = snapshot.query(info.leaf, info.subleaf);
+        std::uint32_t value = 0x0;
+        switch (info.reg) {
+            case cpuid_register::eax: value = regs.eax; break;
+            case cpuid_register::ebx: value = regs.ebx; break;
+            case cpuid_register::ecx: value = regs.ecx; break;
+            case cpuid_register::edx: value = regs.edx; break;
+        }
+        result.set(info.id, (value >> info.bit) & 0x1);
+    }
+    return result;
+}
+
+/**
+ * \brief Drops the features whose register state is not enabled in XCR0
+ *      AVX needs SSE and AVX state (bits 1, 2), AVX-512 additionally opmask, ZMM_Hi256 and
+ *      Hi16_ZMM (bits 5, 6, 7), AMX needs XTILECFG and XTILEDATA (bits 17, 18)
+ * @param supported Output of detect()
+ * @param xcr0 Enabled state components
+ * @param osxsave CPUID.1:ECX[27], without it XCR0 cannot be read and no extended state is usable
+ * @return features that can actually execute
+ */
+auto cpu_features::usable(feature_set const & supported, std::uint64_t xcr0, bool osxsave) -> feature_set {
+    constexpr std::uint64_t avx_state = 0x6;
+    constexpr std::uint64_t avx512_state = avx_state | 0xE0;
+    constexpr std::uint64_t amx_state = 0x60000;
+
+    feature_set result = supported;
+    for (feature_info const & info : feature_table) {
+        std::uint64_t required = 0x0;
+        switch (info.state) {
+            case xstate::none: continue;
+            case xstate::avx: required = avx_state; break;
+            case xstate::avx512: required = avx512_state; break;
+            case xstate::amx: required = amx_state; break;
+        }
+        if (!osxsave || (xcr0 & required) != required) result.set(info.id, false);
+    }
+    return result;
+}
+
+/**
+ * \brief Features advertised by the process wide CPUID snapshot, decoded once
+ * @return feature set
+ */
+auto cpu_features::supported() -> feature_set const & {
+    static feature_set const features = cpu_features::detect(cpuid_snapshot::get());
+    return features;
+}
+
+/**
+ * \brief Features the code may dispatch on, decoded once
+ * @return feature set
+ */
+auto cpu_features::usable() -> feature_set const & {
+    static feature_set const features = cpu_features::usable(
+            cpu_features::supported(), cpuid_snapshot::get().xcr0(),
+            cpu_features::supported().has(feature::osxsave));
+    return features;
+}
+
+/**
+ * \brief Features code may execute, decoded once from the live CPU and its XCR0
+ *      Intersected with usable(), so a replayed dump from a more capable CPU cannot select
+ *      instructions this one would fault on
+ * @return feature set
+ */
+auto cpu_features::runnable() -> feature_set const & {
+    static feature_set const features = [] {
+        cpuid_snapshot const & host = cpuid_snapshot::host();
+        feature_set const supported = cpu_features::detect(host);
+        return cpu_features::usable(supported, host.xcr0(), supported.has(feature::osxsave)) & cpu_features::usable();
+    }();
+    return features;
+}
+
+/**
+ * \brief Prints every feature with Y (usable), N (absent) or - (advertised, but the OS did not enable its state)
+ */
+auto cpu_features::print() -> void {
+    feature_set const & supported = cpu_features::supported();
+    feature_set const & usable = cpu_features::usable();
+
+    for (std::size_t i = 0x0; i < feature_count; ++i) {
+        auto f = static_cast<feature>(i);
+        char mark = usable.has(f) ? 'Y' : supported.has(f) ? '-' : 'N';
+        std::printf(" [ %-20s[%c] ]%s", cpu_features::name(f).data(), mark, (i % 0x4 == 0x3) ? "\n" : "");
+    }
+    std::printf("%sXCR0: 0x%llx\n", (feature_count % 0x4) ? "\n" : "",
+                static_cast<unsigned long long>(cpuid_snapshot::get().xcr0()));
+}
@@ -0,0 +1,299 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_FEATURES_HPP
+#define CUBE_FEATURES_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <initializer_list>
+
+class cpuid_snapshot;
+
+enum class feature : std::uint8_t {
+    /* Leaf 1, EDX */
+    fpu, vme, de, pse, tsc, msr, pae, mce, cx8, apic, sep, mtrr, pge, mca, cmov, pat, pse36, psn,
+    clflush, ds, acpi, mmx, fxsr, sse, sse2, ss, htt, tm, ia64, pbe,
+    /* Leaf 1, ECX */
+    sse3, pclmulqdq, dtes64, monitor, ds_cpl, vmx, smx, est, tm2, ssse3, cnxt_id, sdbg, fma, cx16,
+    xtpr, pdcm, pcid, dca, sse4_1, sse4_2, x2apic, movbe, popcnt, tsc_deadline, aes, xsave, osxsave,
+    avx, f16c, rdrand, hypervisor,
+    /* Leaf 7 subleaf 0, EBX */
+    fsgsbase, bmi1, hle, avx2, smep, bmi2, erms, invpcid, rtm, mpx, avx512f, avx512dq, rdseed, adx,
+    smap, avx512_ifma, clflushopt, clwb, avx512pf, avx512er, avx512cd, sha, avx512bw, avx512vl,
+    /* Leaf 7 subleaf 0, ECX */
+    prefetchwt1, avx512_vbmi, umip, pku, ospke, waitpkg, avx512_vbmi2, cet_ss, gfni, vaes,
+    vpclmulqdq, avx512_vnni, avx512_bitalg, avx512_vpopcntdq, la57, rdpid, cldemote, movdiri,
+    movdir64b, enqcmd,
+    /* Leaf 7 subleaf 0, EDX */
+    avx512_4vnniw, avx512_4fmaps, fsrm, avx512_vp2intersect, md_clear, serialize, hybrid, tsxldtrk,
+    pconfig, cet_ibt, amx_bf16, avx512_fp16, amx_tile, amx_int8,
+    /* Leaf 7 subleaf 1, EAX / EDX */
+    sha512, sm3, sm4, avx_vnni, avx512_bf16, fzrm, fsrs, fsrcs, amx_fp16, avx_ifma,
+    avx_vnni_int8, avx_ne_convert, amx_complex, avx_vnni_int16, prefetchi,
+    /* Leaf 80000001H, ECX / EDX */
+    lahf_lm, svm, lzcnt, sse4a, misalignsse, prefetchw, xop, fma4, tbm, topoext, perfctr_core,
+    monitorx, syscall, nx, mmxext, pdpe1gb, rdtscp, lm,
+    /* Leaves 80000007H / 80000008H */
+    invariant_tsc, clzero, wbnoinvd,
+    count
+};
+
+inline constexpr std::size_t feature_count = static_cast<std::size_t>(feature::count);
+
+/**
+ * \brief Register state (XCR0 components) the OS has to enable before a feature may be used
+ */
+enum class xstate : std::uint8_t { none, avx, avx512, amx };
+
+enum class cpuid_register : std::uint8_t { eax, ebx, ecx, edx };
+
+/**
+ * \brief Where CPUID reports a feature
+ */
+struct feature_info {
+    feature id;
+    char const * name;
+    std::uint32_t leaf;
+    std::uint32_t subleaf;
+    cpuid_register reg;
+    std::uint8_t bit;
+    xstate state;
+};
+
+/**
+ * \brief CPUID location of every feature, in enumerator order
+ */
+inline constexpr std::array<feature_info, feature_count> feature_table = {{
+        { feature::fpu, "FPU", 0x1, 0x0, cpuid_register::edx, 0x0, xstate::none },
+        { feature::vme, "VME", 0x1, 0x0, cpuid_register::edx, 0x1, xstate::none },
+        { feature::de, "DE", 0x1, 0x0, cpuid_register::edx, 0x2, xstate::none },
+        { feature::pse, "PSE", 0x1, 0x0, cpuid_register::edx, 0x3, xstate::none },
+        { feature::tsc, "TSC", 0x1, 0x0, cpuid_register::edx, 0x4, xstate::none },
+        { feature::msr, "MSR", 0x1, 0x0, cpuid_register::edx, 0x5, xstate::none },
+        { feature::pae, "PAE", 0x1, 0x0, cpuid_register::edx, 0x6, xstate::none },
+        { feature::mce, "MCE", 0x1, 0x0, cpuid_register::edx, 0x7, xstate::none },
+        { feature::cx8, "CX8", 0x1, 0x0, cpuid_register::edx, 0x8, xstate::none },
+        { feature::apic, "APIC", 0x1, 0x0, cpuid_register::edx, 0x9, xstate::none },
+        { feature::sep, "SEP", 0x1, 0x0, cpuid_register::edx, 0xB, xstate::none },
+        { feature::mtrr, "MTRR", 0x1, 0x0, cpuid_register::edx, 0xC, xstate::none },
+        { feature::pge, "PGE", 0x1, 0x0, cpuid_register::edx, 0xD, xstate::none },
+        { feature::mca, "MCA", 0x1, 0x0, cpuid_register::edx, 0xE, xstate::none },
+        { feature::cmov, "CMOV", 0x1, 0x0, cpuid_register::edx, 0xF, xstate::none },
+        { feature::pat, "PAT", 0x1, 0x0, cpuid_register::edx, 0x10, xstate::none },
+        { feature::pse36, "PSE36", 0x1, 0x0, cpuid_register::edx, 0x11, xstate::none },
+        { feature::psn, "PSN", 0x1, 0x0, cpuid_register::edx, 0x12, xstate::none },
+        { feature::clflush, "CLFLUSH", 0x1, 0x0, cpuid_register::edx, 0x13, xstate::none },
+        { feature::ds, "DS", 0x1, 0x0, cpuid_register::edx, 0x15, xstate::none },
+        { feature::acpi, "ACPI", 0x1, 0x0, cpuid_register::edx, 0x16, xstate::none },
+        { feature::mmx, "MMX", 0x1, 0x0, cpuid_register::edx, 0x17, xstate::none },
+        { feature::fxsr, "FXSR", 0x1, 0x0, cpuid_register::edx, 0x18, xstate::none },
+        { feature::sse, "SSE", 0x1, 0x0, cpuid_register::edx, 0x19, xstate::none },
+        { feature::sse2, "SSE2", 0x1, 0x0, cpuid_register::edx, 0x1A, xstate::none },
+        { feature::ss, "SS", 0x1, 0x0, cpuid_register::edx, 0x1B, xstate::none },
+        { feature::htt, "HTT", 0x1, 0x0, cpuid_register::edx, 0x1C, xstate::none },
+        { feature::tm, "TM", 0x1, 0x0, cpuid_register::edx, 0x1D, xstate::none },
+        { feature::ia64, "IA64", 0x1, 0x0, cpuid_register::edx, 0x1E, xstate::none },
+        { feature::pbe, "PBE", 0x1, 0x0, cpuid_register::edx, 0x1F, xstate::none },
+        { feature::sse3, "SSE3", 0x1, 0x0, cpuid_register::ecx, 0x0, xstate::none },
+        { feature::pclmulqdq, "PCLMULQDQ", 0x1, 0x0, cpuid_register::ecx, 0x1, xstate::none },
+        { feature::dtes64, "DTES64", 0x1, 0x0, cpuid_register::ecx, 0x2, xstate::none },
+        { feature::monitor, "MONITOR", 0x1, 0x0, cpuid_register::ecx, 0x3, xstate::none },
+        { feature::ds_cpl, "DS_CPL", 0x1, 0x0, cpuid_register::ecx, 0x4, xstate::none },
+        { feature::vmx, "VMX", 0x1, 0x0, cpuid_register::ecx, 0x5, xstate::none },
+        { feature::smx, "SMX", 0x1, 0x0, cpuid_register::ecx, 0x6, xstate::none },
+        { feature::est, "EST", 0x1, 0x0, cpuid_register::ecx, 0x7, xstate::none },
+        { feature::tm2, "TM2", 0x1, 0x0, cpuid_register::ecx, 0x8, xstate::none },
+        { feature::ssse3, "SSSE3", 0x1, 0x0, cpuid_register::ecx, 0x9, xstate::none },
+        { feature::cnxt_id, "CNXT_ID", 0x1, 0x0, cpuid_register::ecx, 0xA, xstate::none },
+        { feature::sdbg, "SDBG", 0x1, 0x0, cpuid_register::ecx, 0xB, xstate::none },
+        { feature::fma, "FMA", 0x1, 0x0, cpuid_register::ecx, 0xC, xstate::avx },
+        { feature::cx16, "CX16", 0x1, 0x0, cpuid_register::ecx, 0xD, xstate::none },
+        { feature::xtpr, "XTPR", 0x1, 0x0, cpuid_register::ecx, 0xE, xstate::none },
+        { feature::pdcm, "PDCM", 0x1, 0x0, cpuid_register::ecx, 0xF, xstate::none },
+        { feature::pcid, "PCID", 0x1, 0x0, cpuid_register::ecx, 0x11, xstate::none },
+        { feature::dca, "DCA", 0x1, 0x0, cpuid_register::ecx, 0x12, xstate::none },
+        { feature::sse4_1, "SSE4_1", 0x1, 0x0, cpuid_register::ecx, 0x13, xstate::none },
+        { feature::sse4_2, "SSE4_2", 0x1, 0x0, cpuid_register::ecx, 0x14, xstate::none },
+        { feature::x2apic, "X2APIC", 0x1, 0x0, cpuid_register::ecx, 0x15, xstate::none },
+        { feature::movbe, "MOVBE", 0x1, 0x0, cpuid_register::ecx, 0x16, xstate::none },
+        { feature::popcnt, "POPCNT", 0x1, 0x0, cpuid_register::ecx, 0x17, xstate::none },
+        { feature::tsc_deadline, "TSC_DEADLINE", 0x1, 0x0, cpuid_register::ecx, 0x18, xstate::none },
+        { feature::aes, "AES", 0x1, 0x0, cpuid_register::ecx, 0x19, xstate::none },
+        { feature::xsave, "XSAVE", 0x1, 0x0, cpuid_register::ecx, 0x1A, xstate::none },
+        { feature::osxsave, "OSXSAVE", 0x1, 0x0, cpuid_register::ecx, 0x1B, xstate::none },
+        { feature::avx, "AVX", 0x1, 0x0, cpuid_register::ecx, 0x1C, xstate::avx },
+        { feature::f16c, "F16C", 0x1, 0x0, cpuid_register::ecx, 0x1D, xstate::avx },
+        { feature::rdrand, "RDRAND", 0x1, 0x0, cpuid_register::ecx, 0x1E, xstate::none },
+        { feature::hypervisor, "HYPERVISOR", 0x1, 0x0, cpuid_register::ecx, 0x1F, xstate::none },
+        { feature::fsgsbase, "FSGSBASE", 0x7, 0x0, cpuid_register::ebx, 0x0, xstate::none },
+        { feature::bmi1, "BMI1", 0x7, 0x0, cpuid_register::ebx, 0x3, xstate::none },
+        { feature::hle, "HLE", 0x7, 0x0, cpuid_register::ebx, 0x4, xstate::none },
+        { feature::avx2, "AVX2", 0x7, 0x0, cpuid_register::ebx, 0x5, xstate::avx },
+        { feature::smep, "SMEP", 0x7, 0x0, cpuid_register::ebx, 0x7, xstate::none },
+        { feature::bmi2, "BMI2", 0x7, 0x0, cpuid_register::ebx, 0x8, xstate::none },
+        { feature::erms, "ERMS", 0x7, 0x0, cpuid_register::ebx, 0x9, xstate::none },
+        { feature::invpcid, "INVPCID", 0x7, 0x0, cpuid_register::ebx, 0xA, xstate::none },
+        { feature::rtm, "RTM", 0x7, 0x0, cpuid_register::ebx, 0xB, xstate::none },
+        { feature::mpx, "MPX", 0x7, 0x0, cpuid_register::ebx, 0xE, xstate::none },
+        { feature::avx512f, "AVX512F", 0x7, 0x0, cpuid_register::ebx, 0x10, xstate::avx512 },
+        { feature::avx512dq, "AVX512DQ", 0x7, 0x0, cpuid_register::ebx, 0x11, xstate::avx512 },
+        { feature::rdseed, "RDSEED", 0x7, 0x0, cpuid_register::ebx, 0x12, xstate::none },
+        { feature::adx, "ADX", 0x7, 0x0, cpuid_register::ebx, 0x13, xstate::none },
+        { feature::smap, "SMAP", 0x7, 0x0, cpuid_register::ebx, 0x14, xstate::none },
+        { feature::avx512_ifma, "AVX512_IFMA", 0x7, 0x0, cpuid_register::ebx, 0x15, xstate::avx512 },
+        { feature::clflushopt, "CLFLUSHOPT", 0x7, 0x0, cpuid_register::ebx, 0x17, xstate::none },
+        { feature::clwb, "CLWB", 0x7, 0x0, cpuid_register::ebx, 0x18, xstate::none },
+        { feature::avx512pf, "AVX512PF", 0x7, 0x0, cpuid_register::ebx, 0x1A, xstate::avx512 },
+        { feature::avx512er, "AVX512ER", 0x7, 0x0, cpuid_register::ebx, 0x1B, xstate::avx512 },
+        { feature::avx512cd, "AVX512CD", 0x7, 0x0, cpuid_register::ebx, 0x1C, xstate::avx512 },
+        { feature::sha, "SHA", 0x7, 0x0, cpuid_register::ebx, 0x1D, xstate::none },
+        { feature::avx512bw, "AVX512BW", 0x7, 0x0, cpuid_register::ebx, 0x1E, xstate::avx512 },
+        { feature::avx512vl, "AVX512VL", 0x7, 0x0, cpuid_register::ebx, 0x1F, xstate::avx512 },
+        { feature::prefetchwt1, "PREFETCHWT1", 0x7, 0x0, cpuid_register::ecx, 0x0, xstate::none },
+        { feature::avx512_vbmi, "AVX512_VBMI", 0x7, 0x0, cpuid_register::ecx, 0x1, xstate::avx512 },
+        { feature::umip, "UMIP", 0x7, 0x0, cpuid_register::ecx, 0x2, xstate::none },
+        { feature::pku, "PKU", 0x7, 0x0, cpuid_register::ecx, 0x3, xstate::none },
+        { feature::ospke, "OSPKE", 0x7, 0x0, cpuid_register::ecx, 0x4, xstate::none },
+        { feature::waitpkg, "WAITPKG", 0x7, 0x0, cpuid_register::ecx, 0x5, xstate::none },
+        { feature::avx512_vbmi2, "AVX512_VBMI2", 0x7, 0x0, cpuid_register::ecx, 0x6, xstate::avx512 },
+        { feature::cet_ss, "CET_SS", 0x7, 0x0, cpuid_register::ecx, 0x7, xstate::none },
+        { feature::gfni, "GFNI", 0x7, 0x0, cpuid_register::ecx, 0x8, xstate::none },
+        { feature::vaes, "VAES", 0x7, 0x0, cpuid_register::ecx, 0x9, xstate::avx },
+        { feature::vpclmulqdq, "VPCLMULQDQ", 0x7, 0x0, cpuid_register::ecx, 0xA, xstate::avx },
+        { feature::avx512_vnni, "AVX512_VNNI", 0x7, 0x0, cpuid_register::ecx, 0xB, xstate::avx512 },
+        { feature::avx512_bitalg, "AVX512_BITALG", 0x7, 0x0, cpuid_register::ecx, 0xC, xstate::avx512 },
+        { feature::avx512_vpopcntdq, "AVX512_VPOPCNTDQ", 0x7, 0x0, cpuid_register::ecx, 0xE, xstate::avx512 },
+        { feature::la57, "LA57", 0x7, 0x0, cpuid_register::ecx, 0x10, xstate::none },
+        { feature::rdpid, "RDPID", 0x7, 0x0, cpuid_register::ecx, 0x16, xstate::none },
+        { feature::cldemote, "CLDEMOTE", 0x7, 0x0, cpuid_register::ecx, 0x19, xstate::none },
+        { feature::movdiri, "MOVDIRI", 0x7, 0x0, cpuid_register::ecx, 0x1B, xstate::none },
+        { feature::movdir64b, "MOVDIR64B", 0x7, 0x0, cpuid_register::ecx, 0x1C, xstate::none },
+        { feature::enqcmd, "ENQCMD", 0x7, 0x0, cpuid_register::ecx, 0x1D, xstate::none },
+        { feature::avx512_4vnniw, "AVX512_4VNNIW", 0x7, 0x0, cpuid_register::edx, 0x2, xstate::avx512 },
+        { feature::avx512_4fmaps, "AVX512_4FMAPS", 0x7, 0x0, cpuid_register::edx, 0x3, xstate::avx512 },
+        { feature::fsrm, "FSRM", 0x7, 0x0, cpuid_register::edx, 0x4, xstate::none },
+        { feature::avx512_vp2intersect, "AVX512_VP2INTERSECT", 0x7, 0x0, cpuid_register::edx, 0x8, xstate::avx512 },
+        { feature::md_clear, "MD_CLEAR", 0x7, 0x0, cpuid_register::edx, 0xA, xstate::none },
+        { feature::serialize, "SERIALIZE", 0x7, 0x0, cpuid_register::edx, 0xE, xstate::none },
+        { feature::hybrid, "HYBRID", 0x7, 0x0, cpuid_register::edx, 0xF, xstate::none },
+        { feature::tsxldtrk, "TSXLDTRK", 0x7, 0x0, cpuid_register::edx, 0x10, xstate::none },
+        { feature::pconfig, "PCONFIG", 0x7, 0x0, cpuid_register::edx, 0x12, xstate::none },
+        { feature::cet_ibt, "CET_IBT", 0x7, 0x0, cpuid_register::edx, 0x14, xstate::none },
+        { feature::amx_bf16, "AMX_BF16", 0x7, 0x0, cpuid_register::edx, 0x16, xstate::amx },
+        { feature::avx512_fp16, "AVX512_FP16", 0x7, 0x0, cpuid_register::edx, 0x17, xstate::avx512 },
+        { feature::amx_tile, "AMX_TILE", 0x7, 0x0, cpuid_register::edx, 0x18, xstate::amx },
+        { feature::amx_int8, "AMX_INT8", 0x7, 0x0, cpuid_register::edx, 0x19, xstate::amx },
+        { feature::sha512, "SHA512", 0x7, 0x1, cpuid_register::eax, 0x0, xstate::avx },
+        { feature::sm3, "SM3", 0x7, 0x1, cpuid_register::eax, 0x1, xstate::avx },
+        { feature::sm4, "SM4", 0x7, 0x1, cpuid_register::eax, 0x2, xstate::avx },
+        { feature::avx_vnni, "AVX_VNNI", 0x7, 0x1, cpuid_register::eax, 0x4, xstate::avx },
+        { feature::avx512_bf16, "AVX512_BF16", 0x7, 0x1, cpuid_register::eax, 0x5, xstate::avx512 },
+        { feature::fzrm, "FZRM", 0x7, 0x1, cpuid_register::eax, 0xA, xstate::none },
+        { feature::fsrs, "FSRS", 0x7, 0x1, cpuid_register::eax, 0xB, xstate::none },
+        { feature::fsrcs, "FSRCS", 0x7, 0x1, cpuid_register::eax, 0xC, xstate::none },
+        { feature::amx_fp16, "AMX_FP16", 0x7, 0x1, cpuid_register::eax, 0x15, xstate::amx },
+        { feature::avx_ifma, "AVX_IFMA", 0x7, 0x1, cpuid_register::eax, 0x17, xstate::avx },
+        { feature::avx_vnni_int8, "AVX_VNNI_INT8", 0x7, 0x1, cpuid_register::edx, 0x4, xstate::avx },
+        { feature::avx_ne_convert, "AVX_NE_CONVERT", 0x7, 0x1, cpuid_register::edx, 0x5, xstate::avx },
+        { feature::amx_complex, "AMX_COMPLEX", 0x7, 0x1, cpuid_register::edx, 0x8, xstate::amx },
+        { feature::avx_vnni_int16, "AVX_VNNI_INT16", 0x7, 0x1, cpuid_register::edx, 0xA, xstate::avx },
+        { feature::prefetchi, "PREFETCHI", 0x7, 0x1, cpuid_register::edx, 0xE, xstate::none },
+        { feature::lahf_lm, "LAHF_LM", 0x80000001, 0x0, cpuid_register::ecx, 0x0, xstate::none },
+        { feature::svm, "SVM", 0x80000001, 0x0, cpuid_register::ecx, 0x2, xstate::none },
+        { feature::lzcnt, "LZCNT", 0x80000001, 0x0, cpuid_register::ecx, 0x5, xstate::none },
+        { feature::sse4a, "SSE4A", 0x80000001, 0x0, cpuid_register::ecx, 0x6, xstate::none },
+        { feature::misalignsse, "MISALIGNSSE", 0x80000001, 0x0, cpuid_register::ecx, 0x7, xstate::none },
+        { feature::prefetchw, "PREFETCHW", 0x80000001, 0x0, cpuid_register::ecx, 0x8, xstate::none },
+        { feature::xop, "XOP", 0x80000001, 0x0, cpuid_register::ecx, 0xB, xstate::avx },
+        { feature::fma4, "FMA4", 0x80000001, 0x0, cpuid_register::ecx, 0x10, xstate::avx },
+        { feature::tbm, "TBM", 0x80000001, 0x0, cpuid_register::ecx, 0x15, xstate::none },
+        { feature::topoext, "TOPOEXT", 0x80000001, 0x0, cpuid_register::ecx, 0x16, xstate::none },
+        { feature::perfctr_core, "PERFCTR_CORE", 0x80000001, 0x0, cpuid_register::ecx, 0x17, xstate::none },
+        { feature::monitorx, "MONITORX", 0x80000001, 0x0, cpuid_register::ecx, 0x1D, xstate::none },
+        { feature::syscall, "SYSCALL", 0x80000001, 0x0, cpuid_register::edx, 0xB, xstate::none },
+        { feature::nx, "NX", 0x80000001, 0x0, cpuid_register::edx, 0x14, xstate::none },
+        { feature::mmxext, "MMXEXT", 0x80000001, 0x0, cpuid_register::edx, 0x16, xstate::none },
+        { feature::pdpe1gb, "PDPE1GB", 0x80000001, 0x0, cpuid_register::edx, 0x1A, xstate::none },
+        { feature::rdtscp, "RDTSCP", 0x80000001, 0x0, cpuid_register::edx, 0x1B, xstate::none },
+        { feature::lm, "LM", 0x80000001, 0x0, cpuid_register::edx, 0x1D, xstate::none },
+        { feature::invariant_tsc, "INVARIANT_TSC", 0x80000007, 0x0, cpuid_register::edx, 0x8, xstate::none },
+        { feature::clzero, "CLZERO", 0x80000008, 0x0, cpuid_register::ebx, 0x0, xstate::none },
+        { feature::wbnoinvd, "WBNOINVD", 0x80000008, 0x0, cpuid_register::ebx, 0x9, xstate::none },
+}};
+
+static_assert([] {
+    for (std::size_t i = 0x0; i < feature_count; ++i) {
+        if (static_cast<std::size_t>(feature_table[i].id) != i) return false;
+    }
+    return true;
+}(), "feature_table must list the features in enumerator order");
+
+/**
+ * \brief Fixed size set of features, one bit per enumerator, usable in constant expressions
+ */
+class feature_set {
+public:
+    constexpr feature_set() = default;
+    constexpr feature_set(std::initializer_list<feature> features) {
+        for (feature f : features) set(f);
+    }
+
+    [[nodiscard]] constexpr auto has(feature f) const -> bool {
+        auto index = static_cast<std::size_t>(f);
+        return (words[index / 0x40] >> (index % 0x40)) & 0x1;
+    }
+    [[nodiscard]] constexpr auto contains(feature_set const & other) const -> bool {
+        for (std::size_t i = 0x0; i < words.size(); ++i) {
+            if ((words[i] & other.words[i]) != other.words[i]) return false;
+        }
+        return true;
+    }
+    constexpr auto set(feature f, bool value = true) -> void {
+        auto index = static_cast<std::size_t>(f);
+        std::uint64_t mask = 0x1ULL << (index % 0x40);
+        words[index / 0x40] = value ? (words[index / 0x40] | mask) : (words[index / 0x40] & ~mask);
+    }
+    [[nodiscard]] constexpr auto size() const -> std::size_t {
+        std::size_t result = 0x0;
+        for (std::uint64_t word : words) result += static_cast<std::size_t>(__builtin_popcountll(word));
+        return result;
+    }
+    [[nodiscard]] constexpr auto operator&(feature_set const & other) const -> feature_set {
+        feature_set result;
+        for (std::size_t i = 0x0; i < words.size(); ++i) result.words[i] = words[i] & other.words[i];
+        return result;
+    }
+
+private:
+    std::array<std::uint64_t, (feature_count + 0x3F) / 0x40> words { };
+};
+
+/**
+ * \brief Processor features from the CPUID snapshot
+ *      supported() is what CPUID advertises; usable() additionally drops every AVX, AVX-512 and AMX
+ *      feature whose register state the OS did not enable in XCR0. On Linux, AMX tiles also need
+ *      arch_prctl(ARCH_REQ_XCOMP_PERM) per process before first use. Both follow a replayed dump;
+ *      runnable() is what may actually execute here: the usable features of the live CPU, lowered to
+ *      usable() so a replay can narrow code selection but never widen it; has() checks runnable()
+ */
+class cpu_features {
+public:
+    static auto detect(cpuid_snapshot const & snapshot) -> feature_set;
+    static auto usable(feature_set const & supported, std::uint64_t xcr0, bool osxsave) -> feature_set;
+    static auto supported() -> feature_set const &;
+    static auto usable() -> feature_set const &;
+    static auto runnable() -> feature_set const &;
+    static auto has(feature f) -> bool { return cpu_features::runnable().has(f); }
+    static constexpr auto info(feature f) -> feature_info const & { return feature_table[static_cast<std::size_t>(f)]; }
+    static constexpr auto name(feature f) -> std::string_view { return cpu_features::info(f).name; }
+
+    static auto print() -> void;
+};
+
+#endif //CUBE_FEATURES_HPP
@@ -0,0 +1,186 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <thread>
+
+#include "cpu.hpp"
+#include "cpuid.hpp"
+#include "sampler.hpp"
+#include "frequency.hpp"
+#include "tsc_clock.hpp"
+
+/**
+ * \brief Opens the MSR device (or the cpufreq file) of every online CPU and picks the source
+ *      APERF/MPERF exist when CPUID.6:ECX[0] is set; AMD's read-only copies when CPUID.80000007H:EDX[10] is.
+ *      Both come from the live CPUID: a replayed dump must not decide which MSRs are read
+ */
+auto frequency::discover() -> void {
+    cpuid_snapshot const & snapshot = cpuid_snapshot::host();
+    bool has_aperf = snapshot.max_leaf() >= 0x6 && (snapshot.query(0x6).ecx & 0x1);
+    if ((snapshot.query(0x80000007).edx >> 0xA) & 0x1) {
+        frequency::aperf_address = msr::amd_aperf_read_only;
+        frequency::mperf_address = msr::amd_mperf_read_only;
+    }
+
+    for (int id : cpu::online_cpus()) {
+        counter entry;
+        entry.cpu = id;
+        if (has_aperf) entry.device = msr(id);
+        frequency::counters.emplace_back(std::move(entry));
+    }
+
+    bool msr_usable = has_aperf && !frequency::counters.empty();
+    for (counter const & entry : frequency::counters) {
+        msr_usable = msr_usable && entry.device.is_open() && entry.device.read(frequency::aperf_address).has_value();
+    }
+
+    if (msr_usable) {
+        frequency::active = frequency_source::msr;
+    } else {
+        bool cpufreq_usable = !frequency::counters.empty();
+        for (counter & entry : frequency::counters) {
+            entry.device.close();
+            char path[0x60];
+            std::snprintf(path, sizeof(path), CPU_SCALING_CUR_FREQ, entry.cpu);
+            entry.scaling = proc_file(path, 0x20);
+            cpufreq_usable = cpufreq_usable && entry.scaling.is_open();
+        }
+        frequency::active = cpufreq_usable ? frequency_source::cpufreq : frequency_source::none;
+    }
+
+    frequency::results.resize(frequency::counters.size());
+    for (std::size_t i = 0x0; i < frequency::counters.size(); ++i) frequency::results[i].cpu = frequency::counters[i].cpu;
+}
+
+/**
+ * \brief Resolves the source, only the first call does work
+ * @return false when neither the MSRs nor cpufreq can be read
+ */
+auto frequency::init() -> bool {
+    std::call_once(frequency::initialized, frequency::discover);
+    return frequency::active != frequency_source::none;
+}
+
+/**
+ * \brief One pass over all CPUs: TSC, APERF and MPERF back to back per CPU, then the deltas
+ *      The first pass only primes the counters
+ * @return number of CPUs with a valid reading
+ */
+auto frequency::refresh_msr() -> std::size_t {
+    double const tsc_mhz = cube::tsc_clock::calibration().hz / 1e6;
+    std::size_t valid = 0x0;
+
+    for (std::size_t i = 0x0; i < frequency::counters.size(); ++i) {
+        counter & entry = frequency::counters[i];
+        core_frequency & result = frequency::results[i];
+
+        auto tsc = entry.device.read(msr::ia32_time_stamp_counter);
+        auto aperf = entry.device.read(frequency::aperf_address);
+        auto mperf = entry.device.read(frequency::mperf_address);
+        if (!tsc || !aperf || !mperf) {
+            result.valid = entry.primed = false;
+            continue;
+        }
+
+        std::uint64_t delta_tsc = *tsc - entry.tsc;
+        std::uint64_t delta_aperf = *aperf - entry.aperf;
+        std::uint64_t delta_mperf = *mperf - entry.mperf;
+        result.valid = entry.primed && delta_tsc > 0x0;
+
+        if (result.valid) {
+            result.effective_mhz = tsc_mhz * static_cast<double>(delta_aperf) / static_cast<double>(delta_tsc);
+            result.busy_mhz = delta_mperf ? tsc_mhz * static_cast<double>(delta_aperf) / static_cast<double>(delta_mperf) : 0.0;
+            result.c0_residency = 100.0 * static_cast<double>(delta_mperf) / static_cast<double>(delta_tsc);
+            ++valid;
+        }
+
+        entry.tsc = *tsc;
+        entry.aperf = *aperf;
+        entry.mperf = *mperf;
+        entry.primed = true;
+    }
+    return valid;
+}
+
+/**
+ * \brief Reads scaling_cur_freq (kHz) of every CPU; without APERF there is no busy/effective split
+ * @return number of CPUs with a valid reading
+ */
+auto frequency::refresh_cpufreq() -> std::size_t {
+    std::size_t valid = 0x0;
+
+    for (std::size_t i = 0x0; i < frequency::counters.size(); ++i) {
+        counter & entry = frequency::counters[i];
+        core_frequency & result = frequency::results[i];
+        std::string_view text = entry.scaling.read();
+
+        result.valid = !text.empty();
+        if (!result.valid) continue;
+
+        result.effective_mhz = result.busy_mhz = static_cast<double>(proc_scanner(text).next_u64()) / 1e3;
+        result.c0_residency = sampler::running() ? sampler::core(static_cast<std::size_t>(entry.cpu)) : -1.0;
+        ++valid;
+    }
+    return valid;
+}
+
+/**
+ * \brief Takes a new reading of every CPU
+ * @return number of CPUs with a valid reading
+ */
+auto frequency::refresh() -> std::size_t {
+    if (!frequency::init()) return 0x0;
+    return frequency::active == frequency_source::msr ? frequency::refresh_msr() : frequency::refresh_cpufreq();
+}
+
+auto frequency::cores() -> std::vector<core_frequency> const & {
+    return frequency::results;
+}
+
+auto frequency::source() -> frequency_source {
+    frequency::init();
+    return frequency::active;
+}
+
+auto frequency::source_name() -> char const * {
+    switch (frequency::source()) {
+        case frequency_source::msr: return "APERF/MPERF";
+        case frequency_source::cpufreq: return "cpufreq scaling_cur_freq";
+        default: return "none";
+    }
+}
+
+/**
+ * \brief Samples every CPU over one interval and prints effective, busy frequency and C0 residency
+ * @param interval Measurement interval
+ * @return exit status, 1 when no source is available
+ */
+auto frequency::print(std::chrono::milliseconds interval) -> int {
+    if (!frequency::init()) {
+        std::fprintf(stderr, "neither /dev/cpu/N/msr (modprobe msr, root) nor cpufreq is available\n");
+        return 0x1;
+    }
+
+    if (frequency::source() == frequency_source::cpufreq) sampler::start(interval);
+    frequency::refresh();
+    std::this_thread::sleep_for(interval);
+    if (frequency::source() == frequency_source::cpufreq) std::this_thread::sleep_for(interval / 0x4);
+    frequency::refresh();
+
+    std::printf("Source: %s, TSC %.0f MHz, interval %lld ms\n", frequency::source_name(),
+                cube::tsc_clock::calibration().hz / 1e6, static_cast<long long>(interval.count()));
+    std::printf("%5s %14s %10s %8s\n", "CPU", "Effective MHz", "Busy MHz", "C0 %");
+    for (core_frequency const & core : frequency::cores()) {
+        if (!core.valid) {
+            std::printf("%5d %14s %10s %8s\n", core.cpu, "-", "-", "-");
+        } else if (core.c0_residency < 0.0) {
+            std::printf("%5d %14.0f %10.0f %8s\n", core.cpu, core.effective_mhz, core.busy_mhz, "-");
+        } else {
+            std::printf("%5d %14.0f %10.0f %8.1f\n", core.cpu, core.effective_mhz, core.busy_mhz, core.c0_residency);
+        }
+    }
+    return 0x0;
+}
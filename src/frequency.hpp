@@ -0,0 +1,75 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_FREQUENCY_HPP
+#define CUBE_FREQUENCY_HPP
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#include "msr.hpp"
+#include "procfs.hpp"
+
+#define CPU_SCALING_CUR_FREQ "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq"
+
+enum class frequency_source { none, msr, cpufreq };
+
+/**
+ * \brief Frequency of one logical CPU over the last refresh interval
+ *      effective_mhz: average clock including idle time (delta APERF / elapsed time)
+ *      busy_mhz: average clock while in C0 (TSC frequency * delta APERF / delta MPERF)
+ *      c0_residency: percentage of the interval spent in C0 (delta MPERF / delta TSC), negative when unknown
+ */
+struct core_frequency {
+    int cpu { -0x1 };
+    double effective_mhz { 0.0 };
+    double busy_mhz { 0.0 };
+    double c0_residency { -1.0 };
+    bool valid { false };
+};
+
+/**
+ * \brief Per-core frequency collector
+ *      Reads IA32_APERF, IA32_MPERF and the TSC of every online CPU through /dev/cpu/N/msr in one
+ *      pass per refresh() (the read-only copies at C00000E7H/C00000E8H on AMD parts that have them).
+ *      Without the msr module, root or APERF/MPERF support it falls back to cpufreq's scaling_cur_freq,
+ *      which is a single instantaneous reading, and takes C0 residency from the sampler when it runs
+ */
+class frequency {
+public:
+    static auto init() -> bool;
+    static auto refresh() -> std::size_t;
+    static auto cores() -> std::vector<core_frequency> const &;
+    static auto source() -> frequency_source;
+    static auto source_name() -> char const *;
+    static auto print(std::chrono::milliseconds interval) -> int;
+
+private:
+    struct counter {
+        int cpu { -0x1 };
+        msr device;
+        proc_file scaling;
+        std::uint64_t aperf { 0x0 };
+        std::uint64_t mperf { 0x0 };
+        std::uint64_t tsc { 0x0 };
+        bool primed { false };
+    };
+
+    static inline std::once_flag initialized;
+    static inline frequency_source active { frequency_source::none };
+    static inline std::uint32_t aperf_address { msr::ia32_aperf };
+    static inline std::uint32_t mperf_address { msr::ia32_mperf };
+    static inline std::vector<counter> counters;
+    static inline std::vector<core_frequency> results;
+
+    static auto discover() -> void;
+    static auto refresh_msr() -> std::size_t;
+    static auto refresh_cpufreq() -> std::size_t;
+};
+
+#endif //CUBE_FREQUENCY_HPP
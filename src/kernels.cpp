@@ -0,0 +1,186 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <array>
+#include <cstring>
+#include <immintrin.h>
+
+#include "kernels.hpp"
+
+namespace cube {
+    namespace {
+        /*  ------------------------------------  Checksum  ------------------------------------  */
+
+        constexpr auto crc32c_table() -> std::array<std::uint32_t, 0x100> {
+            std::array<std::uint32_t, 0x100> table { };
+            for (std::uint32_t i = 0x0; i < 0x100; ++i) {
+                std::uint32_t crc = i;
+                for (int bit = 0x0; bit < 0x8; ++bit) crc = (crc >> 0x1) ^ ((crc & 0x1) ? 0x82F63B78 : 0x0);
+                table[i] = crc;
+            }
+            return table;
+        }
+
+        auto checksum_scalar(void const * data, std::size_t size) -> std::uint32_t {
+            static constexpr std::array<std::uint32_t, 0x100> table = crc32c_table();
+            auto const * p = static_cast<std::uint8_t const *>(data);
+            std::uint32_t crc = ~0x0U;
+            for (std::size_t i = 0x0; i < size; ++i) crc = (crc >> 0x8) ^ table[(crc ^ p[i]) & 0xFF];
+            return ~crc;
+        }
+
+        __attribute__((target("sse4.2")))
+        auto checksum_sse4_2(void const * data, std::size_t size) -> std::uint32_t {
+            auto const * p = static_cast<std::uint8_t const *>(data);
+            std::uint64_t crc = ~0x0U;
+            std::size_t i = 0x0;
+
+            for (; i + 0x8 <= size; i += 0x8) {
+                std::uint64_t word;
+                std::memcpy(&word, p + i, sizeof(word));
+                crc = _mm_crc32_u64(crc, word);
+            }
+            auto crc32 = static_cast<std::uint32_t>(crc);
+            for (; i < size; ++i) crc32 = _mm_crc32_u8(crc32, p[i]);
+            return ~crc32;
+        }
+
+        /*  ------------------------------------  Byte scan  ------------------------------------  */
+
+        auto find_byte_scalar(void const * data, std::size_t size, std::uint8_t byte) -> std::size_t {
+            auto const * p = static_cast<std::uint8_t const *>(data);
+            for (std::size_t i = 0x0; i < size; ++i) if (p[i] == byte) return i;
+            return size;
+        }
+
+        __attribute__((target("sse4.2")))
+        auto find_byte_sse4_2(void const * data, std::size_t size, std::uint8_t byte) -> std::size_t {
+            auto const * p = static_cast<std::uint8_t const *>(data);
+            __m128i needle = _mm_set1_epi8(static_cast<char>(byte));
+            std::size_t i = 0x0;
+
+            for (; i + 0x10 <= size; i += 0x10) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i));
+                auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+                if (mask) return i + static_cast<std::size_t>(__builtin_ctz(mask));
+            }
+            return i + find_byte_scalar(p + i, size - i, byte);
+        }
+
+        __attribute__((target("avx2")))
+        auto find_byte_avx2(void const * data, std::size_t size, std::uint8_t byte) -> std::size_t {
+            auto const * p = static_cast<std::uint8_t const *>(data);
+            __m256i needle = _mm256_set1_epi8(static_cast<char>(byte));
+            std::size_t i = 0x0;
+
+            for (; i + 0x20 <= size; i += 0x20) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + i));
+                auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+                if (mask) return i + static_cast<std::size_t>(__builtin_ctz(mask));
+            }
+            return i + find_byte_sse4_2(p + i, size - i, byte);
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        auto find_byte_avx512(void const * data, std::size_t size, std::uint8_t byte) -> std::size_t {
+            auto const * p = static_cast<std::uint8_t const *>(data);
+            __m512i needle = _mm512_set1_epi8(static_cast<char>(byte));
+            std::size_t i = 0x0;
+
+            for (; i + 0x40 <= size; i += 0x40) {
+                __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p + i), needle);
+                if (mask) return i + static_cast<std::size_t>(__builtin_ctzll(mask));
+            }
+            return i + find_byte_avx2(p + i, size - i, byte);
+        }
+
+        /*  ------------------------------------  Sum reduction  ------------------------------------  */
+
+        auto sum_scalar(std::uint32_t const * values, std::size_t count) -> std::uint64_t {
+            std::uint64_t a0 = 0x0, a1 = 0x0, a2 = 0x0, a3 = 0x0;
+            std::size_t i = 0x0;
+            for (; i + 0x4 <= count; i += 0x4) {
+                a0 += values[i];
+                a1 += values[i + 0x1];
+                a2 += values[i + 0x2];
+                a3 += values[i + 0x3];
+            }
+            for (; i < count; ++i) a0 += values[i];
+            return a0 + a1 + a2 + a3;
+        }
+
+        __attribute__((target("sse4.2")))
+        auto sum_sse4_2(std::uint32_t const * values, std::size_t count) -> std::uint64_t {
+            __m128i a0 = _mm_setzero_si128(), a1 = a0;
+            std::size_t i = 0x0;
+
+            for (; i + 0x4 <= count; i += 0x4) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(values + i));
+                a0 = _mm_add_epi64(a0, _mm_cvtepu32_epi64(block));
+                a1 = _mm_add_epi64(a1, _mm_cvtepu32_epi64(_mm_srli_si128(block, 0x8)));
+            }
+            __m128i total = _mm_add_epi64(a0, a1);
+            return static_cast<std::uint64_t>(_mm_cvtsi128_si64(total)) +
+                   static_cast<std::uint64_t>(_mm_extract_epi64(total, 0x1)) + sum_scalar(values + i, count - i);
+        }
+
+        __attribute__((target("avx2")))
+        auto sum_avx2(std::uint32_t const * values, std::size_t count) -> std::uint64_t {
+            __m256i a0 = _mm256_setzero_si256(), a1 = a0;
+            std::size_t i = 0x0;
+
+            for (; i + 0x8 <= count; i += 0x8) {
+                a0 = _mm256_add_epi64(a0, _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<__m128i const *>(values + i))));
+                a1 = _mm256_add_epi64(a1, _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<__m128i const *>(values + i + 0x4))));
+            }
+            __m256i total = _mm256_add_epi64(a0, a1);
+            __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 0x1));
+            return static_cast<std::uint64_t>(_mm_cvtsi128_si64(half)) +
+                   static_cast<std::uint64_t>(_mm_extract_epi64(half, 0x1)) + sum_scalar(values + i, count - i);
+        }
+
+        __attribute__((target("avx512f")))
+        auto sum_avx512(std::uint32_t const * values, std::size_t count) -> std::uint64_t {
+            __m512i a0 = _mm512_setzero_si512(), a1 = a0;
+            std::size_t i = 0x0;
+
+            for (; i + 0x10 <= count; i += 0x10) {
+                a0 = _mm512_add_epi64(a0, _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(values + i))));
+                a1 = _mm512_add_epi64(a1, _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(values + i + 0x8))));
+            }
+            return static_cast<std::uint64_t>(_mm512_reduce_add_epi64(_mm512_add_epi64(a0, a1))) +
+                   sum_scalar(values + i, count - i);
+        }
+    }
+
+    /**
+     * \brief CRC-32C, the SSE4.2 crc32 instruction covers every higher level as well
+     * @return dispatched kernel
+     */
+    auto reference_kernels::checksum() -> checksum_kernel & {
+        static checksum_kernel instance("checksum", {
+                { isa_level::scalar, checksum_scalar },
+                { isa_level::sse4_2, checksum_sse4_2 } });
+        return instance;
+    }
+
+    auto reference_kernels::find_byte() -> find_byte_kernel & {
+        static find_byte_kernel instance("find_byte", {
+                { isa_level::scalar, find_byte_scalar },
+                { isa_level::sse4_2, find_byte_sse4_2 },
+                { isa_level::avx2, find_byte_avx2 },
+                { isa_level::avx512, find_byte_avx512 } });
+        return instance;
+    }
+
+    auto reference_kernels::sum() -> sum_kernel & {
+        static sum_kernel instance("sum", {
+                { isa_level::scalar, sum_scalar },
+                { isa_level::sse4_2, sum_sse4_2 },
+                { isa_level::avx2, sum_avx2 },
+                { isa_level::avx512, sum_avx512 } });
+        return instance;
+    }
+}
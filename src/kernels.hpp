@@ -0,0 +1,35 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_KERNELS_HPP
+#define CUBE_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dispatch.hpp"
+
+namespace cube {
+    /**
+     * \brief Reference kernels of the dispatch framework, every variant returns the same result
+     *      checksum: CRC-32C (Castagnoli) of a byte range, seeded with 0
+     *      find_byte: index of the first occurrence of a byte, or the size when it does not occur
+     *      sum: 64 bit sum of 32 bit unsigned integers
+     *      Accessors instead of globals, so other translation units can use them during static initialization
+     */
+    class reference_kernels {
+    public:
+        using checksum_kernel = kernel<std::uint32_t(void const *, std::size_t)>;
+        using find_byte_kernel = kernel<std::size_t(void const *, std::size_t, std::uint8_t)>;
+        using sum_kernel = kernel<std::uint64_t(std::uint32_t const *, std::size_t)>;
+
+        static auto checksum() -> checksum_kernel &;
+        static auto find_byte() -> find_byte_kernel &;
+        static auto sum() -> sum_kernel &;
+    };
+}
+
+#endif //CUBE_KERNELS_HPP
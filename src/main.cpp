@@ -3,71 +3,167 @@
  * See LICENSE file for license details
  */
 
+#include <cstdio>
+#include <clocale>
+#include <cstdlib>
 #include <ncurses.h>
-#include <experimental/string_view>
+#include <string_view>
 
-auto main([[maybe_unused]] int argc, [[maybe_unused]] const char* argv[]) -> int {
-    /*  ------------------------------------  Tests  ------------------------------------  */
-
-    initscr();
-    noecho();
-    cbreak();
-    setlocale(LC_ALL, "");
-    endwin();
-    /*std::cout << "-------------------------------------------------------------------------" << std::endl;
-    bool invariant = cpu::supports_invariantTSC();
-
-    printf("Invariant TSC: %s\n", invariant ? "True" : "False");
+#include "c2c.hpp"
+#include "cgroup.hpp"
+#include "clocks.hpp"
+#include "cpu.hpp"
+#include "cpuid.hpp"
+#include "frequency.hpp"
+#include "dispatch.hpp"
+#include "exporter.hpp"
+#include "membench.hpp"
+#include "memory.hpp"
+#include "numa.hpp"
+#include "perf.hpp"
+#include "process.hpp"
+#include "rapl.hpp"
+#include "recorder.hpp"
+#include "topology.hpp"
+#include "tui.hpp"
+#include "tsc_clock.hpp"
+#include "tsc_sync.hpp"
 
-    if (!invariant) {
-        std::cout << "*** Without invariant TSC rdtsc is not a useful timer for wall clock time" << std::endl;
-        return 0x1;
+auto main([[maybe_unused]] int argc, [[maybe_unused]] const char* argv[]) -> int {
+    if (argc > 0x2 && std::string_view(argv[0x1]) == "--cpuid-replay") {
+        auto snapshot = cpuid_snapshot::load(argv[0x2]);
+        if (!snapshot) {
+            std::fprintf(stderr, "cannot read a CPUID dump from %s\n", argv[0x2]);
+            return 0x1;
+        }
+        cpuid_snapshot::install(std::move(*snapshot));
+        argc -= 0x2;
+        argv += 0x2;
     }
 
-    char const * source;
-    double res;
+    cube::isa::initialize();
+    std::string_view mode = (argc > 0x1) ? argv[0x1] : "";
 
-    if (cpu::extract_leaf_15H(&res)) {
-        source = "leaf 15H";
-
-    } else if (cpu::read_HW_tick_from_name(&res)) {
-        source = "model name string";
-
-    } else {
-        res = cpu::measure_TSC_tick();
-        source = "measurement";
+    if (mode == "--cpuid-dump") {
+        if (argc > 0x2) return cpuid_snapshot::get().save(argv[0x2]) ? 0x0 : 0x1;
+        return cpuid_snapshot::get().save("/dev/stdout") ? 0x0 : 0x1;
     }
+    if (mode == "--tsc") return cube::tsc_clock::print();
+    if (mode == "--clocks") {
+        std::size_t calls = (argc > 0x2) ? std::strtoull(argv[0x2], nullptr, 0xA) : 0x4E20;
+        return clocks::print(clocks::run(std::max<std::size_t>(calls, 0x64)));
+    }
+    if (mode == "--tsc-sync") {
+        tsc_sync_options options;
+        if (argc > 0x2) options.rounds = std::max<std::size_t>(std::strtoull(argv[0x2], nullptr, 0xA), 0x1);
+        if (argc > 0x3) options.tolerance_ns = std::strtod(argv[0x3], nullptr);
+        cpu_topology layout = topology::enumerate();
+        return tsc_sync::print(layout, tsc_sync::run(layout, options), options);
+    }
+    if (mode == "--features") {
+        cpu::print_instructions();
+        return 0x0;
+    }
+    if (mode == "--topology") {
+        cpu_topology layout = topology::enumerate();
+        topology::print(layout);
+        return layout.mismatches.empty() ? 0x0 : 0x1;
+    }
+    if (mode == "--c2c") {
+        cpu_topology layout = topology::enumerate();
+        if (layout.cpus.size() < 0x2) {
+            std::fprintf(stderr, "core-to-core latency needs at least two online CPUs\n");
+            return 0x1;
+        }
 
-    printf ("From %s frequency %sz => %s\n",
-            source,
-            cpu::format_SI(1./res,0x9,'H').c_str(),
-            cpu::format_SI(res,0x9,'s').c_str());
-
-    double measured = cpu::measure_TSC_tick();
-
-    printf ("Sanity check against std::chrono::steady_clock gives frequency %sz => %s\n",
-            cpu::format_SI(1./measured,0x9,'H').c_str(),
-            cpu::format_SI(measured,0x9,'s').c_str());
+        c2c_options options;
+        if (argc > 0x2 && std::string_view(argv[0x2]) == "fast") {
+            options.samples = 0x3;
+            options.round_trips = 0x3E8;
+            options.max_pairs = (argc > 0x3) ? std::strtoull(argv[0x3], nullptr, 0xA) : 0x400;
+        }
+        c2c::print(layout, c2c::run(layout, options));
+        return 0x0;
+    }
+    if (mode == "--freq") {
+        long long interval = (argc > 0x2) ? std::strtoll(argv[0x2], nullptr, 0xA) : 0x3E8;
+        return frequency::print(std::chrono::milliseconds(std::max(interval, 0xALL)));
+    }
+    if (mode == "--power") {
+        long long interval = (argc > 0x2) ? std::strtoll(argv[0x2], nullptr, 0xA) : 0x3E8;
+        return rapl::print(std::chrono::milliseconds(std::max(interval, 0xALL)));
+    }
+    if (mode == "--perf") {
+        long long interval = (argc > 0x2) ? std::strtoll(argv[0x2], nullptr, 0xA) : 0x3E8;
+        return perf::print(std::chrono::milliseconds(std::max(interval, 0xALL)));
+    }
+    if (mode == "--memory") {
+        long long interval = (argc > 0x2) ? std::strtoll(argv[0x2], nullptr, 0xA) : 0x3E8;
+        return memory::print(std::chrono::milliseconds(std::max(interval, 0xALL)));
+    }
+    if (mode == "--cgroup") {
+        long long interval = (argc > 0x2) ? std::strtoll(argv[0x2], nullptr, 0xA) : 0x3E8;
+        return cgroup::print(std::chrono::milliseconds(std::max(interval, 0xALL)), (argc > 0x3) ? argv[0x3] : "");
+    }
+    if (mode == "--top") {
+        std::size_t count = (argc > 0x2) ? std::strtoull(argv[0x2], nullptr, 0xA) : 0x14;
+        long long interval = (argc > 0x3) ? std::strtoll(argv[0x3], nullptr, 0xA) : 0x3E8;
+        process_table::raise_descriptor_limit();
+        return process_table::print(count, std::chrono::milliseconds(std::max(interval, 0xALL)));
+    }
+    if (mode == "--serve") {
+        exporter_options options;
+        if (argc > 0x2) options.address = argv[0x2];
+        if (argc > 0x3) options.interval = std::chrono::milliseconds(std::max(std::strtoll(argv[0x3], nullptr, 0xA), 0x64LL));
+        return exporter::serve(options);
+    }
+    if (mode == "--record" && argc > 0x2) {
+        std::size_t mib = (argc > 0x3) ? std::strtoull(argv[0x3], nullptr, 0xA) : 0x8;
+        long long interval = (argc > 0x4) ? std::strtoll(argv[0x4], nullptr, 0xA) : 0x3E8;
+        return recorder::run(argv[0x2], std::max<std::size_t>(mib, 0x1) << 0x14, std::chrono::milliseconds(std::max(interval, 0xALL)));
+    }
+    if (mode == "--replay" && argc > 0x2) {
+        auto record = timeseries_file::load(argv[0x2]);
+        if (!record || record->frames.empty()) {
+            std::fprintf(stderr, "no recorded frames in %s\n", argv[0x2]);
+            return 0x1;
+        }
+        setlocale(LC_ALL, "");
+        initscr();
+        noecho();
+        cbreak();
+        tui::replay(*record);
+        endwin();
+        return 0x0;
+    }
+    if (mode == "--cache") {
+        cpu::get_cache_info();
+        return 0x0;
+    }
+    if (mode == "--memprobe") {
+        std::size_t max_mib = (argc > 0x2) ? std::strtoull(argv[0x2], nullptr, 0xA) : 0x100;
+        return membench::run(std::max<std::size_t>(max_mib, 0x1) << 0x14);
+    }
+    if (mode == "--numa") {
+        std::size_t mib = (argc > 0x2) ? std::strtoull(argv[0x2], nullptr, 0xA) : 0x100;
+        std::size_t bytes = std::max<std::size_t>(mib, 0x2) << 0x14;
+        numa::print(numa::run(bytes), bytes);
+        return 0x0;
+    }
 
-    uint64_t minTicks = cpu::measure_clock_granularity();
-    res = res*(double)minTicks;
+    if (!mode.empty() && mode != "--fps") {
+        std::fprintf(stderr, "unknown mode %.*s, see README.txt\n", static_cast<int>(mode.size()), mode.data());
+        return 0x1;
+    }
 
-    printf ("Measured granularity = %llu tick%s => %sz, %s\n",
-            (unsigned long long)minTicks, minTicks != 0x1 ? "s": "", cpu::format_SI(1./res,0x9,'H').c_str(),
-            cpu::format_SI(res,0x9,'s').c_str());
+    tui_options options;
+    if (mode == "--fps" && argc > 0x2) options.fps = std::atoi(argv[0x2]);
 
-    std::cout << "-------------------------------------------------------------------------" << std::endl;
-    cpu::get_both_cores();
-    std::cout << "-------------------------------------------------------------------------" << std::endl;
-    cpu::print_instructions();
-    std::cout << "-------------------------------------------------------------------------" << std::endl;
-    std::cout << "Cube version: " << cube::version() << std::endl;
-    std::cout << cpu::vendor_id() << std::endl;
-    cpu::get_cpu_id();
-    std::cout << std::endl;
-    std::cout << "-------------------------------------------------------------------------" << std::endl;
-    std::cout << physmem_total() << std::endl;
-    std::cout << physmem_available() << std::endl;
-    std::cout << "-------------------------------------------------------------------------" << std::endl;*/
+    setlocale(LC_ALL, "");
+    initscr();
+    noecho();
+    cbreak();
+    tui::draw(options);
+    endwin();
     return 0x0;
 }
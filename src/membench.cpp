@@ -0,0 +1,336 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <numeric>
+#include <sched.h>
+#include <algorithm>
+#include <sys/mman.h>
+#include <immintrin.h>
+
+#include "cpu.hpp"
+#include "bench.hpp"
+#include "cache.hpp"
+#include "features.hpp"
+#include "membench.hpp"
+#include "tsc_clock.hpp"
+
+/*  ------------------------------------  Streaming kernels  ------------------------------------  */
+
+static auto read_scalar(void const * buffer, std::size_t bytes) -> std::uint64_t {
+    auto const * p = static_cast<std::uint64_t const *>(buffer);
+    std::uint64_t a0 = 0x0, a1 = 0x0, a2 = 0x0, a3 = 0x0;
+    for (std::size_t i = 0x0; i < bytes / 0x8; i += 0x4) {
+        a0 |= p[i];
+        a1 |= p[i + 0x1];
+        a2 |= p[i + 0x2];
+        a3 |= p[i + 0x3];
+    }
+    return a0 | a1 | a2 | a3;
+}
+
+static auto write_scalar(void * buffer, std::size_t bytes) -> void {
+    auto * p = static_cast<std::uint64_t *>(buffer);
+    for (std::size_t i = 0x0; i < bytes / 0x8; ++i) p[i] = i;
+}
+
+static auto copy_scalar(void * destination, void const * source, std::size_t bytes) -> void {
+    auto * d = static_cast<std::uint64_t *>(destination);
+    auto const * s = static_cast<std::uint64_t const *>(source);
+    for (std::size_t i = 0x0; i < bytes / 0x8; ++i) d[i] = s[i];
+}
+
+static auto read_sse2(void const * buffer, std::size_t bytes) -> std::uint64_t {
+    auto const * p = static_cast<__m128i const *>(buffer);
+    __m128i a0 = _mm_setzero_si128(), a1 = a0, a2 = a0, a3 = a0;
+    for (std::size_t i = 0x0; i < bytes / 0x10; i += 0x4) {
+        a0 = _mm_or_si128(a0, _mm_load_si128(p + i));
+        a1 = _mm_or_si128(a1, _mm_load_si128(p + i + 0x1));
+        a2 = _mm_or_si128(a2, _mm_load_si128(p + i + 0x2));
+        a3 = _mm_or_si128(a3, _mm_load_si128(p + i + 0x3));
+    }
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(_mm_or_si128(_mm_or_si128(a0, a1), _mm_or_si128(a2, a3))));
+}
+
+static auto write_sse2(void * buffer, std::size_t bytes) -> void {
+    auto * p = static_cast<__m128i *>(buffer);
+    __m128i value = _mm_set1_epi32(0x5A5A5A5A);
+    for (std::size_t i = 0x0; i < bytes / 0x10; ++i) _mm_store_si128(p + i, value);
+}
+
+static auto copy_sse2(void * destination, void const * source, std::size_t bytes) -> void {
+    auto * d = static_cast<__m128i *>(destination);
+    auto const * s = static_cast<__m128i const *>(source);
+    for (std::size_t i = 0x0; i < bytes / 0x10; ++i) _mm_store_si128(d + i, _mm_load_si128(s + i));
+}
+
+__attribute__((target("avx")))
+static auto read_avx(void const * buffer, std::size_t bytes) -> std::uint64_t {
+    auto const * p = static_cast<float const *>(buffer);
+    __m256 a0 = _mm256_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+    for (std::size_t i = 0x0; i < bytes / 0x4; i += 0x20) {
+        a0 = _mm256_or_ps(a0, _mm256_load_ps(p + i));
+        a1 = _mm256_or_ps(a1, _mm256_load_ps(p + i + 0x8));
+        a2 = _mm256_or_ps(a2, _mm256_load_ps(p + i + 0x10));
+        a3 = _mm256_or_ps(a3, _mm256_load_ps(p + i + 0x18));
+    }
+    return static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(a0, a1), _mm256_or_ps(a2, a3))));
+}
+
+__attribute__((target("avx")))
+static auto write_avx(void * buffer, std::size_t bytes) -> void {
+    auto * p = static_cast<float *>(buffer);
+    __m256 value = _mm256_set1_ps(1.0f);
+    for (std::size_t i = 0x0; i < bytes / 0x4; i += 0x8) _mm256_store_ps(p + i, value);
+}
+
+__attribute__((target("avx")))
+static auto copy_avx(void * destination, void const * source, std::size_t bytes) -> void {
+    auto * d = static_cast<float *>(destination);
+    auto const * s = static_cast<float const *>(source);
+    for (std::size_t i = 0x0; i < bytes / 0x4; i += 0x8) _mm256_store_ps(d + i, _mm256_load_ps(s + i));
+}
+
+__attribute__((target("avx512f")))
+static auto read_avx512(void const * buffer, std::size_t bytes) -> std::uint64_t {
+    auto const * p = static_cast<__m512i const *>(buffer);
+    __m512i a0 = _mm512_setzero_si512(), a1 = a0, a2 = a0, a3 = a0;
+    for (std::size_t i = 0x0; i < bytes / 0x40; i += 0x4) {
+        a0 = _mm512_or_si512(a0, _mm512_load_si512(p + i));
+        a1 = _mm512_or_si512(a1, _mm512_load_si512(p + i + 0x1));
+        a2 = _mm512_or_si512(a2, _mm512_load_si512(p + i + 0x2));
+        a3 = _mm512_or_si512(a3, _mm512_load_si512(p + i + 0x3));
+    }
+    return static_cast<std::uint64_t>(_mm512_reduce_or_epi64(_mm512_or_si512(_mm512_or_si512(a0, a1), _mm512_or_si512(a2, a3))));
+}
+
+__attribute__((target("avx512f")))
+static auto write_avx512(void * buffer, std::size_t bytes) -> void {
+    auto * p = static_cast<__m512i *>(buffer);
+    __m512i value = _mm512_set1_epi32(0x5A5A5A5A);
+    for (std::size_t i = 0x0; i < bytes / 0x40; ++i) _mm512_store_si512(p + i, value);
+}
+
+__attribute__((target("avx512f")))
+static auto copy_avx512(void * destination, void const * source, std::size_t bytes) -> void {
+    auto * d = static_cast<__m512i *>(destination);
+    auto const * s = static_cast<__m512i const *>(source);
+    for (std::size_t i = 0x0; i < bytes / 0x40; ++i) _mm512_store_si512(d + i, _mm512_load_si512(s + i));
+}
+
+/*  ------------------------------------  Probe  ------------------------------------  */
+
+/**
+ * \brief Releases a buffer obtained from allocate()
+ * @param address Start of the mapping
+ */
+auto membench::unmap::operator()(void * address) const -> void {
+    if (address) munmap(address, bytes);
+}
+
+/**
+ * \brief Maps an anonymous, page aligned buffer and asks for transparent huge pages
+ *      so TLB misses do not dominate the large working sets
+ * @param bytes Size of the buffer
+ * @return owning pointer, empty when the mapping failed
+ */
+auto membench::allocate(std::size_t bytes) -> membench::buffer {
+    void * address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -0x1, 0x0);
+    if (address == MAP_FAILED) return membench::buffer(nullptr, { bytes });
+    madvise(address, bytes, MADV_HUGEPAGE);
+    return membench::buffer(address, { bytes });
+}
+
+/**
+ * \brief Picks the widest streaming kernels the live CPU runs (cpu_features::has() checks runnable()), once
+ *      Under --cpuid-replay a dump can select narrower kernels, never wider ones
+ * @return kernels shared by all measurements
+ */
+auto membench::kernels() -> stream_kernels const & {
+    static stream_kernels const selected = [] {
+        if (cpu_features::has(feature::avx512f)) return stream_kernels { "AVX-512", read_avx512, write_avx512, copy_avx512 };
+        if (cpu_features::has(feature::avx)) return stream_kernels { "AVX", read_avx, write_avx, copy_avx };
+        if (cpu_features::has(feature::sse2)) return stream_kernels { "SSE2", read_sse2, write_sse2, copy_sse2 };
+        return stream_kernels { "scalar", read_scalar, write_scalar, copy_scalar };
+    }();
+    return selected;
+}
+
+/**
+ * \brief Links every cache line of the buffer into one random cycle (Sattolo's algorithm),
+ *      so each load depends on the previous one and the prefetchers cannot guess the next line
+ * @param base Buffer, at least one cache line
+ * @param bytes Size of the working set
+ * @param seed Seed of the xorshift generator
+ */
+auto membench::prepare_chase(void * base, std::size_t bytes, std::uint64_t seed) -> void {
+    std::size_t lines = std::max<std::size_t>(bytes / 0x40, 0x1);
+    std::vector<std::uint32_t> order(lines);
+    std::iota(order.begin(), order.end(), 0x0);
+
+    for (std::size_t i = lines - 0x1; i > 0x0; --i) {
+        seed ^= seed << 0xD;
+        seed ^= seed >> 0x7;
+        seed ^= seed << 0x11;
+        std::swap(order[i], order[seed % i]);
+    }
+
+    auto * bytes_base = static_cast<char *>(base);
+    for (std::size_t i = 0x0; i < lines; ++i) {
+        *reinterpret_cast<void **>(bytes_base + static_cast<std::size_t>(order[i]) * 0x40) =
+                bytes_base + static_cast<std::size_t>(order[(i + 0x1) % lines]) * 0x40;
+    }
+}
+
+/**
+ * \brief Follows the chain built by prepare_chase()
+ * @param base Buffer prepared by prepare_chase()
+ * @param steps Number of dependent loads
+ * @return average load-to-use latency in nanoseconds
+ */
+auto membench::chase(void const * base, std::size_t steps) -> double {
+    void * const * p = static_cast<void * const *>(base);
+    steps &= ~static_cast<std::size_t>(0x7);
+
+    std::uint64_t start = cube::tsc_clock::ticks_serialized();
+    for (std::size_t i = 0x0; i < steps; i += 0x8) {
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+        p = static_cast<void * const *>(*p);
+    }
+    std::uint64_t end = cube::tsc_clock::ticks_serialized();
+    cube::do_not_optimize(p);
+
+    return static_cast<double>(cube::tsc_clock::to_duration(end - start).count()) / static_cast<double>(steps);
+}
+
+/**
+ * \brief Reads the buffer repeatedly with the selected kernel
+ * @return bandwidth in GB/s
+ */
+auto membench::read_bandwidth(void const * base, std::size_t bytes, std::size_t passes) -> double {
+    stream_kernels const & k = membench::kernels();
+    std::uint64_t sink = 0x0;
+
+    std::uint64_t start = cube::tsc_clock::ticks_serialized();
+    for (std::size_t pass = 0x0; pass < passes; ++pass) sink += k.read(base, bytes);
+    std::uint64_t end = cube::tsc_clock::ticks_serialized();
+    cube::do_not_optimize(sink);
+
+    return static_cast<double>(bytes * passes) / static_cast<double>(cube::tsc_clock::to_duration(end - start).count());
+}
+
+/**
+ * \brief Writes the buffer repeatedly with the selected kernel
+ * @return bandwidth in GB/s
+ */
+auto membench::write_bandwidth(void * base, std::size_t bytes, std::size_t passes) -> double {
+    stream_kernels const & k = membench::kernels();
+
+    std::uint64_t start = cube::tsc_clock::ticks_serialized();
+    for (std::size_t pass = 0x0; pass < passes; ++pass) {
+        k.write(base, bytes);
+        cube::do_not_optimize(base);
+    }
+    std::uint64_t end = cube::tsc_clock::ticks_serialized();
+
+    return static_cast<double>(bytes * passes) / static_cast<double>(cube::tsc_clock::to_duration(end - start).count());
+}
+
+/**
+ * \brief Copies source into destination repeatedly with the selected kernel
+ * @return bandwidth in GB/s, counting bytes read plus bytes written as STREAM does
+ */
+auto membench::copy_bandwidth(void * destination, void const * source, std::size_t bytes, std::size_t passes) -> double {
+    stream_kernels const & k = membench::kernels();
+
+    std::uint64_t start = cube::tsc_clock::ticks_serialized();
+    for (std::size_t pass = 0x0; pass < passes; ++pass) {
+        k.copy(destination, source, bytes);
+        cube::do_not_optimize(destination);
+    }
+    std::uint64_t end = cube::tsc_clock::ticks_serialized();
+
+    return static_cast<double>(0x2 * bytes * passes) / static_cast<double>(cube::tsc_clock::to_duration(end - start).count());
+}
+
+/**
+ * \brief Measures latency and bandwidth for one working set size
+ * @param bytes Working set, a multiple of 256 bytes
+ * @return measured point, zeros when the buffer could not be allocated
+ */
+auto membench::measure(std::size_t bytes) -> memory_point {
+    memory_point point;
+    point.bytes = bytes;
+
+    membench::buffer memory = membench::allocate(bytes);
+    if (!memory) return point;
+
+    std::size_t lines = bytes / 0x40;
+    membench::prepare_chase(memory.get(), bytes);
+    membench::chase(memory.get(), std::min<std::size_t>(lines, 0x100000));
+    point.latency_ns = membench::chase(memory.get(), std::clamp<std::size_t>(lines * 0x2, 0x100000, 0x800000));
+
+    std::size_t passes = std::max<std::size_t>((0x10000000 / bytes), 0x1);
+    std::size_t half = (bytes / 0x2) & ~static_cast<std::size_t>(0xFF);
+    membench::write_bandwidth(memory.get(), bytes, 0x1);
+    point.write_gbs = membench::write_bandwidth(memory.get(), bytes, passes);
+    point.read_gbs = membench::read_bandwidth(memory.get(), bytes, passes);
+    if (half) point.copy_gbs = membench::copy_bandwidth(memory.get(), static_cast<char *>(memory.get()) + half, half, passes);
+    return point;
+}
+
+/**
+ * \brief Measures working sets from min_bytes to max_bytes in steps of 1x and 1.5x powers of two
+ * @return one point per size
+ */
+auto membench::sweep(std::size_t min_bytes, std::size_t max_bytes) -> std::vector<memory_point> {
+    std::vector<memory_point> points;
+
+    for (std::size_t bytes = min_bytes; bytes <= max_bytes; bytes *= 0x2) {
+        points.push_back(membench::measure(bytes));
+        std::size_t between = bytes + bytes / 0x2;
+        if (between <= max_bytes) points.push_back(membench::measure(between));
+    }
+    return points;
+}
+
+/**
+ * \brief Prints the latency-vs-size curve with the CPUID cache boundaries marked
+ * @param max_bytes Largest working set
+ * @return 0x0 (usable as exit status)
+ */
+auto membench::run(std::size_t max_bytes) -> int {
+    std::vector<cache_level> caches = cache_hierarchy::enumerate();
+    std::erase_if(caches, [](cache_level const & c) { return c.type == cache_type::instruction; });
+    std::sort(caches.begin(), caches.end(), [](cache_level const & a, cache_level const & b) { return a.level < b.level; });
+
+    int current = sched_getcpu();
+    cpu::pin_thread(current);
+
+    cube::tsc_calibration const & clock = cube::tsc_clock::calibration();
+    std::printf("Memory probe on CPU %d, %s kernels, TSC %.3f GHz (%s)\n", current, membench::kernels().name,
+                clock.hz / 1.e9, cube::tsc_clock::source_name(clock.source));
+    std::printf("%12s %12s %12s %12s %12s\n", "Working set", "Latency ns", "Read GB/s", "Write GB/s", "Copy GB/s");
+
+    std::size_t level = 0x0;
+    for (memory_point const & point : membench::sweep(0x1000, max_bytes)) {
+        while (level < caches.size() && point.bytes > caches[level].size) {
+            std::printf("  ---- %s %llu KiB ----\n", caches[level].name().c_str(),
+                        static_cast<unsigned long long>(caches[level].size / 0x400));
+            ++level;
+        }
+
+        std::printf("%8zu KiB %12.2f %12.2f %12.2f %12.2f\n", point.bytes / 0x400,
+                    point.latency_ns, point.read_gbs, point.write_gbs, point.copy_gbs);
+        std::fflush(stdout);
+    }
+    return 0x0;
+}
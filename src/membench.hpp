@@ -0,0 +1,59 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_MEMBENCH_HPP
+#define CUBE_MEMBENCH_HPP
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+/**
+ * \brief One point of the latency / bandwidth curve, bandwidth in GB/s (10^9 bytes per second)
+ */
+struct memory_point {
+    std::size_t bytes { 0x0 };
+    double latency_ns { 0.0 };
+    double read_gbs { 0.0 };
+    double write_gbs { 0.0 };
+    double copy_gbs { 0.0 };
+};
+
+/**
+ * \brief Streaming kernels for one instruction set, all buffers 64 byte aligned and sized in multiples of 256 bytes
+ */
+struct stream_kernels {
+    char const * name;
+    auto (* read)(void const * buffer, std::size_t bytes) -> std::uint64_t;
+    auto (* write)(void * buffer, std::size_t bytes) -> void;
+    auto (* copy)(void * destination, void const * source, std::size_t bytes) -> void;
+};
+
+/**
+ * \brief Memory hierarchy probe: randomized pointer chase for load-to-use latency and
+ *      read/write/copy streaming kernels for bandwidth, both timed with cube::tsc_clock
+ */
+class membench {
+public:
+    struct unmap {
+        std::size_t bytes;
+        auto operator()(void * address) const -> void;
+    };
+    using buffer = std::unique_ptr<void, unmap>;
+
+    static auto allocate(std::size_t bytes) -> buffer;
+    static auto kernels() -> stream_kernels const &;
+    static auto prepare_chase(void * base, std::size_t bytes, std::uint64_t seed = 0x2545F4914F6CDD1D) -> void;
+    static auto chase(void const * base, std::size_t steps) -> double;
+    static auto read_bandwidth(void const * base, std::size_t bytes, std::size_t passes) -> double;
+    static auto write_bandwidth(void * base, std::size_t bytes, std::size_t passes) -> double;
+    static auto copy_bandwidth(void * destination, void const * source, std::size_t bytes, std::size_t passes) -> double;
+    static auto measure(std::size_t bytes) -> memory_point;
+    static auto sweep(std::size_t min_bytes, std::size_t max_bytes) -> std::vector<memory_point>;
+    static auto run(std::size_t max_bytes) -> int;
+};
+
+#endif //CUBE_MEMBENCH_HPP
@@ -0,0 +1,374 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <cstdlib>
+#include <dirent.h>
+#include <algorithm>
+
+#include "memory.hpp"
+
+namespace {
+    struct meminfo_field {
+        std::string_view key;
+        std::uint64_t memory_info::* member;
+        bool pages;
+    };
+
+    /* HugePages_* are page counts, everything else is in kB */
+    constexpr meminfo_field meminfo_fields[] {
+        { "MemTotal:", &memory_info::total, false },
+        { "MemFree:", &memory_info::free, false },
+        { "MemAvailable:", &memory_info::available, false },
+        { "Buffers:", &memory_info::buffers, false },
+        { "Cached:", &memory_info::cached, false },
+        { "SwapCached:", &memory_info::swap_cached, false },
+        { "Active(anon):", &memory_info::active_anon, false },
+        { "Inactive(anon):", &memory_info::inactive_anon, false },
+        { "Active(file):", &memory_info::active_file, false },
+        { "Inactive(file):", &memory_info::inactive_file, false },
+        { "Dirty:", &memory_info::dirty, false },
+        { "Writeback:", &memory_info::writeback, false },
+        { "AnonPages:", &memory_info::anon_pages, false },
+        { "Mapped:", &memory_info::mapped, false },
+        { "Shmem:", &memory_info::shmem, false },
+        { "SReclaimable:", &memory_info::slab_reclaimable, false },
+        { "SUnreclaim:", &memory_info::slab_unreclaimable, false },
+        { "PageTables:", &memory_info::page_tables, false },
+        { "SwapTotal:", &memory_info::swap_total, false },
+        { "SwapFree:", &memory_info::swap_free, false },
+        { "Committed_AS:", &memory_info::committed, false },
+        { "CommitLimit:", &memory_info::commit_limit, false },
+        { "AnonHugePages:", &memory_info::anon_huge, false },
+        { "HugePages_Total:", &memory_info::huge_total, true },
+        { "HugePages_Free:", &memory_info::huge_free, true },
+        { "HugePages_Rsvd:", &memory_info::huge_reserved, true },
+        { "HugePages_Surp:", &memory_info::huge_surplus, true },
+        { "Hugepagesize:", &memory_info::huge_page_size, false },
+    };
+
+    struct vmstat_field {
+        std::string_view key;
+        vmstat_counter counter;
+        bool prefix;
+    };
+
+    /*
+     * Prefix entries sum per-zone variants (allocstall_normal, allocstall_movable, ... and the
+     * pgscan_kswapd_<zone> spelling of older kernels). pgscan_direct_throttle counts throttling
+     * events, not pages, so it is matched first and dropped
+     */
+    constexpr vmstat_field vmstat_fields[] {
+        { "pgfault", vmstat_counter::page_faults, false },
+        { "pgmajfault", vmstat_counter::major_faults, false },
+        { "pswpin", vmstat_counter::swap_in, false },
+        { "pswpout", vmstat_counter::swap_out, false },
+        { "pgpgin", vmstat_counter::page_in, false },
+        { "pgpgout", vmstat_counter::page_out, false },
+        { "pgscan_direct_throttle", vmstat_counter::count, false },
+        { "pgscan_kswapd", vmstat_counter::scan_kswapd, true },
+        { "pgscan_direct", vmstat_counter::scan_direct, true },
+        { "pgsteal_kswapd", vmstat_counter::steal_kswapd, true },
+        { "pgsteal_direct", vmstat_counter::steal_direct, true },
+        { "allocstall", vmstat_counter::direct_stalls, true },
+        { "thp_fault_alloc", vmstat_counter::thp_fault_alloc, false },
+        { "thp_collapse_alloc", vmstat_counter::thp_collapse_alloc, false },
+        { "thp_split_page", vmstat_counter::thp_split, false },
+        { "compact_stall", vmstat_counter::compact_stall, false },
+        { "oom_kill", vmstat_counter::oom_kill, false },
+        { "numa_hit", vmstat_counter::numa_hit, false },
+        { "numa_miss", vmstat_counter::numa_miss, false },
+    };
+
+    constexpr std::string_view numastat_keys[] { "numa_hit", "numa_miss", "other_node" };
+
+    /**
+     * \brief Collects the numeric suffixes of the directory entries "<prefix>N<suffix>", sorted
+     */
+    auto list_numbered(char const * path, std::string_view prefix, std::string_view suffix) -> std::vector<std::uint64_t> {
+        std::vector<std::uint64_t> numbers;
+        DIR * directory = opendir(path);
+        if (!directory) return numbers;
+
+        while (dirent const * entry = readdir(directory)) {
+            std::string_view name(entry->d_name);
+            if (name.size() <= prefix.size() + suffix.size() || name.substr(0x0, prefix.size()) != prefix
+                || name.substr(name.size() - suffix.size()) != suffix) continue;
+
+            std::string_view digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+            if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) continue;
+            numbers.push_back(std::strtoull(std::string(digits).c_str(), nullptr, 0xA));
+        }
+        closedir(directory);
+
+        std::sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+}
+
+/**
+ * \brief Opens meminfo, vmstat and the files of every NUMA node and hugepage size
+ *      Nodes and pool sizes are fixed at boot (hotplug aside), so they are enumerated only here
+ */
+auto memory::discover() -> void {
+    memory::meminfo_file = proc_file(PROC_MEMINFO, 0x1000);
+    memory::vmstat_file = proc_file(PROC_VMSTAT, 0x2000);
+
+    for (std::uint64_t node : list_numbered(NODE_SYSFS, "node", "")) {
+        std::string base = std::string(NODE_SYSFS "/node") + std::to_string(node);
+        memory::node_handles.push_back({ proc_file((base + "/meminfo").c_str(), 0x1000),
+                                         proc_file((base + "/numastat").c_str(), 0x200), { } });
+        memory_node stats;
+        stats.node = static_cast<int>(node);
+        memory::node_stats.push_back(stats);
+    }
+
+    for (std::uint64_t kilobytes : list_numbered(HUGEPAGES_SYSFS, "hugepages-", "kB")) {
+        std::string base = std::string(HUGEPAGES_SYSFS "/hugepages-") + std::to_string(kilobytes) + "kB/";
+        memory::pool_handles.push_back({ proc_file((base + "nr_hugepages").c_str(), 0x20),
+                                         proc_file((base + "free_hugepages").c_str(), 0x20),
+                                         proc_file((base + "resv_hugepages").c_str(), 0x20),
+                                         proc_file((base + "surplus_hugepages").c_str(), 0x20) });
+        hugepage_pool pool;
+        pool.page_size = kilobytes * 0x400;
+        memory::pools.push_back(pool);
+    }
+}
+
+/**
+ * \brief Opens every file and takes the first sample, only the first call does work
+ * @return false when /proc/meminfo is not readable
+ */
+auto memory::init() -> bool {
+    std::call_once(memory::initialized, [] {
+        memory::discover();
+        memory::available = memory::meminfo_file.is_open();
+        if (memory::available) memory::refresh();
+    });
+    return memory::available;
+}
+
+auto memory::read_meminfo() -> bool {
+    std::string_view text = memory::meminfo_file.read();
+    if (text.empty()) return memory::current.valid = false;
+
+    for (proc_scanner scanner(text); !scanner.done(); scanner.next_line()) {
+        std::string_view key = scanner.next_word();
+        for (meminfo_field const & field : meminfo_fields) {
+            if (field.key != key) continue;
+            std::uint64_t value = scanner.next_u64();
+            memory::current.*field.member = field.pages ? value : value * 0x400;
+            break;
+        }
+    }
+    return memory::current.valid = true;
+}
+
+auto memory::read_vmstat(double seconds) -> bool {
+    std::string_view text = memory::vmstat_file.read();
+    if (text.empty()) return memory::deltas.valid = false;
+
+    std::array<std::uint64_t, static_cast<std::size_t>(vmstat_counter::count)> counters { };
+    for (proc_scanner scanner(text); !scanner.done(); scanner.next_line()) {
+        std::string_view key = scanner.next_word();
+        for (vmstat_field const & field : vmstat_fields) {
+            if (field.prefix ? key.substr(0x0, field.key.size()) != field.key : key != field.key) continue;
+            if (field.counter != vmstat_counter::count) counters[static_cast<std::size_t>(field.counter)] += scanner.next_u64();
+            break;
+        }
+    }
+
+    if (memory::primed && seconds > 0.0) {
+        for (std::size_t i = 0x0; i < counters.size(); ++i) {
+            std::uint64_t delta = counters[i] >= memory::last_counters[i] ? counters[i] - memory::last_counters[i] : 0x0;
+            memory::deltas.per_second[i] = static_cast<double>(delta) / seconds;
+        }
+        memory::deltas.valid = true;
+    }
+    memory::last_counters = counters;
+    return true;
+}
+
+/**
+ * \brief Node meminfo lines read "Node 0 MemTotal:       16303140 kB"; numastat is "numa_hit 123" per line
+ */
+auto memory::read_nodes(double seconds) -> void {
+    for (std::size_t i = 0x0; i < memory::node_handles.size(); ++i) {
+        node_files & files = memory::node_handles[i];
+        memory_node & stats = memory::node_stats[i];
+
+        std::string_view text = files.meminfo.read();
+        stats.valid = !text.empty();
+        for (proc_scanner scanner(text); !scanner.done(); scanner.next_line()) {
+            scanner.next_word();
+            scanner.next_word();
+            std::string_view key = scanner.next_word();
+            std::uint64_t value = scanner.next_u64();
+
+            if (key == "MemTotal:") stats.total = value * 0x400;
+            else if (key == "MemFree:") stats.free = value * 0x400;
+            else if (key == "MemUsed:") stats.used = value * 0x400;
+            else if (key == "FilePages:") stats.file_pages = value * 0x400;
+            else if (key == "AnonPages:") stats.anon_pages = value * 0x400;
+            else if (key == "HugePages_Total:") stats.huge_total = value;
+            else if (key == "HugePages_Free:") stats.huge_free = value;
+        }
+
+        std::array<std::uint64_t, 0x3> counters { };
+        text = files.numastat.read();
+        for (proc_scanner scanner(text); !scanner.done(); scanner.next_line()) {
+            std::string_view key = scanner.next_word();
+            for (std::size_t k = 0x0; k < counters.size(); ++k) {
+                if (key == numastat_keys[k]) counters[k] = scanner.next_u64();
+            }
+        }
+
+        if (memory::primed && seconds > 0.0 && !text.empty()) {
+            auto rate = [&](std::size_t k) {
+                return counters[k] >= files.last[k] ? static_cast<double>(counters[k] - files.last[k]) / seconds : 0.0;
+            };
+            stats.numa_hit_rate = rate(0x0);
+            stats.numa_miss_rate = rate(0x1);
+            stats.other_node_rate = rate(0x2);
+        }
+        files.last = counters;
+    }
+}
+
+auto memory::read_pools() -> void {
+    for (std::size_t i = 0x0; i < memory::pool_handles.size(); ++i) {
+        pool_files & files = memory::pool_handles[i];
+        hugepage_pool & pool = memory::pools[i];
+
+        pool.total = proc_scanner(files.total.read()).next_u64();
+        pool.free = proc_scanner(files.free.read()).next_u64();
+        pool.reserved = proc_scanner(files.reserved.read()).next_u64();
+        pool.surplus = proc_scanner(files.surplus.read()).next_u64();
+    }
+}
+
+/**
+ * \brief Re-reads every file; rates cover the time since the previous refresh
+ * @return false when /proc/meminfo could not be read
+ */
+auto memory::refresh() -> bool {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - memory::last_stamp).count();
+
+    bool valid = memory::read_meminfo();
+    memory::read_vmstat(seconds);
+    memory::read_nodes(seconds);
+    memory::read_pools();
+
+    memory::last_stamp = now;
+    memory::primed = true;
+    return valid;
+}
+
+auto memory::info() -> memory_info const & {
+    return memory::current;
+}
+
+auto memory::rates() -> memory_rates const & {
+    return memory::deltas;
+}
+
+auto memory::nodes() -> std::vector<memory_node> const & {
+    return memory::node_stats;
+}
+
+auto memory::hugepages() -> std::vector<hugepage_pool> const & {
+    return memory::pools;
+}
+
+/**
+ * \brief Short name of a vmstat counter, as used in the report and the exporter labels
+ */
+auto memory::name(vmstat_counter counter) -> char const * {
+    switch (counter) {
+        case vmstat_counter::page_faults: return "page_faults";
+        case vmstat_counter::major_faults: return "major_faults";
+        case vmstat_counter::swap_in: return "swap_in";
+        case vmstat_counter::swap_out: return "swap_out";
+        case vmstat_counter::page_in: return "page_in";
+        case vmstat_counter::page_out: return "page_out";
+        case vmstat_counter::scan_kswapd: return "scan_kswapd";
+        case vmstat_counter::scan_direct: return "scan_direct";
+        case vmstat_counter::steal_kswapd: return "steal_kswapd";
+        case vmstat_counter::steal_direct: return "steal_direct";
+        case vmstat_counter::direct_stalls: return "direct_stalls";
+        case vmstat_counter::thp_fault_alloc: return "thp_fault_alloc";
+        case vmstat_counter::thp_collapse_alloc: return "thp_collapse_alloc";
+        case vmstat_counter::thp_split: return "thp_split";
+        case vmstat_counter::compact_stall: return "compact_stall";
+        case vmstat_counter::oom_kill: return "oom_kill";
+        case vmstat_counter::numa_hit: return "numa_hit";
+        case vmstat_counter::numa_miss: return "numa_miss";
+        default: return "unknown";
+    }
+}
+
+/**
+ * \brief Samples twice, interval apart, and prints usage, the vmstat rates, every node and every hugepage pool
+ * @param interval Time between the two samples
+ * @return process exit code
+ */
+auto memory::print(std::chrono::milliseconds interval) -> int {
+    if (!memory::init()) {
+        std::fprintf(stderr, "%s is not readable\n", PROC_MEMINFO);
+        return 0x1;
+    }
+
+    std::this_thread::sleep_for(interval);
+    memory::refresh();
+
+    constexpr double mib = 1024.0 * 1024.0;
+    memory_info const & info = memory::info();
+    std::printf("Memory: %.0f MiB total, %.0f MiB used, %.0f MiB available, %.0f MiB free\n",
+                info.total / mib, info.used() / mib, info.available / mib, info.free / mib);
+    std::printf("Cache:  %.0f MiB page cache, %.0f MiB buffers, %.0f MiB shmem, %.0f MiB dirty, %.0f MiB writeback\n",
+                info.cached / mib, info.buffers / mib, info.shmem / mib, info.dirty / mib, info.writeback / mib);
+    std::printf("Anon:   %.0f MiB active, %.0f MiB inactive, %.0f MiB transparent huge\n",
+                info.active_anon / mib, info.inactive_anon / mib, info.anon_huge / mib);
+    std::printf("Slab:   %.0f MiB reclaimable, %.0f MiB unreclaimable, %.0f MiB page tables\n",
+                info.slab_reclaimable / mib, info.slab_unreclaimable / mib, info.page_tables / mib);
+    std::printf("Swap:   %.0f MiB of %.0f MiB used, %.0f MiB cached; commit %.0f of %.0f MiB\n",
+                (info.swap_total - std::min(info.swap_free, info.swap_total)) / mib, info.swap_total / mib,
+                info.swap_cached / mib, info.committed / mib, info.commit_limit / mib);
+
+    memory_rates const & rates = memory::rates();
+    if (rates.valid) {
+        std::printf("\nRates over %lld ms (per second)\n", static_cast<long long>(interval.count()));
+        for (std::size_t i = 0x0; i < rates.per_second.size(); ++i) {
+            std::printf("%20s %14.1f\n", memory::name(static_cast<vmstat_counter>(i)), rates.per_second[i]);
+        }
+    }
+
+    if (!memory::nodes().empty()) {
+        std::printf("\n%5s %12s %12s %12s %12s %10s %12s %12s\n",
+                    "Node", "Total MiB", "Used MiB", "File MiB", "Anon MiB", "Huge free", "Hit/s", "Miss/s");
+        for (memory_node const & node : memory::nodes()) {
+            if (!node.valid) {
+                std::printf("%5d %12s\n", node.node, "-");
+                continue;
+            }
+            std::printf("%5d %12.0f %12.0f %12.0f %12.0f %4llu/%-5llu %12.1f %12.1f\n", node.node, node.total / mib, node.used / mib,
+                        node.file_pages / mib, node.anon_pages / mib, static_cast<unsigned long long>(node.huge_free),
+                        static_cast<unsigned long long>(node.huge_total), node.numa_hit_rate, node.numa_miss_rate);
+        }
+    }
+
+    if (!memory::hugepages().empty()) {
+        std::printf("\n%10s %10s %10s %10s %10s\n", "Page kB", "Total", "Free", "Reserved", "Surplus");
+        for (hugepage_pool const & pool : memory::hugepages()) {
+            std::printf("%10llu %10llu %10llu %10llu %10llu\n", static_cast<unsigned long long>(pool.page_size / 0x400),
+                        static_cast<unsigned long long>(pool.total), static_cast<unsigned long long>(pool.free),
+                        static_cast<unsigned long long>(pool.reserved), static_cast<unsigned long long>(pool.surplus));
+        }
+    }
+    return 0x0;
+}
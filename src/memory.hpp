@@ -0,0 +1,159 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_MEMORY_HPP
+#define CUBE_MEMORY_HPP
+
+#include <mutex>
+#include <array>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#include "procfs.hpp"
+
+#define PROC_MEMINFO "/proc/meminfo"
+#define PROC_VMSTAT "/proc/vmstat"
+#define NODE_SYSFS "/sys/devices/system/node"
+#define HUGEPAGES_SYSFS "/sys/kernel/mm/hugepages"
+
+/**
+ * \brief /proc/meminfo in bytes (the hugepage counts are pages of huge_page_size)
+ */
+struct memory_info {
+    std::uint64_t total { 0x0 };
+    std::uint64_t free { 0x0 };
+    std::uint64_t available { 0x0 };
+    std::uint64_t buffers { 0x0 };
+    std::uint64_t cached { 0x0 };
+    std::uint64_t swap_cached { 0x0 };
+    std::uint64_t active_anon { 0x0 };
+    std::uint64_t inactive_anon { 0x0 };
+    std::uint64_t active_file { 0x0 };
+    std::uint64_t inactive_file { 0x0 };
+    std::uint64_t dirty { 0x0 };
+    std::uint64_t writeback { 0x0 };
+    std::uint64_t anon_pages { 0x0 };
+    std::uint64_t mapped { 0x0 };
+    std::uint64_t shmem { 0x0 };
+    std::uint64_t slab_reclaimable { 0x0 };
+    std::uint64_t slab_unreclaimable { 0x0 };
+    std::uint64_t page_tables { 0x0 };
+    std::uint64_t swap_total { 0x0 };
+    std::uint64_t swap_free { 0x0 };
+    std::uint64_t committed { 0x0 };
+    std::uint64_t commit_limit { 0x0 };
+    std::uint64_t anon_huge { 0x0 };
+    std::uint64_t huge_total { 0x0 };
+    std::uint64_t huge_free { 0x0 };
+    std::uint64_t huge_reserved { 0x0 };
+    std::uint64_t huge_surplus { 0x0 };
+    std::uint64_t huge_page_size { 0x0 };
+    bool valid { false };
+
+    [[nodiscard]] auto used() const -> std::uint64_t { return total > available ? total - available : 0x0; }
+};
+
+enum class vmstat_counter : std::uint8_t {
+    page_faults, major_faults, swap_in, swap_out, page_in, page_out,
+    scan_kswapd, scan_direct, steal_kswapd, steal_direct, direct_stalls,
+    thp_fault_alloc, thp_collapse_alloc, thp_split, compact_stall, oom_kill,
+    numa_hit, numa_miss, count
+};
+
+/**
+ * \brief Events per second over the last refresh interval, indexed by vmstat_counter
+ *      Reclaim: scan/steal split by kswapd (background) and direct (the allocating task stalls)
+ */
+struct memory_rates {
+    std::array<double, static_cast<std::size_t>(vmstat_counter::count)> per_second { };
+    bool valid { false };
+
+    [[nodiscard]] auto operator[](vmstat_counter counter) const -> double { return per_second[static_cast<std::size_t>(counter)]; }
+};
+
+/**
+ * \brief One NUMA node: meminfo of /sys/devices/system/node/nodeN in bytes, its hugepages and numastat rates
+ */
+struct memory_node {
+    int node { -0x1 };
+    std::uint64_t total { 0x0 };
+    std::uint64_t free { 0x0 };
+    std::uint64_t used { 0x0 };
+    std::uint64_t file_pages { 0x0 };
+    std::uint64_t anon_pages { 0x0 };
+    std::uint64_t huge_total { 0x0 };
+    std::uint64_t huge_free { 0x0 };
+    double numa_hit_rate { 0.0 };
+    double numa_miss_rate { 0.0 };
+    double other_node_rate { 0.0 };
+    bool valid { false };
+};
+
+/**
+ * \brief One hugepage size of /sys/kernel/mm/hugepages, counts in pages
+ */
+struct hugepage_pool {
+    std::uint64_t page_size { 0x0 };
+    std::uint64_t total { 0x0 };
+    std::uint64_t free { 0x0 };
+    std::uint64_t reserved { 0x0 };
+    std::uint64_t surplus { 0x0 };
+};
+
+/**
+ * \brief Memory subsystem collector
+ *      Every file is opened once by init(); refresh() re-reads them and parses straight into the
+ *      fixed structs above, so a refresh allocates nothing. vmstat and numastat are cumulative counters,
+ *      their rates cover the time between two refreshes
+ */
+class memory {
+public:
+    static auto init() -> bool;
+    static auto refresh() -> bool;
+    static auto info() -> memory_info const &;
+    static auto rates() -> memory_rates const &;
+    static auto nodes() -> std::vector<memory_node> const &;
+    static auto hugepages() -> std::vector<hugepage_pool> const &;
+    static auto name(vmstat_counter counter) -> char const *;
+    static auto print(std::chrono::milliseconds interval) -> int;
+
+private:
+    struct node_files {
+        proc_file meminfo;
+        proc_file numastat;
+        std::array<std::uint64_t, 0x3> last { };
+    };
+
+    struct pool_files {
+        proc_file total;
+        proc_file free;
+        proc_file reserved;
+        proc_file surplus;
+    };
+
+    static inline std::once_flag initialized;
+    static inline bool available { false };
+    static inline proc_file meminfo_file;
+    static inline proc_file vmstat_file;
+    static inline std::vector<node_files> node_handles;
+    static inline std::vector<pool_files> pool_handles;
+    static inline memory_info current;
+    static inline memory_rates deltas;
+    static inline std::vector<memory_node> node_stats;
+    static inline std::vector<hugepage_pool> pools;
+    static inline std::array<std::uint64_t, static_cast<std::size_t>(vmstat_counter::count)> last_counters { };
+    static inline std::chrono::steady_clock::time_point last_stamp;
+    static inline bool primed { false };
+
+    static auto discover() -> void;
+    static auto read_meminfo() -> bool;
+    static auto read_vmstat(double seconds) -> bool;
+    static auto read_nodes(double seconds) -> void;
+    static auto read_pools() -> void;
+};
+
+#endif //CUBE_MEMORY_HPP
@@ -0,0 +1,52 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "msr.hpp"
+
+/**
+ * \brief Opens /dev/cpu/N/msr read-only
+ * @param cpu Logical CPU number
+ */
+msr::msr(int cpu) : index(cpu) {
+    char path[0x40];
+    std::snprintf(path, sizeof(path), MSR_DEVICE, cpu);
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+}
+
+msr::msr(msr && other) noexcept : fd(std::exchange(other.fd, -0x1)), index(other.index) { }
+
+auto msr::operator=(msr && other) noexcept -> msr & {
+    if (this != &other) {
+        close();
+        fd = std::exchange(other.fd, -0x1);
+        index = other.index;
+    }
+    return *this;
+}
+
+msr::~msr() {
+    close();
+}
+
+auto msr::close() -> void {
+    if (fd >= 0x0) ::close(fd);
+    fd = -0x1;
+}
+
+/**
+ * \brief Reads one register
+ * @param address MSR address
+ * @return value, std::nullopt when the device is closed or the CPU does not implement the register
+ */
+auto msr::read(std::uint32_t address) const -> std::optional<std::uint64_t> {
+    std::uint64_t value;
+    if (fd < 0x0 || pread(fd, &value, sizeof(value), address) != static_cast<ssize_t>(sizeof(value))) return std::nullopt;
+    return value;
+}
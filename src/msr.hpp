@@ -0,0 +1,45 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_MSR_HPP
+#define CUBE_MSR_HPP
+
+#include <cstdint>
+#include <optional>
+
+#define MSR_DEVICE "/dev/cpu/%d/msr"
+
+/**
+ * \brief Model specific register file of one logical CPU (the msr kernel module, needs CAP_SYS_RAWIO)
+ *      Every read is one pread() at the register address; the descriptor stays open
+ */
+class msr {
+public:
+    static constexpr std::uint32_t ia32_time_stamp_counter = 0x10;
+    static constexpr std::uint32_t ia32_mperf = 0xE7;
+    static constexpr std::uint32_t ia32_aperf = 0xE8;
+    static constexpr std::uint32_t amd_mperf_read_only = 0xC00000E7;
+    static constexpr std::uint32_t amd_aperf_read_only = 0xC00000E8;
+
+    msr() = default;
+    explicit msr(int cpu);
+    msr(msr && other) noexcept;
+    auto operator=(msr && other) noexcept -> msr &;
+    msr(msr const &) = delete;
+    auto operator=(msr const &) -> msr & = delete;
+    ~msr();
+
+    [[nodiscard]] auto is_open() const -> bool { return fd >= 0x0; }
+    [[nodiscard]] auto cpu() const -> int { return index; }
+    [[nodiscard]] auto read(std::uint32_t address) const -> std::optional<std::uint64_t>;
+    auto close() -> void;
+
+private:
+    int fd { -0x1 };
+    int index { -0x1 };
+};
+
+#endif //CUBE_MSR_HPP
@@ -0,0 +1,214 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <barrier>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "cpu.hpp"
+#include "numa.hpp"
+#include "bench.hpp"
+#include "memory.hpp"
+#include "procfs.hpp"
+#include "membench.hpp"
+#include "tsc_clock.hpp"
+
+/**
+ * \brief Reads the node lists has_cpu and has_memory and the CPUs of every node
+ *      Without NUMA sysfs (CONFIG_NUMA off) the result is a single node 0 with every online CPU
+ * @return layout, never empty
+ */
+auto numa::discover() -> numa_layout {
+    numa_layout layout;
+    std::vector<int> with_cpus = proc_scanner(proc_file(NODE_SYSFS "/has_cpu", 0x100).read()).next_cpu_list();
+    layout.memory_nodes = proc_scanner(proc_file(NODE_SYSFS "/has_memory", 0x100).read()).next_cpu_list();
+
+    for (int node : with_cpus) {
+        std::string path = std::string(NODE_SYSFS "/node") + std::to_string(node) + "/cpulist";
+        std::vector<int> cpus = proc_scanner(proc_file(path.c_str(), 0x400).read()).next_cpu_list();
+        if (cpus.empty()) continue;
+        layout.cpu_nodes.push_back(node);
+        layout.cpus.push_back(std::move(cpus));
+    }
+
+    layout.policy = !layout.cpu_nodes.empty() && !layout.memory_nodes.empty();
+    if (!layout.policy) {
+        layout.cpu_nodes = { 0x0 };
+        layout.cpus = { cpu::online_cpus() };
+        layout.memory_nodes = { 0x0 };
+    }
+    return layout;
+}
+
+/**
+ * \brief Sets the memory policy of a mapping that has not been touched yet
+ * @param address Page aligned start of the mapping
+ * @param bytes Length of the mapping
+ * @param mode MPOL_BIND or MPOL_INTERLEAVE
+ * @param nodes Nodes of the policy
+ * @return false when the kernel refused the policy
+ */
+auto numa::bind(void * address, std::size_t bytes, int mode, std::vector<int> const & nodes) -> bool {
+    constexpr std::size_t bits = sizeof(unsigned long) * 0x8;
+    int highest = nodes.empty() ? 0x0 : *std::max_element(nodes.begin(), nodes.end());
+    std::vector<unsigned long> mask(static_cast<std::size_t>(highest) / bits + 0x1, 0x0);
+    for (int node : nodes) mask[static_cast<std::size_t>(node) / bits] |= 0x1UL << (static_cast<std::size_t>(node) % bits);
+
+    /* maxnode counts bits plus one, the kernel drops the last one */
+    return syscall(SYS_mbind, address, bytes, mode, mask.data(), mask.size() * bits + 0x1, MPOL_MF_STRICT | MPOL_MF_MOVE) == 0x0;
+}
+
+/**
+ * \brief Asks the kernel where 64 pages spread over the buffer live (get_mempolicy with MPOL_F_NODE | MPOL_F_ADDR)
+ * @param address Touched buffer
+ * @param bytes Length of the buffer
+ * @param node Expected node
+ * @return share of the sampled pages on node, negative when the kernel does not answer
+ */
+auto numa::placement(void const * address, std::size_t bytes, int node) -> double {
+    auto const page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t pages = bytes / page;
+    if (!pages) return -1.0;
+
+    std::size_t samples = std::min<std::size_t>(pages, 0x40), matched = 0x0;
+    for (std::size_t i = 0x0; i < samples; ++i) {
+        auto const * probe = static_cast<char const *>(address) + (i * pages / samples) * page;
+        int where = -0x1;
+        if (syscall(SYS_get_mempolicy, &where, nullptr, 0x0, probe, MPOL_F_NODE | MPOL_F_ADDR) != 0x0) return -1.0;
+        matched += where == node;
+    }
+    return static_cast<double>(matched) / static_cast<double>(samples);
+}
+
+/**
+ * \brief Latency from the first CPU of the source node, then read bandwidth with one thread per CPU
+ *      Every reader streams its own slice; the bandwidth is all bytes over the span from the first start to
+ *      the last finish, so one slow thread is not hidden by the others
+ * @param cpus CPUs of the source node, the calling thread is pinned to the first one
+ * @param buffer Placed buffer, at least 256 bytes per CPU
+ * @param bytes Size of the buffer
+ * @return measured cell
+ */
+auto numa::measure(std::vector<int> const & cpus, void * buffer, std::size_t bytes) -> numa_cell {
+    numa_cell cell;
+    if (cpus.empty() || !cpu::pin_thread(cpus.front())) return cell;
+
+    std::size_t lines = bytes / 0x40;
+    membench::prepare_chase(buffer, bytes);
+    membench::chase(buffer, std::min<std::size_t>(lines, 0x100000));
+    cell.latency_ns = membench::chase(buffer, std::clamp<std::size_t>(lines * 0x2, 0x100000, 0x800000));
+
+    std::size_t const readers = cpus.size();
+    std::size_t const slice = (bytes / readers) & ~static_cast<std::size_t>(0xFF);
+    std::size_t const passes = std::max<std::size_t>(0x40000000 / bytes, 0x2);
+    if (!slice) return cell;
+
+    std::vector<std::uint64_t> starts(readers), ends(readers);
+    std::barrier ready(static_cast<std::ptrdiff_t>(readers));
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 0x0; i < readers; ++i) {
+            threads.emplace_back([&, i] {
+                cpu::pin_thread(cpus[i]);
+                void const * start = static_cast<char const *>(buffer) + i * slice;
+                membench::kernels().read(start, slice);
+                ready.arrive_and_wait();
+
+                std::uint64_t sink = 0x0;
+                starts[i] = cube::tsc_clock::ticks_serialized();
+                for (std::size_t pass = 0x0; pass < passes; ++pass) sink += membench::kernels().read(start, slice);
+                ends[i] = cube::tsc_clock::ticks_serialized();
+                cube::do_not_optimize(sink);
+            });
+        }
+    }
+
+    std::uint64_t span = *std::max_element(ends.begin(), ends.end()) - *std::min_element(starts.begin(), starts.end());
+    cell.read_gbs = static_cast<double>(slice * readers * passes) / static_cast<double>(cube::tsc_clock::to_duration(span).count());
+    cell.valid = true;
+    return cell;
+}
+
+/**
+ * \brief Measures every (CPU node, memory node) pair plus the interleaved column, one fresh buffer per cell
+ * @param bytes Buffer size, rounded down to a multiple of 2 MiB
+ * @return matrix; cells whose buffer could not be mapped or bound are left invalid
+ */
+auto numa::run(std::size_t bytes) -> numa_matrix {
+    numa_matrix matrix;
+    matrix.layout = numa::discover();
+    numa_layout const & layout = matrix.layout;
+
+    bytes = std::max<std::size_t>(bytes & ~static_cast<std::size_t>(0x1FFFFF), 0x200000);
+    bool const interleave = layout.memory_nodes.size() > 0x1;
+    matrix.columns = layout.memory_nodes.size() + interleave;
+    matrix.cells.resize(layout.cpu_nodes.size() * matrix.columns);
+
+    cpu_set_t original;
+    sched_getaffinity(0x0, sizeof(original), &original);
+
+    for (std::size_t row = 0x0; row < layout.cpu_nodes.size(); ++row) {
+        for (std::size_t column = 0x0; column < matrix.columns; ++column) {
+            membench::buffer memory = membench::allocate(bytes);
+            if (!memory) continue;
+
+            bool interleaved = column == layout.memory_nodes.size();
+            bool placed = !layout.policy
+                          || (interleaved ? numa::bind(memory.get(), bytes, MPOL_INTERLEAVE, layout.memory_nodes)
+                                          : numa::bind(memory.get(), bytes, MPOL_BIND, { layout.memory_nodes[column] }));
+            if (!placed) continue;
+
+            numa_cell cell = numa::measure(layout.cpus[row], memory.get(), bytes);
+            if (layout.policy && !interleaved) cell.placed = numa::placement(memory.get(), bytes, layout.memory_nodes[column]);
+            matrix.cells[row * matrix.columns + column] = cell;
+        }
+    }
+
+    sched_setaffinity(0x0, sizeof(original), &original);
+    return matrix;
+}
+
+/**
+ * \brief Prints the latency and the bandwidth matrix, rows are CPU nodes and columns memory nodes
+ *      A cell whose sampled pages did not all land on the target node is marked with '*'
+ * @param matrix Output of run()
+ * @param bytes Buffer size used for the run
+ */
+auto numa::print(numa_matrix const & matrix, std::size_t bytes) -> void {
+    numa_layout const & layout = matrix.layout;
+    bool misplaced = false;
+
+    std::printf("NUMA matrix, %zu MiB per cell, %s kernels, %s\n", bytes >> 0x14, membench::kernels().name,
+                layout.policy ? "buffers placed with mbind()" : "no NUMA support, single node without a policy");
+
+    for (int table = 0x0; table < 0x2; ++table) {
+        std::printf("\n%s\n%10s", table == 0x0 ? "Latency ns (one thread)" : "Read GB/s (one thread per CPU of the node)", "CPU \\ mem");
+        for (int node : layout.memory_nodes) std::printf("%10d", node);
+        if (matrix.columns > layout.memory_nodes.size()) std::printf("%10s", "inter");
+        std::printf("\n");
+
+        for (std::size_t row = 0x0; row < layout.cpu_nodes.size(); ++row) {
+            std::printf("%4d (%3zu)", layout.cpu_nodes[row], layout.cpus[row].size());
+            for (std::size_t column = 0x0; column < matrix.columns; ++column) {
+                numa_cell const & cell = matrix.at(row, column);
+                if (!cell.valid) {
+                    std::printf("%10s", "-");
+                    continue;
+                }
+                bool partial = cell.placed >= 0.0 && cell.placed < 1.0;
+                misplaced |= partial;
+                std::printf("%9.*f%c", table == 0x0 ? 0x1 : 0x2, table == 0x0 ? cell.latency_ns : cell.read_gbs, partial ? '*' : ' ');
+            }
+            std::printf("\n");
+        }
+    }
+    if (misplaced) std::printf("\n* some sampled pages are not on the target node (node full or policy not honoured)\n");
+}
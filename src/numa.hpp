@@ -0,0 +1,65 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_NUMA_HPP
+#define CUBE_NUMA_HPP
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * \brief NUMA nodes that have CPUs and nodes that have memory, from /sys/devices/system/node
+ *      Memory-only nodes (CXL, HBM) are valid targets without being sources. policy is false when the
+ *      kernel has no NUMA support, then everything runs as one node and no buffer is bound
+ */
+struct numa_layout {
+    std::vector<int> cpu_nodes;
+    std::vector<std::vector<int>> cpus;
+    std::vector<int> memory_nodes;
+    bool policy { false };
+};
+
+/**
+ * \brief One (CPU node, memory node) measurement
+ *      read_gbs is the aggregate of one reader thread per CPU of the source node; placed is the share of
+ *      sampled pages that actually sit on the target node, negative when it could not be checked
+ */
+struct numa_cell {
+    double latency_ns { 0.0 };
+    double read_gbs { 0.0 };
+    double placed { -1.0 };
+    bool valid { false };
+};
+
+/**
+ * \brief Rows are layout.cpu_nodes, columns are layout.memory_nodes followed by an interleaved column
+ *      when there is more than one memory node
+ */
+struct numa_matrix {
+    numa_layout layout;
+    std::size_t columns { 0x0 };
+    std::vector<numa_cell> cells;
+
+    [[nodiscard]] auto at(std::size_t row, std::size_t column) const -> numa_cell const & { return cells[row * columns + column]; }
+};
+
+/**
+ * \brief NUMA latency and bandwidth matrix
+ *      Each buffer is placed with a raw mbind() (MPOL_BIND to one node, MPOL_INTERLEAVE over all of them)
+ *      before it is first touched, so there is no libnuma dependency; the membench pointer chase and read
+ *      kernel then run from threads pinned on the source node
+ */
+class numa {
+public:
+    static auto discover() -> numa_layout;
+    static auto bind(void * address, std::size_t bytes, int mode, std::vector<int> const & nodes) -> bool;
+    static auto placement(void const * address, std::size_t bytes, int node) -> double;
+    static auto measure(std::vector<int> const & cpus, void * buffer, std::size_t bytes) -> numa_cell;
+    static auto run(std::size_t bytes) -> numa_matrix;
+    static auto print(numa_matrix const & matrix, std::size_t bytes) -> void;
+};
+
+#endif //CUBE_NUMA_HPP
@@ -0,0 +1,264 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <thread>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "cpu.hpp"
+#include "perf.hpp"
+#include "procfs.hpp"
+#include "sampler.hpp"
+
+auto perf_sample::ipc() const -> double {
+    double cycles = value(perf_counter::cycles);
+    return valid && has(perf_counter::instructions) && cycles > 0.0 ? value(perf_counter::instructions) / cycles : 0.0;
+}
+
+/**
+ * \brief Events of one kind per thousand retired instructions
+ * @param counter Miss counter (LLC or branch misses)
+ * @return misses per kilo-instruction, 0 when either counter is missing
+ */
+auto perf_sample::mpki(perf_counter counter) const -> double {
+    double instructions = value(perf_counter::instructions);
+    return valid && has(counter) && instructions > 0.0 ? value(counter) * 1e3 / instructions : 0.0;
+}
+
+/**
+ * \brief Opens one hardware event on one CPU, all threads; the leader starts disabled so the group is enabled at once
+ *      Stalled cycles try the backend event first, then the frontend one
+ * @param counter Event to open
+ * @param cpu Logical CPU number
+ * @param leader Group leader descriptor, -1 to open a leader
+ * @return file descriptor, -1 with errno set on failure
+ */
+auto perf::open_event(perf_counter counter, int cpu, int leader) -> int {
+    std::uint64_t configs[0x2] { PERF_COUNT_HW_MAX, PERF_COUNT_HW_MAX };
+    switch (counter) {
+        case perf_counter::cycles: configs[0x0] = PERF_COUNT_HW_CPU_CYCLES; break;
+        case perf_counter::instructions: configs[0x0] = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case perf_counter::llc_misses: configs[0x0] = PERF_COUNT_HW_CACHE_MISSES; break;
+        case perf_counter::branch_misses: configs[0x0] = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case perf_counter::stalled_cycles:
+            configs[0x0] = PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
+            configs[0x1] = PERF_COUNT_HW_STALLED_CYCLES_FRONTEND;
+            break;
+        default: break;
+    }
+
+    int fd = -0x1;
+    for (std::uint64_t config : configs) {
+        if (config == PERF_COUNT_HW_MAX) break;
+
+        perf_event_attr attr { };
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = leader < 0x0;
+        attr.exclude_hv = 0x1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, -0x1, cpu, leader, PERF_FLAG_FD_CLOEXEC));
+        if (fd >= 0x0) break;
+    }
+    return fd;
+}
+
+/**
+ * \brief Opens the cycles leader and every member the PMU accepts on one CPU, then enables the group
+ * @param cpu Logical CPU number
+ * @param out Group to fill
+ * @return 0, or the errno of the failed leader
+ */
+auto perf::open_group(int cpu, group & out) -> int {
+    out.cpu = cpu;
+    out.slot.fill(-0x1);
+
+    int leader = perf::open_event(perf_counter::cycles, cpu, -0x1);
+    if (leader < 0x0) return errno;
+    out.fds.push_back(leader);
+    out.slot[static_cast<std::size_t>(perf_counter::cycles)] = 0x0;
+
+    for (std::size_t i = 0x1; i < static_cast<std::size_t>(perf_counter::count); ++i) {
+        int fd = perf::open_event(static_cast<perf_counter>(i), cpu, leader);
+        if (fd < 0x0) continue;
+        out.slot[i] = static_cast<int>(out.fds.size());
+        out.fds.push_back(fd);
+    }
+
+    out.previous.assign(out.fds.size() + 0x3, 0x0);
+    out.current.assign(out.fds.size() + 0x3, 0x0);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0x0;
+}
+
+/**
+ * \brief Opens a group on every online CPU; CPUs that refuse are skipped unless all of them do
+ */
+auto perf::discover() -> void {
+    int error = 0x0;
+    for (int id : cpu::online_cpus()) {
+        group entry;
+        int result = perf::open_group(id, entry);
+        if (result == 0x0) {
+            perf::groups.emplace_back(std::move(entry));
+        } else if (!error) {
+            error = result;
+        }
+    }
+
+    perf::available = !perf::groups.empty();
+    if (perf::available) {
+        perf::reason = "ok";
+    } else if (error == EACCES || error == EPERM) {
+        proc_file paranoid(PERF_EVENT_PARANOID, 0x20);
+        long long level = proc_scanner(paranoid.read()).next_i64();
+        perf::reason = "perf_event_paranoid is " + std::to_string(level) + ", system-wide counters need <= 0 or CAP_PERFMON";
+    } else if (error == ENOENT || error == ENODEV || error == EOPNOTSUPP) {
+        perf::reason = "no hardware PMU (virtual machine without a vPMU?)";
+    } else if (error == ENOSYS) {
+        perf::reason = "kernel built without perf events";
+    } else {
+        perf::reason = error ? std::strerror(error) : "no online CPU";
+    }
+
+    perf::samples.resize(perf::groups.size());
+    for (std::size_t i = 0x0; i < perf::groups.size(); ++i) perf::samples[i].cpu = perf::groups[i].cpu;
+}
+
+/**
+ * \brief Opens the counter groups, only the first call does work
+ * @return false when no group could be opened, status() holds the reason
+ */
+auto perf::init() -> bool {
+    std::call_once(perf::initialized, perf::discover);
+    return perf::available;
+}
+
+/**
+ * \brief Reads a whole group with one read() of the leader: { nr, time_enabled, time_running, value[nr] }
+ *      and turns it into deltas against the previous read, scaled when the group was multiplexed
+ * @param entry Group to read
+ * @param result Sample to fill
+ * @return true when the deltas are valid (the first read only primes)
+ */
+auto perf::read_group(group & entry, perf_sample & result) -> bool {
+    std::size_t bytes = entry.current.size() * sizeof(std::uint64_t);
+    if (::read(entry.fds.front(), entry.current.data(), bytes) != static_cast<ssize_t>(bytes)) {
+        result.valid = entry.primed = false;
+        return false;
+    }
+
+    std::uint64_t enabled = entry.current[0x1] - entry.previous[0x1];
+    std::uint64_t running = entry.current[0x2] - entry.previous[0x2];
+    result.valid = entry.primed && running > 0x0;
+
+    if (result.valid) {
+        double scale = static_cast<double>(enabled) / static_cast<double>(running);
+        for (std::size_t i = 0x0; i < entry.slot.size(); ++i) {
+            result.present[i] = entry.slot[i] >= 0x0;
+            if (!result.present[i]) continue;
+
+            std::size_t at = static_cast<std::size_t>(entry.slot[i]) + 0x3;
+            result.values[i] = static_cast<double>(entry.current[at] - entry.previous[at]) * scale;
+        }
+    }
+
+    entry.previous.swap(entry.current);
+    entry.primed = true;
+    return result.valid;
+}
+
+/**
+ * \brief One batched pass over all groups, then the system-wide sum
+ *      An event counts as present system-wide only when every CPU with a valid sample has it
+ * @return number of CPUs with a valid sample
+ */
+auto perf::refresh() -> std::size_t {
+    if (!perf::init()) return 0x0;
+
+    std::size_t valid = 0x0;
+    for (std::size_t i = 0x0; i < perf::groups.size(); ++i) valid += perf::read_group(perf::groups[i], perf::samples[i]);
+
+    perf::aggregate = perf_sample { };
+    perf::aggregate.valid = valid > 0x0;
+    perf::aggregate.present.fill(perf::aggregate.valid);
+    for (perf_sample const & sample : perf::samples) {
+        if (!sample.valid) continue;
+        for (std::size_t i = 0x0; i < sample.values.size(); ++i) {
+            perf::aggregate.values[i] += sample.values[i];
+            perf::aggregate.present[i] = perf::aggregate.present[i] && sample.present[i];
+        }
+    }
+    return valid;
+}
+
+auto perf::cores() -> std::vector<perf_sample> const & {
+    return perf::samples;
+}
+
+auto perf::total() -> perf_sample const & {
+    return perf::aggregate;
+}
+
+auto perf::status() -> std::string const & {
+    perf::init();
+    return perf::reason;
+}
+
+auto perf::name(perf_counter counter) -> char const * {
+    switch (counter) {
+        case perf_counter::cycles: return "cycles";
+        case perf_counter::instructions: return "instructions";
+        case perf_counter::llc_misses: return "LLC misses";
+        case perf_counter::branch_misses: return "branch misses";
+        case perf_counter::stalled_cycles: return "stalled cycles";
+        default: return "unknown";
+    }
+}
+
+/**
+ * \brief Counts every CPU over one interval and prints IPC and MPKI next to its utilization
+ * @param interval Measurement interval
+ * @return exit status, 1 when the counters cannot be opened
+ */
+auto perf::print(std::chrono::milliseconds interval) -> int {
+    if (!perf::init()) {
+        std::fprintf(stderr, "hardware counters unavailable: %s\n", perf::status().c_str());
+        return 0x1;
+    }
+
+    sampler::start(interval);
+    perf::refresh();
+    std::this_thread::sleep_for(interval + interval / 0x4);
+    perf::refresh();
+
+    auto row = [](char const * label, perf_sample const & sample, double usage) {
+        if (!sample.valid) {
+            std::printf("%6s %7s %9s %9s %9s %9s\n", label, "-", "-", "-", "-", "-");
+            return;
+        }
+        double stalled = sample.has(perf_counter::stalled_cycles) && sample.value(perf_counter::cycles) > 0.0
+                         ? 100.0 * sample.value(perf_counter::stalled_cycles) / sample.value(perf_counter::cycles) : -1.0;
+        std::printf("%6s %7.1f %9.2f %9.2f %9.2f ", label, usage, sample.ipc(),
+                    sample.mpki(perf_counter::llc_misses), sample.mpki(perf_counter::branch_misses));
+        if (stalled < 0.0) std::printf("%9s\n", "-");
+        else std::printf("%9.1f\n", stalled);
+    };
+
+    std::printf("Interval %lld ms, %zu CPUs\n", static_cast<long long>(interval.count()), perf::cores().size());
+    std::printf("%6s %7s %9s %9s %9s %9s\n", "CPU", "Util %", "IPC", "LLC MPKI", "Br MPKI", "Stall %");
+    for (perf_sample const & sample : perf::cores()) {
+        row(std::to_string(sample.cpu).c_str(), sample, static_cast<double>(sampler::core(static_cast<std::size_t>(sample.cpu))));
+    }
+    row("all", perf::total(), static_cast<double>(sampler::aggregate()));
+    return 0x0;
+}
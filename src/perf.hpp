@@ -0,0 +1,78 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_PERF_HPP
+#define CUBE_PERF_HPP
+
+#include <mutex>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define PERF_EVENT_PARANOID "/proc/sys/kernel/perf_event_paranoid"
+
+enum class perf_counter : std::uint8_t { cycles, instructions, llc_misses, branch_misses, stalled_cycles, count };
+
+/**
+ * \brief Counter deltas of one CPU (or the whole system) over the last refresh interval
+ *      Values are scaled up by time_enabled / time_running when the kernel had to multiplex the group;
+ *      present[] is false for events the PMU does not offer (stalled cycles on most Intel parts, any event in a VM)
+ */
+struct perf_sample {
+    int cpu { -0x1 };
+    std::array<double, static_cast<std::size_t>(perf_counter::count)> values { };
+    std::array<bool, static_cast<std::size_t>(perf_counter::count)> present { };
+    bool valid { false };
+
+    [[nodiscard]] auto value(perf_counter counter) const -> double { return values[static_cast<std::size_t>(counter)]; }
+    [[nodiscard]] auto has(perf_counter counter) const -> bool { return present[static_cast<std::size_t>(counter)]; }
+    [[nodiscard]] auto ipc() const -> double;
+    [[nodiscard]] auto mpki(perf_counter counter) const -> double;
+};
+
+/**
+ * \brief Per-CPU hardware counter groups opened with perf_event_open
+ *      Cycles lead one group per online CPU with instructions, LLC misses, branch misses and backend
+ *      stalled cycles as members; a single read() of the leader returns the whole group (PERF_FORMAT_GROUP).
+ *      System-wide counting needs perf_event_paranoid <= 0 or CAP_PERFMON; when that, or a PMU, is
+ *      missing, init() fails and status() says why instead of the caller having to guess
+ */
+class perf {
+public:
+    static auto init() -> bool;
+    static auto refresh() -> std::size_t;
+    static auto cores() -> std::vector<perf_sample> const &;
+    static auto total() -> perf_sample const &;
+    static auto status() -> std::string const &;
+    static auto name(perf_counter counter) -> char const *;
+    static auto print(std::chrono::milliseconds interval) -> int;
+
+private:
+    struct group {
+        int cpu { -0x1 };
+        std::vector<int> fds;
+        std::array<int, static_cast<std::size_t>(perf_counter::count)> slot { };
+        std::vector<std::uint64_t> previous;
+        std::vector<std::uint64_t> current;
+        bool primed { false };
+    };
+
+    static inline std::once_flag initialized;
+    static inline bool available { false };
+    static inline std::string reason;
+    static inline std::vector<group> groups;
+    static inline std::vector<perf_sample> samples;
+    static inline perf_sample aggregate;
+
+    static auto open_event(perf_counter counter, int cpu, int leader) -> int;
+    static auto open_group(int cpu, group & out) -> int;
+    static auto read_group(group & entry, perf_sample & result) -> bool;
+    static auto discover() -> void;
+};
+
+#endif //CUBE_PERF_HPP
@@ -0,0 +1,318 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits>
+#include <algorithm>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#include "process.hpp"
+
+/**
+ * \brief Opens /proc once and sizes the descriptor budget for the per-pid schedstat files
+ *      Half of the soft RLIMIT_NOFILE in effect at construction may hold schedstat descriptors; processes
+ *      beyond the budget are read with a transient openat instead. The limit itself is left alone, callers
+ *      that own the process raise it first with raise_descriptor_limit()
+ */
+process_table::process_table()
+        : proc_fd(::open(PROC_ROOT, O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+          listing(0x8000),
+          scratch(0x400) {
+    rlimit files { };
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0x0) {
+        descriptor_budget = files.rlim_cur == RLIM_INFINITY ? 0x100000 : static_cast<std::size_t>(files.rlim_cur / 0x2);
+    }
+}
+
+/**
+ * \brief Raises the soft RLIMIT_NOFILE of the whole process to the hard limit
+ *      Every kept schedstat descriptor saves an openat and a close per pass, so a host with more processes
+ *      than half the default soft limit (often 1024) is refreshed noticeably cheaper after this call
+ * @return soft limit now in effect, 0x0 when it cannot be read
+ */
+auto process_table::raise_descriptor_limit() -> std::size_t {
+    rlimit files { };
+    if (getrlimit(RLIMIT_NOFILE, &files) != 0x0) return 0x0;
+    if (files.rlim_cur < files.rlim_max) {
+        rlimit raised { files.rlim_max, files.rlim_max };
+        if (setrlimit(RLIMIT_NOFILE, &raised) == 0x0) files = raised;
+    }
+    return files.rlim_cur == RLIM_INFINITY ? std::numeric_limits<std::size_t>::max() : static_cast<std::size_t>(files.rlim_cur);
+}
+
+process_table::~process_table() {
+    if (proc_fd >= 0x0) ::close(proc_fd);
+}
+
+/**
+ * \brief Reads a file below /proc into the shared scratch buffer with a transient descriptor
+ * @param path Path relative to /proc, such as "123/stat"
+ * @param error Receives the errno of a failed open when not null
+ * @return view into the scratch buffer, valid until the next call; empty when the process is gone
+ */
+auto process_table::read_at(char const * path, int * error) -> std::string_view {
+    int fd = ::openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0x0) {
+        if (error) *error = errno;
+        return { };
+    }
+
+    std::size_t size = 0x0;
+    while (true) {
+        ssize_t n = ::pread(fd, scratch.data() + size, scratch.size() - size, static_cast<off_t>(size));
+        if (n <= 0x0) break;
+        size += static_cast<std::size_t>(n);
+        if (size == scratch.size()) scratch.resize(scratch.size() * 0x2);
+    }
+    ::close(fd);
+    return { scratch.data(), size };
+}
+
+/**
+ * \brief Reads the first field of /proc/PID/schedstat, the nanoseconds the process has run
+ *      A kept descriptor of an exited process fails with ESRCH, so a reused pid is never confused with the old one
+ * @param pid Process id
+ * @param process Table entry
+ * @return runtime, std::nullopt when the process is gone or the kernel has no schedstat
+ */
+auto process_table::runtime(int pid, entry & process) -> std::optional<std::uint64_t> {
+    if (process.schedstat_missing) return std::nullopt;
+
+    char path[0x20];
+    std::snprintf(path, sizeof(path), "%d/schedstat", pid);
+
+    if (!process.schedstat.is_open() && descriptors < descriptor_budget) {
+        process.schedstat = proc_file(proc_fd, path, 0x40);
+        if (process.schedstat.is_open()) ++descriptors;
+    }
+
+    int error = 0x0;
+    std::string_view text = process.schedstat.is_open() ? process.schedstat.read() : read_at(path, &error);
+    if (text.empty()) {
+        process.schedstat_missing = process.seen == 0x0 && error == ENOENT;
+        return std::nullopt;
+    }
+    return proc_scanner(text).next_u64();
+}
+
+/**
+ * \brief Parses /proc/PID/stat: the name between the first "(" and the last ")", then the fields after it
+ *      CPU% is the utime + stime delta over the time since the previous parse; a changed start time means
+ *      the pid was reused and the baseline restarts
+ * @return false when the process is gone
+ */
+auto process_table::parse_stat(int pid, entry & process, std::chrono::steady_clock::time_point now) -> bool {
+    static double const ticks_per_second = static_cast<double>(sysconf(_SC_CLK_TCK));
+    static std::uint64_t const page_size = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+
+    char path[0x20];
+    std::snprintf(path, sizeof(path), "%d/stat", pid);
+    std::string_view text = read_at(path);
+
+    std::size_t open = text.find('(');
+    std::size_t close = text.rfind(')');
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open) return false;
+    ++reparsed;
+
+    std::string_view name = text.substr(open + 0x1, close - open - 0x1);
+    process.info.name.fill('\0');
+    std::memcpy(process.info.name.data(), name.data(), std::min(name.size(), process.info.name.size() - 0x1));
+
+    proc_scanner scanner(text.substr(close + 0x1));
+    std::string_view state = scanner.next_word();
+    process.info.state = state.empty() ? '?' : state.front();
+    process.info.ppid = static_cast<int>(scanner.next_i64());
+    for (int field = 0x5; field <= 0xD; ++field) scanner.next_word();
+
+    std::uint64_t ticks = scanner.next_u64() + scanner.next_u64();
+    for (int field = 0x10; field <= 0x13; ++field) scanner.next_word();
+    process.info.threads = static_cast<std::uint32_t>(scanner.next_u64());
+    scanner.next_word();
+    std::uint64_t start = scanner.next_u64();
+    process.info.virtual_bytes = scanner.next_u64();
+    process.info.rss_bytes = scanner.next_u64() * page_size;
+
+    double seconds = std::chrono::duration<double>(now - process.stamp).count();
+    bool baseline = process.seen != 0x0 && process.start == start && ticks >= process.ticks && seconds > 0.0;
+    process.info.cpu_percent = baseline ? 100.0 * static_cast<double>(ticks - process.ticks) / ticks_per_second / seconds : 0.0;
+
+    process.ticks = ticks;
+    process.start = start;
+    process.stamp = now;
+    return true;
+}
+
+/**
+ * \brief Parses /proc/PID/statm (pages): size resident shared text lib data dt
+ */
+auto process_table::parse_statm(int pid, entry & process) -> void {
+    static std::uint64_t const page_size = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+
+    char path[0x20];
+    std::snprintf(path, sizeof(path), "%d/statm", pid);
+    std::string_view text = read_at(path);
+    if (text.empty()) return;
+
+    proc_scanner scanner(text);
+    process.info.virtual_bytes = scanner.next_u64() * page_size;
+    process.info.rss_bytes = scanner.next_u64() * page_size;
+    process.info.shared_bytes = scanner.next_u64() * page_size;
+}
+
+/**
+ * \brief Brings one process up to date, probing schedstat every pass and parsing stat/statm only when it ran
+ *      /proc/PID/schedstat only counts the thread-group leader, so the shortcut is taken for processes that
+ *      had one thread when last parsed; the others are parsed every pass and keep no schedstat descriptor.
+ *      An idle process keeps its stamp moving, so the pass that sees it run again divides by one interval
+ * @return false when the process is gone
+ */
+auto process_table::update(int pid, entry & process, std::chrono::steady_clock::time_point now) -> bool {
+    bool fresh = process.seen == 0x0;
+    bool rotate = (generation + static_cast<std::uint64_t>(pid)) % memory_rotation == 0x0;
+    std::optional<std::uint64_t> ran;
+
+    if (fresh || process.info.threads == 0x1) {
+        ++checked;
+        ran = runtime(pid, process);
+        if (!ran && !process.schedstat_missing && !fresh) {
+            release(process);
+            process = entry { };
+            fresh = true;
+            ran = runtime(pid, process);
+        }
+
+        if (!fresh && ran && *ran == process.runtime) {
+            process.info.cpu_percent = 0.0;
+            process.stamp = now;
+            if (rotate) parse_statm(pid, process);
+            return true;
+        }
+    }
+
+    if (!parse_stat(pid, process, now)) return false;
+    parse_statm(pid, process);
+    process.info.pid = pid;
+    if (ran) process.runtime = *ran;
+    if (process.info.threads != 0x1) release(process);
+    return true;
+}
+
+auto process_table::release(entry & process) -> void {
+    if (process.schedstat.is_open()) --descriptors;
+    process.schedstat.close();
+}
+
+/**
+ * \brief One pass over /proc: lists the pids with getdents64 on the kept descriptor, updates every process
+ *      and drops the ones that disappeared
+ * @return number of processes in the table
+ */
+auto process_table::refresh() -> std::size_t {
+    if (proc_fd < 0x0) return 0x0;
+
+    ++generation;
+    reparsed = checked = 0x0;
+    auto now = std::chrono::steady_clock::now();
+    ::lseek(proc_fd, 0x0, SEEK_SET);
+
+    while (true) {
+        long bytes = syscall(SYS_getdents64, proc_fd, listing.data(), listing.size());
+        if (bytes <= 0x0) break;
+
+        for (long offset = 0x0; offset < bytes; ) {
+            auto const * record = reinterpret_cast<dirent64 const *>(listing.data() + offset);
+            offset += record->d_reclen;
+            if (record->d_name[0x0] < '1' || record->d_name[0x0] > '9') continue;
+
+            int pid = std::atoi(record->d_name);
+            entry & process = entries[pid];
+            if (!update(pid, process, now)) {
+                release(process);
+                entries.erase(pid);
+                continue;
+            }
+            process.seen = generation;
+        }
+    }
+
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        if (it->second.seen == generation) {
+            ++it;
+            continue;
+        }
+        release(it->second);
+        it = entries.erase(it);
+    }
+    return entries.size();
+}
+
+/**
+ * \brief The heaviest processes of the last refresh, through a min-heap that never holds more than count entries
+ * @param count Number of processes to return
+ * @param order Sort key
+ * @return processes in descending order of the key
+ */
+auto process_table::top(std::size_t count, process_order order) const -> std::vector<process_info> {
+    auto key = [order](process_info const & process) -> double {
+        return order == process_order::cpu ? process.cpu_percent : static_cast<double>(process.rss_bytes);
+    };
+    auto heavier = [&key](process_info const & a, process_info const & b) {
+        return key(a) != key(b) ? key(a) > key(b) : a.pid < b.pid;
+    };
+
+    std::vector<process_info> heap;
+    if (count == 0x0) return heap;
+    heap.reserve(count + 0x1);
+
+    for (auto const & [pid, process] : entries) {
+        if (heap.size() < count) {
+            heap.push_back(process.info);
+            std::push_heap(heap.begin(), heap.end(), heavier);
+        } else if (heavier(process.info, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), heavier);
+            heap.back() = process.info;
+            std::push_heap(heap.begin(), heap.end(), heavier);
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), heavier);
+    return heap;
+}
+
+/**
+ * \brief Samples every process over one interval and prints the heaviest by CPU, with the cost of the pass
+ * @param count Number of processes to print
+ * @param interval Measurement interval
+ * @return exit status, 1 when /proc cannot be opened
+ */
+auto process_table::print(std::size_t count, std::chrono::milliseconds interval) -> int {
+    process_table table;
+    if (table.refresh() == 0x0) {
+        std::fprintf(stderr, "cannot list processes in %s\n", PROC_ROOT);
+        return 0x1;
+    }
+    std::this_thread::sleep_for(interval);
+
+    auto begin = std::chrono::steady_clock::now();
+    std::size_t processes = table.refresh();
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    std::printf("Processes: %zu, probed %zu, parsed %zu, pass took %.2f ms\n", processes, table.probed(), table.parsed(), elapsed);
+    std::printf("%8s %8s %1s %5s %7s %10s %10s  %s\n", "PID", "PPID", "S", "THR", "CPU %", "RSS MiB", "VIRT MiB", "NAME");
+    for (process_info const & process : table.top(count, process_order::cpu)) {
+        std::printf("%8d %8d %c %5u %7.1f %10.1f %10.1f  %s\n", process.pid, process.ppid, process.state, process.threads,
+                    process.cpu_percent, static_cast<double>(process.rss_bytes) / 0x100000,
+                    static_cast<double>(process.virtual_bytes) / 0x100000, process.name.data());
+    }
+    return 0x0;
+}
@@ -0,0 +1,99 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_PROCESS_HPP
+#define CUBE_PROCESS_HPP
+
+#include <array>
+#include <chrono>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "procfs.hpp"
+
+#define PROC_ROOT "/proc"
+
+enum class process_order { cpu, memory };
+
+/**
+ * \brief One process as of the last refresh
+ *      cpu_percent is top's convention: 100 % is one core, averaged since the process was last parsed
+ */
+struct process_info {
+    int pid { 0x0 };
+    int ppid { 0x0 };
+    char state { '?' };
+    std::array<char, 0x10> name { };
+    std::uint32_t threads { 0x0 };
+    double cpu_percent { 0.0 };
+    std::uint64_t rss_bytes { 0x0 };
+    std::uint64_t shared_bytes { 0x0 };
+    std::uint64_t virtual_bytes { 0x0 };
+};
+
+/**
+ * \brief Incremental table of every process under /proc
+ *      The pid list comes from getdents64 on one /proc descriptor that stays open, every per-pid file
+ *      is opened relative to it and read into buffers owned by the table.
+ *      Every pass reads /proc/PID/schedstat of every process (three numbers, one pread on a descriptor kept
+ *      open while the descriptor budget lasts); only when the runtime moved are stat and statm re-parsed.
+ *      The memory figures of idle processes are re-read on a rotation, so an idle process costs one pread
+ *      per pass and a process that wakes up shows its CPU% on the very next pass. schedstat only counts
+ *      the thread-group leader, so multi-threaded processes and kernels without schedstat have stat parsed
+ *      every pass. top() keeps a bounded heap, sorting is O(P log N) instead of O(P log P)
+ */
+class process_table {
+public:
+    process_table();
+    process_table(process_table const &) = delete;
+    auto operator=(process_table const &) -> process_table & = delete;
+    ~process_table();
+
+    auto refresh() -> std::size_t;
+    [[nodiscard]] auto top(std::size_t count, process_order order) const -> std::vector<process_info>;
+    [[nodiscard]] auto size() const -> std::size_t { return entries.size(); }
+    [[nodiscard]] auto parsed() const -> std::size_t { return reparsed; }
+    [[nodiscard]] auto probed() const -> std::size_t { return checked; }
+
+    static auto raise_descriptor_limit() -> std::size_t;
+    static auto print(std::size_t count, std::chrono::milliseconds interval) -> int;
+
+private:
+    static constexpr std::uint64_t memory_rotation = 0x40;
+
+    struct entry {
+        process_info info;
+        proc_file schedstat;
+        std::uint64_t runtime { 0x0 };
+        std::uint64_t ticks { 0x0 };
+        std::uint64_t start { 0x0 };
+        std::chrono::steady_clock::time_point stamp;
+        std::uint64_t seen { 0x0 };
+        bool schedstat_missing { false };
+    };
+
+    int proc_fd { -0x1 };
+    std::uint64_t generation { 0x0 };
+    std::size_t descriptors { 0x0 };
+    std::size_t descriptor_budget { 0x0 };
+    std::size_t reparsed { 0x0 };
+    std::size_t checked { 0x0 };
+    std::vector<char> listing;
+    std::vector<char> scratch;
+    std::unordered_map<int, entry> entries;
+
+    auto read_at(char const * path, int * error = nullptr) -> std::string_view;
+    auto runtime(int pid, entry & process) -> std::optional<std::uint64_t>;
+    auto parse_stat(int pid, entry & process, std::chrono::steady_clock::time_point now) -> bool;
+    auto parse_statm(int pid, entry & process) -> void;
+    auto update(int pid, entry & process, std::chrono::steady_clock::time_point now) -> bool;
+    auto release(entry & process) -> void;
+};
+
+#endif //CUBE_PROCESS_HPP
@@ -0,0 +1,192 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "procfs.hpp"
+
+/**
+ * \brief Opens the file once, the descriptor is kept until destruction
+ * @param path Absolute path of the file
+ * @param capacity Initial size of the read buffer
+ */
+proc_file::proc_file(char const * path, std::size_t capacity)
+        : proc_file(AT_FDCWD, path, capacity) { }
+
+/**
+ * \brief Opens a file relative to an already open directory descriptor
+ * @param directory_fd Directory descriptor (or AT_FDCWD)
+ * @param path Path relative to the directory
+ * @param capacity Initial size of the read buffer
+ */
+proc_file::proc_file(int directory_fd, char const * path, std::size_t capacity)
+        : fd(::openat(directory_fd, path, O_RDONLY | O_CLOEXEC)),
+          capacity(capacity),
+          buffer(std::make_unique<char[]>(capacity)) { }
+
+proc_file::proc_file(proc_file && other) noexcept
+        : fd(std::exchange(other.fd, -0x1)),
+          capacity(std::exchange(other.capacity, 0x0)),
+          buffer(std::move(other.buffer)) { }
+
+auto proc_file::operator=(proc_file && other) noexcept -> proc_file & {
+    if (this != &other) {
+        proc_file::close();
+        fd = std::exchange(other.fd, -0x1);
+        capacity = std::exchange(other.capacity, 0x0);
+        buffer = std::move(other.buffer);
+    }
+    return *this;
+}
+
+proc_file::~proc_file() {
+    proc_file::close();
+}
+
+/**
+ * \brief Closes the descriptor, the buffer is kept for reuse
+ */
+auto proc_file::close() -> void {
+    if (fd >= 0x0) ::close(fd);
+    fd = -0x1;
+}
+
+/**
+ * \brief Re-reads the whole file from offset 0x0
+ *      procfs regenerates the content on every read from the start, so a single pread
+ *      usually returns the full snapshot. When the buffer turns out to be too small it is
+ *      doubled and the file is read again, so the view is never a mix of two snapshots
+ * @return view into the internal buffer, valid until the next read(); empty on error
+ */
+auto proc_file::read() -> std::string_view {
+    if (fd < 0x0) return { };
+
+    while (true) {
+        std::size_t size = 0x0;
+        while (size < capacity) {
+            ssize_t n = ::pread(fd, buffer.get() + size, capacity - size, static_cast<off_t>(size));
+            if (n < 0x0) return { };
+            if (n == 0x0) return { buffer.get(), size };
+            size += static_cast<std::size_t>(n);
+        }
+
+        capacity *= 0x2;
+        buffer = std::make_unique<char[]>(capacity);
+    }
+}
+
+/**
+ * \brief Checks whether the remaining text starts with the given prefix
+ * @param prefix Text to compare against
+ * @return boolean value
+ */
+auto proc_scanner::starts_with(std::string_view prefix) const -> bool {
+    return static_cast<std::size_t>(end - cursor) >= prefix.size()
+           && std::string_view(cursor, prefix.size()) == prefix;
+}
+
+/**
+ * \brief Skips blanks and tabs but stops at the end of the line
+ */
+auto proc_scanner::skip_spaces() -> void {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) ++cursor;
+}
+
+/**
+ * \brief Moves the cursor to the first character of the next line
+ */
+auto proc_scanner::next_line() -> void {
+    while (cursor < end && *cursor != '\n') ++cursor;
+    if (cursor < end) ++cursor;
+}
+
+/**
+ * \brief Reads the next whitespace separated word on the current line
+ * @return view into the scanned text, empty at the end of the line
+ */
+auto proc_scanner::next_word() -> std::string_view {
+    proc_scanner::skip_spaces();
+    char const * start = cursor;
+    while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\n') ++cursor;
+    return { start, static_cast<std::size_t>(cursor - start) };
+}
+
+/**
+ * \brief Parses the next unsigned decimal integer on the current line
+ *      A fractional part (as in "/proc/uptime") is skipped
+ * @return parsed value, 0x0 when there is no number before the end of the line
+ */
+auto proc_scanner::next_u64() -> std::uint64_t {
+    while (cursor < end && *cursor != '\n' && (*cursor < '0' || *cursor > '9')) ++cursor;
+
+    std::uint64_t value = 0x0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        value = value * 0xA + static_cast<std::uint64_t>(*cursor - '0');
+        ++cursor;
+    }
+
+    if (cursor < end && *cursor == '.') {
+        ++cursor;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') ++cursor;
+    }
+    return value;
+}
+
+/**
+ * \brief Parses the next signed decimal integer on the current line
+ * @return parsed value, 0x0 when there is no number before the end of the line
+ */
+auto proc_scanner::next_i64() -> std::int64_t {
+    while (cursor < end && *cursor != '\n' && *cursor != '-' && (*cursor < '0' || *cursor > '9')) ++cursor;
+
+    bool negative = cursor < end && *cursor == '-';
+    if (negative) ++cursor;
+
+    auto value = static_cast<std::int64_t>(proc_scanner::next_u64());
+    return negative ? -value : value;
+}
+
+/**
+ * \brief Parses a kernel CPU list such as "0-3,8,10-11" (as in /sys/devices/system/cpu/online)
+ * @return expanded list of CPU numbers in file order
+ */
+auto proc_scanner::next_cpu_list() -> std::vector<int> {
+    std::vector<int> cpus;
+    proc_scanner::skip_spaces();
+
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        auto first = static_cast<int>(proc_scanner::next_u64());
+        int last = first;
+        if (cursor < end && *cursor == '-') {
+            ++cursor;
+            last = static_cast<int>(proc_scanner::next_u64());
+        }
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        if (cursor < end && *cursor == ',') ++cursor;
+    }
+    return cpus;
+}
+
+/**
+ * \brief Formats CPU numbers back into the compact kernel list notation
+ * @param cpus CPU numbers in ascending order
+ * @return list such as "0-3,8"
+ */
+auto format_cpu_list(std::vector<int> const & cpus) -> std::string {
+    std::string result;
+
+    for (std::size_t i = 0x0; i < cpus.size(); ) {
+        std::size_t j = i;
+        while (j + 0x1 < cpus.size() && cpus[j + 0x1] == cpus[j] + 0x1) ++j;
+
+        if (!result.empty()) result += ',';
+        result += std::to_string(cpus[i]);
+        if (j > i) result += '-' + std::to_string(cpus[j]);
+        i = j + 0x1;
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_PROCFS_HPP
+#define CUBE_PROCFS_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * \brief A /proc (or /sys) file that stays open between samples
+ *      Every read() re-reads the whole file with pread into a buffer that is allocated once
+ *      and only ever grows when the file no longer fits into it
+ */
+class proc_file {
+public:
+    proc_file() = default;
+    explicit proc_file(char const * path, std::size_t capacity = 0x1000);
+    proc_file(int directory_fd, char const * path, std::size_t capacity = 0x1000);
+    proc_file(proc_file && other) noexcept;
+    auto operator=(proc_file && other) noexcept -> proc_file &;
+    proc_file(proc_file const &) = delete;
+    auto operator=(proc_file const &) -> proc_file & = delete;
+    ~proc_file();
+
+    [[nodiscard]] auto is_open() const -> bool { return fd >= 0x0; }
+    auto read() -> std::string_view;
+    auto close() -> void;
+
+private:
+    int fd { -0x1 };
+    std::size_t capacity { 0x0 };
+    std::unique_ptr<char[]> buffer;
+};
+
+/**
+ * \brief Hand-written scanner over the text returned by proc_file::read()
+ *      Never allocates, never throws; reading past the end yields zeros and empty views
+ */
+class proc_scanner {
+public:
+    explicit proc_scanner(std::string_view text) : cursor(text.data()), end(text.data() + text.size()) { }
+
+    [[nodiscard]] auto done() const -> bool { return cursor >= end; }
+    [[nodiscard]] auto starts_with(std::string_view prefix) const -> bool;
+    auto skip_spaces() -> void;
+    auto next_line() -> void;
+    auto next_word() -> std::string_view;
+    auto next_u64() -> std::uint64_t;
+    auto next_i64() -> std::int64_t;
+    auto next_cpu_list() -> std::vector<int>;
+
+private:
+    char const * cursor;
+    char const * end;
+};
+
+auto format_cpu_list(std::vector<int> const & cpus) -> std::string;
+
+#endif //CUBE_PROCFS_HPP
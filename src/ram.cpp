@@ -10,20 +10,21 @@
 
 /**
  * \brief Calculates the RAM total according to Page and Pagesize
- * @return total RAM as std::int64_t
+ * @return total RAM in KiB, -1 when sysconf fails
  */
 [[maybe_unused]] auto ram::physmem_total() -> std::int64_t {
     long pages = sysconf(_SC_PHYS_PAGES);
     long page_size = sysconf(_SC_PAGESIZE);
-    return ((pages > 0x0) && (page_size > 0x0)) ? (pages * page_size) / 0x3E8 : 0x1;
+    return ((pages > 0x0) && (page_size > 0x0)) ? static_cast<std::int64_t>(pages) * page_size / 0x400 : -0x1;
 }
 
 /**
  * \brief Calculates the RAM available according to Page and Pagesize
- * @return Available RAM as std::int64_t
+ *      _SC_AVPHYS_PAGES is MemFree, page cache is not counted; memory::info().available is the better figure
+ * @return Available RAM in KiB, -1 when sysconf fails
  */
 [[maybe_unused]] auto ram::physmem_available() -> std::int64_t {
     long pages = sysconf (_SC_AVPHYS_PAGES);
     long page_size = sysconf (_SC_PAGESIZE);
-    return (0x0 <= pages && 0x0 <= page_size) ? (pages * page_size) / 0x3E8 : 0x1;
+    return ((pages >= 0x0) && (page_size > 0x0)) ? static_cast<std::int64_t>(pages) * page_size / 0x400 : -0x1;
 }
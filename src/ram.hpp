@@ -7,6 +7,8 @@
 #ifndef CUBE_RAM_HPP
 #define CUBE_RAM_HPP
 
+#include <cstdint>
+
 struct ram {
 public:
     [[maybe_unused]] static auto physmem_total() -> std::int64_t;
@@ -0,0 +1,332 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#include "rapl.hpp"
+#include "cpuid.hpp"
+#include "sampler.hpp"
+#include "topology.hpp"
+
+/**
+ * \brief Intel server parts whose DRAM domain counts in fixed 15.3 uJ units instead of
+ *      the unit from MSR_RAPL_POWER_UNIT (same list as the Linux intel_rapl driver)
+ * @return boolean value
+ */
+static auto fixed_dram_unit() -> bool {
+    std::uint32_t signature = cpuid_snapshot::host().query(0x1).eax;
+    std::uint32_t family = (signature >> 0x8) & 0xF;
+    std::uint32_t model = ((signature >> 0x4) & 0xF) | ((signature >> 0xC) & 0xF0);
+    if (family != 0x6) return false;
+
+    switch (model) {
+        case 0x3F: case 0x4F: case 0x55: case 0x56: case 0x57: case 0x85:
+        case 0x6A: case 0x6C: case 0x8F: case 0xAD: case 0xAE: case 0xCF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * \brief Opens the MSR device of the first CPU of every package and keeps every domain whose counter reads
+ *      AMD has no package-wide core domain: Core::X86::Msr::CORE_ENERGY_STAT counts per physical core, so one
+ *      counter per core is opened on its first thread and readings() sums them per package.
+ *      The vendor comes from the live CPUID, a replayed dump must not pick the MSR addresses
+ * @return false when no package counter could be read
+ */
+auto rapl::discover_msr() -> bool {
+    cpuid_regs identification = cpuid_snapshot::host().query(0x0);
+    std::uint32_t words[0x3] = { identification.ebx, identification.edx, identification.ecx };
+    std::string vendor(reinterpret_cast<char const *>(words), sizeof(words));
+    bool amd = vendor == "AuthenticAMD" || vendor == "HygonGenuine";
+    bool intel = vendor == "GenuineIntel";
+    if (!amd && !intel) return false;
+
+    struct domain_msr {
+        rapl_domain domain;
+        std::uint32_t address;
+    };
+    std::vector<domain_msr> domains;
+    if (intel) {
+        domains = { { rapl_domain::package, rapl::msr_pkg_energy_status }, { rapl_domain::core, rapl::msr_pp0_energy_status },
+                    { rapl_domain::uncore, rapl::msr_pp1_energy_status }, { rapl_domain::dram, rapl::msr_dram_energy_status },
+                    { rapl_domain::psys, rapl::msr_platform_energy_status } };
+    } else {
+        domains = { { rapl_domain::package, rapl::amd_pkg_energy_status } };
+    }
+
+    cpu_topology layout = topology::enumerate();
+    for (topology_package const & package : layout.packages) {
+        int first = package.dies.front().cores.front().threads.front();
+        msr device(first);
+        auto units = device.read(intel ? rapl::msr_rapl_power_unit : rapl::amd_rapl_power_unit);
+        if (!units) continue;
+
+        double unit = std::ldexp(1.0, -static_cast<int>((*units >> 0x8) & 0x1F));
+        rapl::devices.emplace_back(std::move(device));
+
+        std::size_t package_device = rapl::devices.size() - 0x1;
+
+        for (domain_msr const & d : domains) {
+            if (d.domain == rapl_domain::psys && package.id != layout.packages.front().id) continue;
+            if (!rapl::devices[package_device].read(d.address)) continue;
+
+            counter entry;
+            entry.reading.package = d.domain == rapl_domain::psys ? 0x0 : package.id;
+            entry.reading.domain = d.domain;
+            entry.device = package_device;
+            entry.address = d.address;
+            entry.unit = (d.domain == rapl_domain::dram && intel && fixed_dram_unit()) ? std::ldexp(1.0, -0x10) : unit;
+            rapl::counters.emplace_back(std::move(entry));
+        }
+
+        if (!amd) continue;
+        for (topology_die const & die : package.dies) {
+            for (topology_core const & core : die.cores) {
+                std::size_t index = package_device;
+                if (core.threads.front() != first) {
+                    msr core_device(core.threads.front());
+                    if (!core_device.read(rapl::amd_core_energy_status)) continue;
+                    rapl::devices.emplace_back(std::move(core_device));
+                    index = rapl::devices.size() - 0x1;
+                } else if (!rapl::devices[package_device].read(rapl::amd_core_energy_status)) {
+                    continue;
+                }
+
+                counter entry;
+                entry.reading.package = package.id;
+                entry.reading.domain = rapl_domain::core;
+                entry.device = index;
+                entry.address = rapl::amd_core_energy_status;
+                entry.unit = unit;
+                rapl::counters.emplace_back(std::move(entry));
+            }
+        }
+    }
+    return !rapl::counters.empty();
+}
+
+/**
+ * \brief Uses the powercap zones intel-rapl:N (package-N, psys) and their subzones intel-rapl:N:M (core, uncore, dram),
+ *      which the powercap class lists side by side. The psys zone takes the next free N but covers the platform,
+ *      not a package
+ *      energy_uj counts microjoules and wraps at max_energy_range_uj
+ * @return false when there is no readable zone
+ */
+auto rapl::discover_powercap() -> bool {
+    std::error_code error;
+    for (auto const & zone : std::filesystem::directory_iterator(POWERCAP_RAPL, error)) {
+        std::string name = zone.path().filename().string();
+        if (name.rfind("intel-rapl:", 0x0) != 0x0) continue;
+
+        proc_file name_file((zone.path() / "name").c_str(), 0x40);
+        proc_file range_file((zone.path() / "max_energy_range_uj").c_str(), 0x40);
+        proc_file energy((zone.path() / "energy_uj").c_str(), 0x40);
+        if (!name_file.is_open() || !energy.is_open() || energy.read().empty()) continue;
+
+        std::string_view label = proc_scanner(name_file.read()).next_word();
+        counter entry;
+        entry.reading.package = label == "psys" ? 0x0 : static_cast<std::uint32_t>(std::atoi(name.c_str() + 0xB));
+
+        if (label.rfind("package-", 0x0) == 0x0) entry.reading.domain = rapl_domain::package;
+        else if (label == "core") entry.reading.domain = rapl_domain::core;
+        else if (label == "uncore") entry.reading.domain = rapl_domain::uncore;
+        else if (label == "dram") entry.reading.domain = rapl_domain::dram;
+        else if (label == "psys") entry.reading.domain = rapl_domain::psys;
+        else continue;
+
+        entry.unit = 1e-6;
+        std::uint64_t range = range_file.is_open() ? proc_scanner(range_file.read()).next_u64() : 0x0;
+        entry.range = range ? range + 0x1 : ~0x0ULL;
+        entry.energy = std::move(energy);
+        rapl::counters.emplace_back(std::move(entry));
+    }
+
+    std::sort(rapl::counters.begin(), rapl::counters.end(), [](counter const & a, counter const & b) {
+        return a.reading.package != b.reading.package ? a.reading.package < b.reading.package : a.reading.domain < b.reading.domain;
+    });
+    return !rapl::counters.empty();
+}
+
+/**
+ * \brief Picks the MSRs, then powercap, and primes every counter
+ */
+auto rapl::discover() -> void {
+    if (rapl::discover_msr()) {
+        rapl::active = rapl_source::msr;
+    } else {
+        rapl::counters.clear();
+        rapl::devices.clear();
+        if (rapl::discover_powercap()) rapl::active = rapl_source::powercap;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (counter & entry : rapl::counters) {
+        entry.last = rapl::read_raw(entry).value_or(0x0);
+        entry.stamp = now;
+    }
+}
+
+/**
+ * \brief Resolves the source, only the first call does work
+ * @return false when there are no readable energy counters
+ */
+auto rapl::init() -> bool {
+    std::call_once(rapl::initialized, rapl::discover);
+    return rapl::active != rapl_source::none;
+}
+
+auto rapl::read_raw(counter & entry) -> std::optional<std::uint64_t> {
+    if (rapl::active == rapl_source::msr) {
+        auto value = rapl::devices[entry.device].read(entry.address);
+        if (!value) return std::nullopt;
+        return *value & 0xFFFFFFFF;
+    }
+
+    std::string_view text = entry.energy.read();
+    if (text.empty()) return std::nullopt;
+    return proc_scanner(text).next_u64();
+}
+
+/**
+ * \brief Reads every counter and accumulates the wrap-corrected delta
+ * @return number of domains with a valid reading
+ */
+auto rapl::refresh() -> std::size_t {
+    if (!rapl::init()) return 0x0;
+    std::lock_guard guard(rapl::lock);
+
+    std::size_t valid = 0x0;
+    auto now = std::chrono::steady_clock::now();
+    for (counter & entry : rapl::counters) {
+        auto raw = rapl::read_raw(entry);
+        entry.reading.valid = raw.has_value();
+        if (!raw) continue;
+
+        std::uint64_t delta = (*raw >= entry.last) ? *raw - entry.last : entry.range - entry.last + *raw;
+        double joules = static_cast<double>(delta) * entry.unit;
+        double seconds = std::chrono::duration<double>(now - entry.stamp).count();
+
+        entry.reading.joules += joules;
+        entry.reading.watts = seconds > 0.0 ? joules / seconds : 0.0;
+        entry.last = *raw;
+        entry.stamp = now;
+        ++valid;
+    }
+    return valid;
+}
+
+/**
+ * \brief Copy of the readings, safe to call while other threads refresh
+ *      Counters of the same package and domain (the AMD per-core ones) are summed, valid only when all were read
+ * @return one reading per package and domain
+ */
+auto rapl::readings() -> std::vector<rapl_reading> {
+    std::lock_guard guard(rapl::lock);
+    std::vector<rapl_reading> result;
+    for (counter const & entry : rapl::counters) {
+        auto same = std::find_if(result.begin(), result.end(), [&entry](rapl_reading const & reading) {
+            return reading.package == entry.reading.package && reading.domain == entry.reading.domain;
+        });
+        if (same == result.end()) {
+            result.push_back(entry.reading);
+            continue;
+        }
+        same->joules += entry.reading.joules;
+        same->watts += entry.reading.watts;
+        same->valid = same->valid && entry.reading.valid;
+    }
+    return result;
+}
+
+/**
+ * \brief Energy of one domain summed over all packages, from init() up to the last refresh()
+ * @param domain Domain to sum
+ * @return joules
+ */
+auto rapl::total_joules(rapl_domain domain) -> double {
+    double total = 0.0;
+    for (rapl_reading const & reading : rapl::readings()) if (reading.domain == domain) total += reading.joules;
+    return total;
+}
+
+auto rapl::source() -> rapl_source {
+    rapl::init();
+    return rapl::active;
+}
+
+auto rapl::source_name() -> char const * {
+    switch (rapl::source()) {
+        case rapl_source::msr: return "MSR";
+        case rapl_source::powercap: return "powercap";
+        default: return "none";
+    }
+}
+
+auto rapl::name(rapl_domain domain) -> char const * {
+    switch (domain) {
+        case rapl_domain::package: return "package";
+        case rapl_domain::core: return "core";
+        case rapl_domain::uncore: return "uncore";
+        case rapl_domain::dram: return "dram";
+        case rapl_domain::psys: return "psys";
+    }
+    return "unknown";
+}
+
+/**
+ * \brief Measures every domain over one interval and prints watts next to the CPU utilization
+ * @param interval Measurement interval
+ * @return exit status, 1 when no energy counter is readable
+ */
+auto rapl::print(std::chrono::milliseconds interval) -> int {
+    if (!rapl::init()) {
+        std::fprintf(stderr, "no RAPL counters: needs /dev/cpu/N/msr (modprobe msr, root) or %s/intel-rapl:*\n", POWERCAP_RAPL);
+        return 0x1;
+    }
+
+    sampler::start(interval);
+    rapl::refresh();
+    std::this_thread::sleep_for(interval + interval / 0x4);
+    rapl::refresh();
+
+    std::printf("Source: %s, interval %lld ms, CPU utilization %.1f %%\n", rapl::source_name(),
+                static_cast<long long>(interval.count()), static_cast<double>(sampler::aggregate()));
+    std::printf("%8s %-8s %10s %14s\n", "Package", "Domain", "Watts", "Joules");
+    for (rapl_reading const & reading : rapl::readings()) {
+        if (!reading.valid) continue;
+        if (reading.domain == rapl_domain::psys) std::printf("%8s ", "platform");
+        else std::printf("%8u ", reading.package);
+        std::printf("%-8s %10.2f %14.3f\n", rapl::name(reading.domain), reading.watts, reading.joules);
+    }
+    return 0x0;
+}
+
+rapl_region::rapl_region() : begin(std::chrono::steady_clock::now()) {
+    rapl::refresh();
+    start.package_joules = rapl::total_joules(rapl_domain::package);
+    start.core_joules = rapl::total_joules(rapl_domain::core);
+    start.dram_joules = rapl::total_joules(rapl_domain::dram);
+}
+
+/**
+ * \brief Ends the region
+ * @return energy used since construction, all zero when RAPL is unavailable
+ */
+auto rapl_region::stop() -> rapl_energy {
+    rapl_energy used;
+    rapl::refresh();
+    used.package_joules = rapl::total_joules(rapl_domain::package) - start.package_joules;
+    used.core_joules = rapl::total_joules(rapl_domain::core) - start.core_joules;
+    used.dram_joules = rapl::total_joules(rapl_domain::dram) - start.dram_joules;
+    used.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return used;
+}
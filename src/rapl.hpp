@@ -0,0 +1,113 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_RAPL_HPP
+#define CUBE_RAPL_HPP
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#include "msr.hpp"
+#include "procfs.hpp"
+
+#define POWERCAP_RAPL "/sys/class/powercap"
+
+enum class rapl_domain { package, core, uncore, dram, psys };
+enum class rapl_source { none, msr, powercap };
+
+/**
+ * \brief Energy of one RAPL domain of one package
+ *      joules accumulates since init() with wraparound corrected, watts covers the last refresh interval.
+ *      psys covers the whole platform, its package is always 0x0
+ */
+struct rapl_reading {
+    std::uint32_t package { 0x0 };
+    rapl_domain domain { rapl_domain::package };
+    double joules { 0.0 };
+    double watts { 0.0 };
+    bool valid { false };
+};
+
+/**
+ * \brief Running Average Power Limit energy counters
+ *      Read through /dev/cpu/N/msr on one CPU per package (Intel MSR_*_ENERGY_STATUS, the AMD package energy
+ *      MSR) and, on AMD, one CPU per core for the per-core energy MSR summed into the core domain; or from
+ *      /sys/class/powercap/intel-rapl:* when the MSRs cannot be opened.
+ *      The 32 bit MSR counters wrap after a few minutes at full load on large parts, so refresh()
+ *      has to run at least that often; every wrap between two refreshes is corrected
+ */
+class rapl {
+public:
+    static auto init() -> bool;
+    static auto refresh() -> std::size_t;
+    static auto readings() -> std::vector<rapl_reading>;
+    static auto source() -> rapl_source;
+    static auto source_name() -> char const *;
+    static auto name(rapl_domain domain) -> char const *;
+    static auto total_joules(rapl_domain domain) -> double;
+    static auto print(std::chrono::milliseconds interval) -> int;
+
+private:
+    static constexpr std::uint32_t msr_rapl_power_unit = 0x606;
+    static constexpr std::uint32_t msr_pkg_energy_status = 0x611;
+    static constexpr std::uint32_t msr_dram_energy_status = 0x619;
+    static constexpr std::uint32_t msr_pp0_energy_status = 0x639;
+    static constexpr std::uint32_t msr_pp1_energy_status = 0x641;
+    static constexpr std::uint32_t msr_platform_energy_status = 0x64D;
+    static constexpr std::uint32_t amd_rapl_power_unit = 0xC0010299;
+    static constexpr std::uint32_t amd_core_energy_status = 0xC001029A;
+    static constexpr std::uint32_t amd_pkg_energy_status = 0xC001029B;
+
+    struct counter {
+        rapl_reading reading;
+        std::size_t device { 0x0 };
+        std::uint32_t address { 0x0 };
+        double unit { 0.0 };
+        proc_file energy;
+        std::uint64_t range { 0x100000000 };
+        std::uint64_t last { 0x0 };
+        std::chrono::steady_clock::time_point stamp;
+    };
+
+    static inline std::once_flag initialized;
+    static inline std::mutex lock;
+    static inline rapl_source active { rapl_source::none };
+    static inline std::vector<msr> devices;
+    static inline std::vector<counter> counters;
+
+    static auto discover() -> void;
+    static auto discover_msr() -> bool;
+    static auto discover_powercap() -> bool;
+    static auto read_raw(counter & entry) -> std::optional<std::uint64_t>;
+};
+
+/**
+ * \brief Energy consumed between construction and stop(), summed over all packages
+ *      Usage: rapl_region region; work(); rapl_energy used = region.stop();
+ *      RAPL counts the whole package, so the figure includes everything else running there
+ */
+struct rapl_energy {
+    double package_joules { 0.0 };
+    double core_joules { 0.0 };
+    double dram_joules { 0.0 };
+    double seconds { 0.0 };
+
+    [[nodiscard]] auto watts() const -> double { return seconds > 0.0 ? package_joules / seconds : 0.0; }
+};
+
+class rapl_region {
+public:
+    rapl_region();
+    auto stop() -> rapl_energy;
+
+private:
+    rapl_energy start;
+    std::chrono::steady_clock::time_point begin;
+};
+
+#endif //CUBE_RAPL_HPP
@@ -0,0 +1,444 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cmath>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <tuple>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <condition_variable>
+
+#include "kernels.hpp"
+#include "sampler.hpp"
+#include "recorder.hpp"
+
+struct timeseries_file::file_header {
+    char magic[0x8];
+    std::uint32_t version;
+    std::uint32_t channels;
+    std::uint32_t block_size;
+    std::uint32_t blocks;
+    std::uint32_t interval_ms;
+    std::uint32_t reserved;
+};
+
+/**
+ * \brief One published length of a block's payload; crc covers sequence, first_ms and the first used payload bytes
+ */
+struct timeseries_file::block_commit {
+    std::uint32_t crc;
+    std::uint32_t samples;
+    std::uint32_t used;
+};
+
+/**
+ * \brief Appends alternate between the two commits, so a torn append only ever damages the one being written
+ */
+struct timeseries_file::block_header {
+    std::uint32_t magic;
+    std::uint32_t reserved;
+    block_commit commits[0x2];
+    std::uint64_t sequence;
+    std::int64_t first_ms;
+};
+
+namespace {
+    constexpr char file_magic[0x8] { 'C', 'U', 'B', 'E', 'R', 'E', 'C', '\0' };
+    constexpr std::uint32_t file_version = 0x3;
+    constexpr std::uint32_t block_magic = 0x4B4C4243;
+    constexpr std::size_t header_page = 0x1000;
+
+    std::atomic<bool> stopping { false };
+
+    auto on_signal(int) -> void {
+        stopping.store(true);
+    }
+
+    auto put_varint(std::uint8_t * out, std::uint64_t value) -> std::size_t {
+        std::size_t n = 0x0;
+        while (value >= 0x80) {
+            out[n++] = static_cast<std::uint8_t>(value | 0x80);
+            value >>= 0x7;
+        }
+        out[n++] = static_cast<std::uint8_t>(value);
+        return n;
+    }
+
+    /**
+     * \brief Decodes one varint, never reads past end
+     * @return false on a truncated or overlong varint
+     */
+    auto get_varint(std::uint8_t const *& cursor, std::uint8_t const * end, std::uint64_t & value) -> bool {
+        value = 0x0;
+        for (std::uint32_t shift = 0x0; cursor < end && shift < 0x40; shift += 0x7) {
+            std::uint8_t byte = *cursor++;
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    auto zigzag(std::int64_t value) -> std::uint64_t {
+        return (static_cast<std::uint64_t>(value) << 0x1) ^ static_cast<std::uint64_t>(value >> 0x3F);
+    }
+
+    auto unzigzag(std::uint64_t value) -> std::int64_t {
+        return static_cast<std::int64_t>(value >> 0x1) ^ -static_cast<std::int64_t>(value & 0x1);
+    }
+
+    /**
+     * \brief Utilization in tenths of a percent, the resolution the recording keeps
+     */
+    auto quantize(float value) -> std::int32_t {
+        return std::isfinite(value) ? static_cast<std::int32_t>(std::lround(value * 10.0f)) : 0x0;
+    }
+
+    auto block_crc(std::uint8_t const * block, std::size_t used) -> std::uint32_t {
+        return cube::reference_kernels::checksum()(block + 0x20, 0x10 + used);
+    }
+}
+
+timeseries_file::~timeseries_file() {
+    timeseries_file::close();
+}
+
+auto timeseries_file::close() -> void {
+    if (base) {
+        ::msync(base, mapped, MS_SYNC);
+        ::munmap(base, mapped);
+    }
+    base = nullptr;
+    mapped = 0x0;
+}
+
+auto timeseries_file::block(std::uint64_t index) -> std::uint8_t * {
+    return base + header_page + (index % blocks) * timeseries_file::block_size;
+}
+
+/**
+ * \brief The longest commit of a block whose checksum matches
+ * @param at Start of the block
+ * @return commit, nullptr when the block has none (never written, or both commits damaged)
+ */
+auto timeseries_file::committed(std::uint8_t const * at) -> block_commit const * {
+    auto const * header = reinterpret_cast<block_header const *>(at);
+    block_commit const * best = nullptr;
+    for (block_commit const & commit : header->commits) {
+        if (commit.used > block_size - sizeof(block_header) || commit.crc != block_crc(at, commit.used)) continue;
+        if (!best || commit.used > best->used) best = &commit;
+    }
+    return best;
+}
+
+/**
+ * \brief Maps the ring file, creating or resizing it when its geometry does not match
+ *      An existing file with the same geometry is continued after its newest valid block. Only empty files and
+ *      files starting with the ring file magic are ever resized, anything else is left untouched. A file with another
+ *      geometry or version is truncated and re-extended, so none of its old blocks survive
+ * @param path File path
+ * @param bytes Total file size, rounded down to whole blocks (at least two)
+ * @param channels Values per sample
+ * @param interval_ms Nominal sample interval, stored for the reader
+ * @return false when the file cannot be created or mapped, or already holds something other than a ring file
+ */
+auto timeseries_file::open(char const * path, std::size_t bytes, std::uint32_t channels, std::uint32_t interval_ms) -> bool {
+    timeseries_file::close();
+    if (channels == 0x0 || channels > max_channels) return false;
+
+    this->channels = channels;
+    blocks = static_cast<std::uint32_t>(std::max<std::size_t>(bytes > header_page ? (bytes - header_page) / block_size : 0x0, 0x2));
+    std::size_t size = header_page + static_cast<std::size_t>(blocks) * block_size;
+
+    int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0x0) return false;
+
+    struct stat info { };
+    file_header stored { };
+    if (::fstat(fd, &info) != 0x0 || !S_ISREG(info.st_mode) || (info.st_size > 0x0
+        && (::pread(fd, &stored, sizeof(stored), 0x0) != static_cast<ssize_t>(sizeof(stored))
+            || std::memcmp(stored.magic, file_magic, sizeof(file_magic)) != 0x0))) {
+        ::close(fd);
+        return false;
+    }
+
+    /* a new header truncates first: old blocks would still verify and outrank every new sequence number */
+    bool reuse = static_cast<std::size_t>(info.st_size) == size && stored.version == file_version
+                 && stored.channels == channels && stored.block_size == block_size && stored.blocks == blocks;
+    if (!reuse && (::ftruncate(fd, 0x0) != 0x0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0x0)) {
+        ::close(fd);
+        return false;
+    }
+
+    void * memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0x0);
+    ::close(fd);
+    if (memory == MAP_FAILED) return false;
+    base = static_cast<std::uint8_t *>(memory);
+    mapped = size;
+
+    auto * header = reinterpret_cast<file_header *>(base);
+    sequence = 0x0;
+    if (reuse) {
+        for (std::uint32_t i = 0x0; i < blocks; ++i) {
+            auto const * existing = reinterpret_cast<block_header const *>(block(i));
+            if (existing->magic == block_magic && timeseries_file::committed(block(i))) {
+                sequence = std::max(sequence, existing->sequence + 0x1);
+            }
+        }
+    } else {
+        std::memcpy(header->magic, file_magic, sizeof(file_magic));
+        header->version = file_version;
+        header->channels = channels;
+        header->block_size = block_size;
+        header->blocks = blocks;
+    }
+    header->interval_ms = interval_ms;
+    ::msync(base, header_page, MS_SYNC);
+
+    last_values.assign(channels, 0x0);
+    last_ms = last_delta = 0x0;
+    started = false;
+    return true;
+}
+
+/**
+ * \brief Starts the next block of the ring; the encoder state restarts so the block decodes on its own
+ *      The block that is left is flushed asynchronously first
+ * @param unix_ms Time of the first sample of the new block
+ */
+auto timeseries_file::begin_block(std::int64_t unix_ms) -> void {
+    if (started) {
+        ::msync(block(sequence), block_size, MS_ASYNC);
+        ++sequence;
+    }
+    started = true;
+
+    std::uint8_t * at = block(sequence);
+    auto * header = reinterpret_cast<block_header *>(at);
+    header->magic = 0x0;
+    std::atomic_signal_fence(std::memory_order_release);
+    header->sequence = sequence;
+    header->first_ms = unix_ms;
+    for (block_commit & commit : header->commits) {
+        commit.samples = commit.used = 0x0;
+        commit.crc = block_crc(at, 0x0);
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    header->magic = block_magic;
+
+    slot = 0x0;
+    used = samples = 0x0;
+
+    last_ms = unix_ms;
+    last_delta = 0x0;
+    std::fill(last_values.begin(), last_values.end(), 0x0);
+}
+
+/**
+ * \brief Publishes the payload written so far into the commit not holding the previous one, checksum last
+ *      Until the checksum lands the other commit still verifies, so a crash loses at most the sample being appended
+ */
+auto timeseries_file::seal(std::uint8_t * at) -> void {
+    slot ^= 0x1;
+    block_commit & commit = reinterpret_cast<block_header *>(at)->commits[slot];
+    commit.crc = 0x0;
+    std::atomic_signal_fence(std::memory_order_release);
+    commit.samples = samples;
+    commit.used = used;
+    std::atomic_signal_fence(std::memory_order_release);
+    commit.crc = block_crc(at, used);
+}
+
+/**
+ * \brief Encodes one sample into the current block, or into a fresh one when it does not fit
+ * @param unix_ms Wall clock time of the sample in milliseconds
+ * @param values One value per channel
+ */
+auto timeseries_file::append(std::int64_t unix_ms, float const * values) -> void {
+    if (!base) return;
+    if (!started) timeseries_file::begin_block(unix_ms);
+
+    std::uint8_t encoded[0xA + 0x5 * max_channels];
+    auto encode = [&] {
+        std::int64_t delta = unix_ms - last_ms;
+        std::size_t n = put_varint(encoded, zigzag(delta - last_delta));
+        for (std::uint32_t c = 0x0; c < channels; ++c) {
+            n += put_varint(encoded + n, zigzag(static_cast<std::int64_t>(quantize(values[c])) - last_values[c]));
+        }
+        return n;
+    };
+
+    std::size_t length = encode();
+    if (sizeof(block_header) + used + length > block_size) {
+        timeseries_file::begin_block(unix_ms);
+        length = encode();
+    }
+
+    std::memcpy(block(sequence) + sizeof(block_header) + used, encoded, length);
+    used += static_cast<std::uint32_t>(length);
+    samples += 0x1;
+    timeseries_file::seal(block(sequence));
+
+    last_delta = unix_ms - last_ms;
+    last_ms = unix_ms;
+    for (std::uint32_t c = 0x0; c < channels; ++c) last_values[c] = quantize(values[c]);
+}
+
+/**
+ * \brief Decodes the longest verified prefix of every block, in sequence order
+ * @param path Ring file
+ * @return decoded frames, std::nullopt when the file is not a ring file
+ */
+auto timeseries_file::load(char const * path) -> std::optional<recording> {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0x0) return std::nullopt;
+    struct stat info { };
+    if (::fstat(fd, &info) != 0x0 || static_cast<std::size_t>(info.st_size) < header_page) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    auto size = static_cast<std::size_t>(info.st_size);
+    void * memory = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0x0);
+    ::close(fd);
+    if (memory == MAP_FAILED) return std::nullopt;
+    auto const * bytes = static_cast<std::uint8_t const *>(memory);
+    auto const * header = reinterpret_cast<file_header const *>(bytes);
+
+    if (std::memcmp(header->magic, file_magic, sizeof(file_magic)) != 0x0 || header->version != file_version
+        || header->block_size != block_size || header_page + static_cast<std::size_t>(header->blocks) * block_size > size) {
+        ::munmap(memory, size);
+        return std::nullopt;
+    }
+
+    recording result;
+    result.channels = header->channels;
+    result.interval_ms = header->interval_ms;
+
+    std::vector<std::tuple<std::uint64_t, std::uint8_t const *, block_commit const *>> valid;
+    for (std::uint32_t i = 0x0; i < header->blocks; ++i) {
+        std::uint8_t const * at = bytes + header_page + static_cast<std::size_t>(i) * block_size;
+        if (reinterpret_cast<block_header const *>(at)->magic != block_magic) continue;
+        block_commit const * commit = timeseries_file::committed(at);
+        if (!commit) {
+            ++result.corrupt_blocks;
+            continue;
+        }
+        valid.emplace_back(reinterpret_cast<block_header const *>(at)->sequence, at, commit);
+    }
+    std::sort(valid.begin(), valid.end(), [](auto const & a, auto const & b) { return std::get<0x0>(a) < std::get<0x0>(b); });
+
+    for (auto const & [sequence, at, commit] : valid) {
+        auto const * existing = reinterpret_cast<block_header const *>(at);
+        std::uint8_t const * cursor = at + sizeof(block_header);
+        std::uint8_t const * end = cursor + commit->used;
+
+        std::int64_t last_ms = existing->first_ms, last_delta = 0x0;
+        std::vector<std::int64_t> tenths(result.channels, 0x0);
+        for (std::uint32_t s = 0x0; s < commit->samples; ++s) {
+            std::uint64_t raw;
+            if (!get_varint(cursor, end, raw)) break;
+            last_delta += unzigzag(raw);
+            last_ms += last_delta;
+
+            recorded_frame frame;
+            frame.unix_ms = last_ms;
+            frame.values.resize(result.channels);
+            bool complete = true;
+            for (std::uint32_t c = 0x0; c < result.channels && complete; ++c) {
+                complete = get_varint(cursor, end, raw);
+                tenths[c] += unzigzag(raw);
+                frame.values[c] = static_cast<float>(tenths[c]) / 10.0f;
+            }
+            if (!complete) break;
+            result.frames.emplace_back(std::move(frame));
+        }
+    }
+
+    ::munmap(memory, size);
+    return result;
+}
+
+/**
+ * \brief Starts the sampler if needed and a thread that appends every new sampler frame to the ring file
+ * @param path Ring file
+ * @param bytes File size
+ * @return false when the file cannot be opened
+ */
+auto recorder::start(std::string const & path, std::size_t bytes) -> bool {
+    std::scoped_lock guard(recorder::lock);
+    if (recorder::worker.joinable()) return true;
+
+    if (!sampler::running()) sampler::start();
+    auto channels = static_cast<std::uint32_t>(sampler::cpus() + 0x1);
+    recorder::file = std::make_unique<timeseries_file>();
+    if (!recorder::file->open(path.c_str(), bytes, channels, static_cast<std::uint32_t>(sampler::interval().count()))) {
+        recorder::file.reset();
+        return false;
+    }
+
+    recorder::worker = std::jthread([](std::stop_token token) {
+        std::mutex wait_lock;
+        std::condition_variable_any wake;
+        std::vector<float> frame(sampler::cpus() + 0x1);
+        std::uint64_t next = sampler::frames();
+
+        std::unique_lock<std::mutex> guard(wait_lock);
+        while (!wake.wait_for(guard, token, sampler::interval(), [] { return false; })) {
+            if (token.stop_requested()) break;
+            std::uint64_t head = sampler::frames();
+            if (head - next > sampler::capacity - 0x2) next = head - (sampler::capacity - 0x2);
+
+            auto offset = std::chrono::system_clock::now().time_since_epoch() - std::chrono::steady_clock::now().time_since_epoch();
+            for (; next < head; ++next) {
+                std::size_t age = head - 0x1 - next;
+                if (!sampler::frame(frame.data(), frame.size(), age)) continue;
+                auto stamp = sampler::timestamp(age).time_since_epoch() + offset;
+                recorder::file->append(std::chrono::duration_cast<std::chrono::milliseconds>(stamp).count(), frame.data());
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * \brief Stops the recording thread and flushes the file
+ */
+auto recorder::stop() -> void {
+    std::scoped_lock guard(recorder::lock);
+    if (recorder::worker.joinable()) {
+        recorder::worker.request_stop();
+        recorder::worker.join();
+    }
+    recorder::file.reset();
+}
+
+/**
+ * \brief Headless recording until SIGINT or SIGTERM
+ * @param path Ring file
+ * @param bytes File size
+ * @param interval Sampler interval
+ * @return exit status, 1 when the file cannot be opened
+ */
+auto recorder::run(std::string const & path, std::size_t bytes, std::chrono::milliseconds interval) -> int {
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    sampler::start(interval);
+    if (!recorder::start(path, bytes)) {
+        std::fprintf(stderr, "cannot map %s as a ring file (an existing file must be empty or a recording)\n", path.c_str());
+        return 0x1;
+    }
+
+    std::fprintf(stderr, "recording %zu channels every %lld ms into %s\n", sampler::cpus() + 0x1,
+                 static_cast<long long>(interval.count()), path.c_str());
+    while (!stopping.load()) std::this_thread::sleep_for(std::chrono::milliseconds(0xC8));
+    recorder::stop();
+    return 0x0;
+}
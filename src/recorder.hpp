@@ -0,0 +1,107 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_RECORDER_HPP
+#define CUBE_RECORDER_HPP
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+/**
+ * \brief One decoded sample: wall clock time and one value per channel
+ */
+struct recorded_frame {
+    std::int64_t unix_ms { 0x0 };
+    std::vector<float> values;
+};
+
+/**
+ * \brief Everything that could be decoded from a ring file, oldest frame first
+ *      corrupt_blocks counts blocks whose commits both fail their checksum (only damage outside CUBE does that)
+ */
+struct recording {
+    std::uint32_t channels { 0x0 };
+    std::uint32_t interval_ms { 0x0 };
+    std::vector<recorded_frame> frames;
+    std::size_t corrupt_blocks { 0x0 };
+};
+
+/**
+ * \brief Fixed-size, memory-mapped ring file of compressed samples
+ *      Layout: one 4 KiB header page, then 4 KiB blocks reused round-robin. Every block is self-contained:
+ *      its header holds a sequence number, the absolute time of its first sample and two commits of sample count,
+ *      payload length and a CRC-32C over that prefix, written alternately.
+ *      Inside a block timestamps are zigzag varints of the delta-of-delta in milliseconds (0 at a steady rate),
+ *      values are quantized to 0.1 % and stored as zigzag varints of the change since the previous sample of
+ *      the same channel: one byte while a CPU moves less than 6.4 points, two bytes up to 819 points.
+ *      A crash while appending only damages the commit being written; readers use the other one and lose that sample
+ */
+class timeseries_file {
+public:
+    static constexpr std::size_t block_size = 0x1000;
+    static constexpr std::uint32_t max_channels = 0x320;
+
+    timeseries_file() = default;
+    timeseries_file(timeseries_file const &) = delete;
+    auto operator=(timeseries_file const &) -> timeseries_file & = delete;
+    ~timeseries_file();
+
+    auto open(char const * path, std::size_t bytes, std::uint32_t channels, std::uint32_t interval_ms) -> bool;
+    auto append(std::int64_t unix_ms, float const * values) -> void;
+    auto close() -> void;
+    [[nodiscard]] auto is_open() const -> bool { return base != nullptr; }
+
+    static auto load(char const * path) -> std::optional<recording>;
+
+private:
+    struct file_header;
+    struct block_commit;
+    struct block_header;
+
+    std::uint8_t * base { nullptr };
+    std::size_t mapped { 0x0 };
+    std::uint32_t channels { 0x0 };
+    std::uint32_t blocks { 0x0 };
+    std::uint64_t sequence { 0x0 };
+    bool started { false };
+    std::int64_t last_ms { 0x0 };
+    std::int64_t last_delta { 0x0 };
+    std::uint32_t used { 0x0 };
+    std::uint32_t samples { 0x0 };
+    std::uint32_t slot { 0x0 };
+    std::vector<std::int32_t> last_values;
+
+    auto block(std::uint64_t index) -> std::uint8_t *;
+    auto begin_block(std::int64_t unix_ms) -> void;
+    auto seal(std::uint8_t * at) -> void;
+
+    static auto committed(std::uint8_t const * at) -> block_commit const *;
+};
+
+/**
+ * \brief Follows the sampler from its own thread and appends every published frame to a ring file
+ *      The sampler never waits for the recorder: frames are read through the sampler's lock-free ring,
+ *      and a recorder that falls more than a ring behind simply skips the lost frames
+ */
+class recorder {
+public:
+    static auto start(std::string const & path, std::size_t bytes) -> bool;
+    static auto stop() -> void;
+    static auto run(std::string const & path, std::size_t bytes, std::chrono::milliseconds interval) -> int;
+
+private:
+    static inline std::mutex lock;
+    static inline std::unique_ptr<timeseries_file> file;
+    static inline std::jthread worker;
+};
+
+#endif //CUBE_RECORDER_HPP
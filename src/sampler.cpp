@@ -0,0 +1,262 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <string_view>
+#include <unistd.h>
+
+#include "cpu.hpp"
+#include "sampler.hpp"
+
+/**
+ * \brief Lazily constructed sampler state
+ *      The worker thread is the last member, so it is joined before the ring is released
+ * @return reference to the process wide state
+ */
+auto sampler::instance() -> sampler::state & {
+    static sampler::state s;
+    return s;
+}
+
+/**
+ * \brief Reads the aggregate and every per-core "cpu" line from "/proc/stat"
+ *      Offline CPUs have no line in the file, so their previous totals are kept
+ * @param file Persistent descriptor of "/proc/stat"
+ * @param out Slot 0x0 receives the aggregate, slot N + 0x1 receives "cpuN"
+ * @return false when the file cannot be read
+ */
+auto sampler::read_stat(proc_file & file, std::vector<cpu_times> & out) -> bool {
+    std::string_view text = file.read();
+    if (text.empty()) return false;
+
+    for (proc_scanner scanner(text); scanner.starts_with("cpu"); scanner.next_line()) {
+        std::string_view token = scanner.next_word();
+
+        std::size_t slot = 0x0;
+        if (token.size() > 0x3) {
+            for (char digit : token.substr(0x3)) slot = slot * 0xA + static_cast<std::size_t>(digit - '0');
+            ++slot;
+        }
+        if (slot >= out.size()) continue;
+
+        std::uint64_t user = scanner.next_u64(), nice = scanner.next_u64(), system = scanner.next_u64(),
+                idle = scanner.next_u64(), iowait = scanner.next_u64(), irq = scanner.next_u64(),
+                softirq = scanner.next_u64(), steal = scanner.next_u64();
+
+        std::uint64_t total = user + nice + system + idle + iowait + irq + softirq + steal;
+        out[slot].total = total;
+        out[slot].busy = total - (idle + iowait);
+    }
+    return true;
+}
+
+/**
+ * \brief Turns the difference between the last two reads into a frame and publishes it
+ * @param s Sampler state, only ever written from one thread at a time
+ */
+auto sampler::publish(sampler::state & s) -> void {
+    std::uint64_t head = s.head.load(std::memory_order_relaxed);
+    std::size_t slot = head % sampler::capacity;
+    std::atomic<std::uint32_t> & sequence = s.sequence[slot];
+    std::uint32_t version = sequence.load(std::memory_order_relaxed);
+
+    sequence.store(version + 0x1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t column = 0x0; column < s.width; ++column) {
+        std::uint64_t total = s.current[column].total - s.previous[column].total;
+        std::uint64_t busy = s.current[column].busy - s.previous[column].busy;
+        float usage = (total == 0x0 || busy > total) ? 0.0f
+                : static_cast<float>(busy) / static_cast<float>(total) * 100.0f;
+        s.ring[slot * s.width + column].store(usage, std::memory_order_relaxed);
+    }
+    s.stamps[slot].store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                         std::memory_order_relaxed);
+
+    sequence.store(version + 0x2, std::memory_order_release);
+    s.head.store(head + 0x1, std::memory_order_release);
+    s.previous.swap(s.current);
+    s.current = s.previous;
+}
+
+/**
+ * \brief Starts the sampler thread if it is not running yet
+ *      The first frame is published synchronously and covers the time since boot,
+ *      so readers get a value immediately instead of waiting for one interval
+ * @param interval Time between two snapshots
+ */
+auto sampler::start(std::chrono::milliseconds interval) -> void {
+    sampler::state & s = sampler::instance();
+    std::scoped_lock guard(s.lock);
+    if (s.worker.joinable()) return;
+
+    if (!s.ring) {
+        long configured = sysconf(_SC_NPROCESSORS_CONF);
+        s.width = static_cast<std::size_t>(configured > 0x0 ? configured : 0x1) + 0x1;
+        s.ring = std::make_unique<std::atomic<float>[]>(sampler::capacity * s.width);
+        s.stamps = std::make_unique<std::atomic<std::int64_t>[]>(sampler::capacity);
+        s.sequence = std::make_unique<std::atomic<std::uint32_t>[]>(sampler::capacity);
+        s.previous.assign(s.width, cpu_times { });
+        s.current.assign(s.width, cpu_times { });
+    }
+
+    s.interval = interval;
+    if (!s.stat.is_open()) s.stat = proc_file(CPU_STAT, 0x4000);
+    if (!sampler::read_stat(s.stat, s.current)) cpu::fatal_error("Error: Failed to open /proc/stat");
+    sampler::publish(s);
+
+    s.worker = std::jthread([&s](std::stop_token token) {
+        std::unique_lock<std::mutex> wait_lock(s.lock);
+        while (!s.wake.wait_for(wait_lock, token, s.interval, [] { return false; })) {
+            if (token.stop_requested()) break;
+            wait_lock.unlock();
+            if (sampler::read_stat(s.stat, s.current)) sampler::publish(s);
+            wait_lock.lock();
+        }
+    });
+}
+
+/**
+ * \brief Stops the sampler thread, published frames stay readable
+ */
+auto sampler::stop() -> void {
+    sampler::state & s = sampler::instance();
+    std::jthread worker;
+    {
+        std::scoped_lock guard(s.lock);
+        worker = std::move(s.worker);
+    }
+    if (worker.joinable()) {
+        worker.request_stop();
+        worker.join();
+    }
+}
+
+/**
+ * \brief Checks whether the sampler thread is running
+ * @return boolean value
+ */
+auto sampler::running() -> bool {
+    sampler::state & s = sampler::instance();
+    std::scoped_lock guard(s.lock);
+    return s.worker.joinable();
+}
+
+/**
+ * \brief Number of logical CPUs a frame has a column for
+ * @return configured CPU count, 0x0 before the first start()
+ */
+auto sampler::cpus() -> std::size_t {
+    std::size_t width = sampler::instance().width;
+    return width ? width - 0x1 : 0x0;
+}
+
+/**
+ * \brief Number of frames published so far
+ * @return monotonically increasing frame counter
+ */
+auto sampler::frames() -> std::uint64_t {
+    return sampler::instance().head.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Time between two snapshots
+ * @return interval the sampler was started with
+ */
+auto sampler::interval() -> std::chrono::milliseconds {
+    return sampler::instance().interval;
+}
+
+/**
+ * \brief Copies a run of columns out of a published frame without blocking the writer
+ * @param s Sampler state
+ * @param age 0x0 is the newest frame, 0x1 the one before it and so on
+ * @param first First column to copy
+ * @param out Destination for count values
+ * @param count Number of columns
+ * @return false when the frame does not exist (yet) or has been overwritten
+ */
+auto sampler::read_span(sampler::state const & s, std::size_t age, std::size_t first,
+                        float * out, std::size_t count) -> bool {
+    if (first + count > s.width) return false;
+
+    while (true) {
+        std::uint64_t head = s.head.load(std::memory_order_acquire);
+        if (age >= head || age >= sampler::capacity - 0x1) return false;
+
+        std::size_t slot = (head - 0x1 - age) % sampler::capacity;
+        std::uint32_t before = s.sequence[slot].load(std::memory_order_acquire);
+        if (before & 0x1) continue;
+
+        for (std::size_t i = 0x0; i < count; ++i) {
+            out[i] = s.ring[slot * s.width + first + i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence[slot].load(std::memory_order_relaxed) == before) return true;
+    }
+}
+
+/**
+ * \brief Aggregate utilization of all CPUs
+ * @param age 0x0 is the newest frame
+ * @return percentage in [0, 100], 0 when the frame does not exist
+ */
+auto sampler::aggregate(std::size_t age) -> float {
+    float value = 0.0f;
+    sampler::read_span(sampler::instance(), age, 0x0, &value, 0x1);
+    return value;
+}
+
+/**
+ * \brief Utilization of one logical CPU
+ * @param cpu Logical CPU number as in "cpuN"
+ * @param age 0x0 is the newest frame
+ * @return percentage in [0, 100], 0 when the frame or CPU does not exist
+ */
+auto sampler::core(std::size_t cpu, std::size_t age) -> float {
+    float value = 0.0f;
+    sampler::read_span(sampler::instance(), age, cpu + 0x1, &value, 0x1);
+    return value;
+}
+
+/**
+ * \brief Copies a whole frame (aggregate first, then every CPU)
+ * @param out Destination buffer
+ * @param width Size of the destination, at most cpus() + 0x1 values are written
+ * @param age 0x0 is the newest frame
+ * @return false when the frame does not exist
+ */
+auto sampler::frame(float * out, std::size_t width, std::size_t age) -> bool {
+    sampler::state const & s = sampler::instance();
+    return sampler::read_span(s, age, 0x0, out, std::min(width, s.width));
+}
+
+/**
+ * \brief Copies the history of one column, newest value first
+ * @param column 0x0 for the aggregate, N + 0x1 for logical CPU N
+ * @param out Destination buffer
+ * @param count Maximum number of values
+ * @return number of values written
+ */
+auto sampler::history(std::size_t column, float * out, std::size_t count) -> std::size_t {
+    sampler::state const & s = sampler::instance();
+    std::size_t written = 0x0;
+    while (written < count && sampler::read_span(s, written, column, out + written, 0x1)) ++written;
+    return written;
+}
+
+/**
+ * \brief Time at which a frame was published
+ * @param age 0x0 is the newest frame
+ * @return steady_clock time point, epoch when the frame does not exist
+ */
+auto sampler::timestamp(std::size_t age) -> std::chrono::steady_clock::time_point {
+    sampler::state const & s = sampler::instance();
+    std::uint64_t head = s.head.load(std::memory_order_acquire);
+    if (age >= head || age >= sampler::capacity - 0x1) return { };
+    std::size_t slot = (head - 0x1 - age) % sampler::capacity;
+    return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(s.stamps[slot].load(std::memory_order_relaxed)));
+}
@@ -0,0 +1,76 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_SAMPLER_HPP
+#define CUBE_SAMPLER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+#include "procfs.hpp"
+
+/**
+ * \brief Accumulated jiffies of one "cpu" line from /proc/stat
+ */
+struct cpu_times {
+    std::uint64_t busy { 0x0 };
+    std::uint64_t total { 0x0 };
+};
+
+/**
+ * \brief Background /proc/stat sampler
+ *      A worker thread snapshots the aggregate and every "cpuN" line each interval and
+ *      publishes the utilization deltas into a fixed-size ring of frames.
+ *      Column 0x0 of a frame is the aggregate, column N + 0x1 is logical CPU N.
+ *      Readers never block: every frame is guarded by a sequence counter and a reader
+ *      simply retries when it races with the writer.
+ */
+class sampler {
+public:
+    static constexpr std::size_t capacity = 0x100;
+    static constexpr std::chrono::milliseconds default_interval { 0x1F4 };
+
+    static auto start(std::chrono::milliseconds interval = default_interval) -> void;
+    static auto stop() -> void;
+    static auto running() -> bool;
+    static auto cpus() -> std::size_t;
+    static auto frames() -> std::uint64_t;
+    static auto interval() -> std::chrono::milliseconds;
+    static auto aggregate(std::size_t age = 0x0) -> float;
+    static auto core(std::size_t cpu, std::size_t age = 0x0) -> float;
+    static auto frame(float * out, std::size_t width, std::size_t age = 0x0) -> bool;
+    static auto history(std::size_t column, float * out, std::size_t count) -> std::size_t;
+    static auto timestamp(std::size_t age = 0x0) -> std::chrono::steady_clock::time_point;
+
+private:
+    struct state {
+        std::size_t width { 0x0 };
+        std::chrono::milliseconds interval { default_interval };
+        std::unique_ptr<std::atomic<float>[]> ring;
+        std::unique_ptr<std::atomic<std::int64_t>[]> stamps;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> sequence;
+        std::atomic<std::uint64_t> head { 0x0 };
+        std::vector<cpu_times> previous;
+        std::vector<cpu_times> current;
+        proc_file stat;
+        std::mutex lock;
+        std::condition_variable_any wake;
+        std::jthread worker;
+    };
+
+    static auto instance() -> state &;
+    static auto read_stat(proc_file & file, std::vector<cpu_times> & out) -> bool;
+    static auto publish(state & s) -> void;
+    static auto read_span(state const & s, std::size_t age, std::size_t first, float * out, std::size_t count) -> bool;
+};
+
+#endif //CUBE_SAMPLER_HPP
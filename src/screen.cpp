@@ -0,0 +1,132 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdio>
+#include <cstdarg>
+#include <algorithm>
+
+#include "screen.hpp"
+
+/**
+ * \brief Sizes both buffers for the terminal; a changed size forces the next flush to repaint everything
+ * @param rows Terminal lines
+ * @param cols Terminal columns
+ */
+auto screen_buffer::resize(int rows, int cols) -> void {
+    rows = std::max(rows, 0x0);
+    cols = std::max(cols, 0x0);
+    if (rows == height && cols == width) return;
+
+    height = rows;
+    width = cols;
+    back.assign(static_cast<std::size_t>(rows) * static_cast<std::size_t>(cols), screen_cell { });
+    front.resize(back.size());
+    run.resize(static_cast<std::size_t>(cols) + 0x1);
+    screen_buffer::invalidate();
+}
+
+/**
+ * \brief Forgets what is on the terminal, for a resize or after something else wrote to it
+ */
+auto screen_buffer::invalidate() -> void {
+    std::fill(front.begin(), front.end(), screen_cell { L'\0', A_NORMAL, -0x1 });
+}
+
+/**
+ * \brief Blanks the back buffer before a frame is composed
+ */
+auto screen_buffer::clear() -> void {
+    std::fill(back.begin(), back.end(), screen_cell { });
+}
+
+auto screen_buffer::put(int row, int col, wchar_t glyph, attr_t attributes, short pair) -> void {
+    if (row < 0x0 || row >= height || col < 0x0 || col >= width) return;
+    back[static_cast<std::size_t>(row) * static_cast<std::size_t>(width) + static_cast<std::size_t>(col)] = { glyph, attributes, pair };
+}
+
+auto screen_buffer::fill(int row, int col, int count, wchar_t glyph, attr_t attributes, short pair) -> void {
+    for (int i = 0x0; i < count; ++i) screen_buffer::put(row, col + i, glyph, attributes, pair);
+}
+
+/**
+ * \brief Writes UTF-8 text on one line, clipped at the right edge
+ * @return number of cells written
+ */
+auto screen_buffer::print(int row, int col, std::string_view text, attr_t attributes, short pair) -> int {
+    int written = 0x0;
+    for (std::size_t i = 0x0; i < text.size(); ) {
+        auto byte = static_cast<unsigned char>(text[i]);
+        std::size_t length = byte < 0x80 ? 0x1 : (byte >> 0x5) == 0x6 ? 0x2 : (byte >> 0x4) == 0xE ? 0x3 : (byte >> 0x3) == 0x1E ? 0x4 : 0x1;
+        if (i + length > text.size()) length = 0x1;
+
+        auto glyph = static_cast<wchar_t>(length == 0x1 ? byte : byte & (0x7F >> length));
+        for (std::size_t k = 0x1; k < length; ++k) glyph = static_cast<wchar_t>((glyph << 0x6) | (text[i + k] & 0x3F));
+
+        screen_buffer::put(row, col + written, glyph, attributes, pair);
+        ++written;
+        i += length;
+    }
+    return written;
+}
+
+/**
+ * \brief printf into a fixed stack buffer, then print()
+ * @return number of cells written
+ */
+auto screen_buffer::printf(int row, int col, attr_t attributes, short pair, char const * format, ...) -> int {
+    char text[0x200];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = std::vsnprintf(text, sizeof(text), format, arguments);
+    va_end(arguments);
+    if (length < 0x0) return 0x0;
+    return screen_buffer::print(row, col, std::string_view(text, std::min<std::size_t>(static_cast<std::size_t>(length), sizeof(text) - 0x1)),
+                                attributes, pair);
+}
+
+/**
+ * \brief Hands every run of changed cells to stdscr and refreshes
+ *      Runs separated by fewer than four unchanged cells are merged, one call with a few extra cells
+ *      is cheaper than restarting the cursor addressing
+ * @return number of cells handed to ncurses, 0 for an unchanged frame
+ */
+auto screen_buffer::flush() -> std::size_t {
+    std::size_t emitted = 0x0;
+    auto const stride = static_cast<std::size_t>(width);
+
+    for (int row = 0x0; row < height; ++row) {
+        screen_cell const * next = back.data() + static_cast<std::size_t>(row) * stride;
+        screen_cell * shown = front.data() + static_cast<std::size_t>(row) * stride;
+
+        for (int col = 0x0; col < width; ) {
+            if (next[col] == shown[col]) {
+                ++col;
+                continue;
+            }
+
+            int end = col + 0x1, gap = 0x0;
+            for (int probe = end; probe < width && gap < 0x4; ++probe) {
+                if (next[probe] == shown[probe]) {
+                    ++gap;
+                } else {
+                    end = probe + 0x1;
+                    gap = 0x0;
+                }
+            }
+
+            for (int i = col; i < end; ++i) {
+                wchar_t glyph[0x2] { next[i].glyph, L'\0' };
+                setcchar(&run[static_cast<std::size_t>(i - col)], glyph, next[i].attributes, next[i].pair, nullptr);
+                shown[i] = next[i];
+            }
+            mvadd_wchnstr(row, col, run.data(), end - col);
+            emitted += static_cast<std::size_t>(end - col);
+            col = end;
+        }
+    }
+
+    if (emitted) refresh();
+    return emitted;
+}
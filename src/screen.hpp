@@ -0,0 +1,55 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_SCREEN_HPP
+#define CUBE_SCREEN_HPP
+
+#include <vector>
+#include <cstddef>
+#include <ncurses.h>
+#include <string_view>
+
+/**
+ * \brief One character cell: glyph, attributes and color pair
+ */
+struct screen_cell {
+    wchar_t glyph { L' ' };
+    attr_t attributes { A_NORMAL };
+    short pair { 0x0 };
+
+    auto operator==(screen_cell const &) const -> bool = default;
+};
+
+/**
+ * \brief Double-buffered cell grid in front of stdscr
+ *      A frame is composed into the back buffer from scratch, flush() compares it with what is on the terminal
+ *      and hands only the changed runs to ncurses, so an unchanged frame costs a buffer compare and no output.
+ *      Both buffers are allocated once per terminal size; composing and flushing never allocate
+ */
+class screen_buffer {
+public:
+    auto resize(int rows, int cols) -> void;
+    auto invalidate() -> void;
+    auto clear() -> void;
+    auto put(int row, int col, wchar_t glyph, attr_t attributes = A_NORMAL, short pair = 0x0) -> void;
+    auto fill(int row, int col, int count, wchar_t glyph, attr_t attributes = A_NORMAL, short pair = 0x0) -> void;
+    auto print(int row, int col, std::string_view text, attr_t attributes = A_NORMAL, short pair = 0x0) -> int;
+    auto printf(int row, int col, attr_t attributes, short pair, char const * format, ...) -> int
+            __attribute__((format(printf, 0x6, 0x7)));
+    auto flush() -> std::size_t;
+
+    [[nodiscard]] auto rows() const -> int { return height; }
+    [[nodiscard]] auto cols() const -> int { return width; }
+
+private:
+    int height { 0x0 };
+    int width { 0x0 };
+    std::vector<screen_cell> front;
+    std::vector<screen_cell> back;
+    std::vector<cchar_t> run;
+};
+
+#endif //CUBE_SCREEN_HPP
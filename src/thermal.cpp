@@ -0,0 +1,152 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cstdlib>
+#include <sensors/sensors.h>
+
+#include "thermal.hpp"
+
+/**
+ * \brief Derives the kind of a channel from its label
+ *      coretemp names its inputs "Package id N" and "Core N", k10temp uses "Tctl"/"Tdie"
+ * @param channel Channel with chip and label already filled in
+ */
+auto thermal::classify(thermal_channel & channel) -> void {
+    std::string const & label = channel.label;
+
+    if (label.rfind("Package id", 0x0) == 0x0 || label == "Tctl" || label == "Tdie") {
+        channel.kind = thermal_kind::package;
+    } else if (label.rfind("Core ", 0x0) == 0x0) {
+        channel.kind = thermal_kind::core;
+        channel.core = std::atoi(label.c_str() + 0x5);
+    } else {
+        channel.kind = thermal_kind::other;
+    }
+}
+
+/**
+ * \brief Walks every detected chip once and caches a handle for each temperature input
+ */
+auto thermal::discover() -> void {
+    int nr = 0x0;
+    sensors_chip_name const * chip;
+
+    while ((chip = sensors_get_detected_chips(nullptr, &nr))) {
+        char chip_name[0x80];
+        if (sensors_snprintf_chip_name(chip_name, sizeof(chip_name), chip) < 0x0) chip_name[0x0] = '\0';
+
+        int nr_second = 0x0;
+        sensors_feature const * feature;
+
+        while ((feature = sensors_get_features(chip, &nr_second))) {
+            if (feature->type != SENSORS_FEATURE_TEMP) continue;
+
+            sensors_subfeature const * input = sensors_get_subfeature(chip, feature, SENSORS_SUBFEATURE_TEMP_INPUT);
+            if (!input) continue;
+
+            thermal_channel channel;
+            channel.chip = chip_name;
+            char * label = sensors_get_label(chip, feature);
+            channel.label = label ? label : feature->name;
+            std::free(label);
+            thermal::classify(channel);
+
+            handle cached;
+            cached.chip = chip;
+            cached.subfeature = input->number;
+            if (chip->path) cached.input = proc_file((std::string(chip->path) + "/" + input->name).c_str(), 0x20);
+
+            thermal::handles.emplace_back(std::move(cached));
+            thermal::inputs.emplace_back(std::move(channel));
+        }
+    }
+}
+
+/**
+ * \brief Releases the libsensors session at exit, after the cached descriptors
+ */
+auto thermal::shutdown() -> void {
+    thermal::handles.clear();
+    sensors_cleanup();
+}
+
+/**
+ * \brief Initializes libsensors and resolves all temperature inputs, only the first call does work
+ * @return false when libsensors could not be initialized or found no temperature input
+ */
+auto thermal::init() -> bool {
+    std::call_once(thermal::initialized, [] {
+        if (sensors_init(nullptr) != 0x0) return;
+        thermal::discover();
+        std::atexit(thermal::shutdown);
+        thermal::available = !thermal::inputs.empty();
+        thermal::refresh();
+    });
+    return thermal::available;
+}
+
+/**
+ * \brief Re-reads every cached input
+ * @return number of channels that produced a value
+ */
+auto thermal::refresh() -> std::size_t {
+    std::size_t valid = 0x0;
+
+    for (std::size_t i = 0x0; i < thermal::handles.size(); ++i) {
+        handle & cached = thermal::handles[i];
+        thermal_channel & channel = thermal::inputs[i];
+
+        std::string_view text = cached.input.read();
+        if (!text.empty()) {
+            channel.celsius = static_cast<double>(proc_scanner(text).next_i64()) / 1000.0;
+            channel.valid = true;
+        } else {
+            double value;
+            channel.valid = sensors_get_value(cached.chip, cached.subfeature, &value) == 0x0;
+            if (channel.valid) channel.celsius = value;
+        }
+        valid += channel.valid;
+    }
+    return valid;
+}
+
+/**
+ * \brief All temperature channels in discovery order, values as of the last refresh()
+ * @return reference to the cached channels
+ */
+auto thermal::channels() -> std::vector<thermal_channel> const & {
+    return thermal::inputs;
+}
+
+/**
+ * \brief The hottest package level sensor, or the first valid channel when there is none
+ * @return pointer into channels(), nullptr when nothing is readable
+ */
+auto thermal::package() -> thermal_channel const * {
+    thermal_channel const * best = nullptr;
+    thermal_channel const * fallback = nullptr;
+
+    for (thermal_channel const & channel : thermal::inputs) {
+        if (!channel.valid) continue;
+        if (!fallback) fallback = &channel;
+        if (channel.kind == thermal_kind::package && (!best || channel.celsius > best->celsius)) best = &channel;
+    }
+    return best ? best : fallback;
+}
+
+/**
+ * \brief The hottest per-core sensor
+ * @return pointer into channels(), nullptr when there are no per-core sensors
+ */
+auto thermal::hottest_core() -> thermal_channel const * {
+    thermal_channel const * best = nullptr;
+
+    for (thermal_channel const & channel : thermal::inputs) {
+        if (channel.valid && channel.kind == thermal_kind::core && (!best || channel.celsius > best->celsius)) {
+            best = &channel;
+        }
+    }
+    return best;
+}
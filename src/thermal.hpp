@@ -0,0 +1,64 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_THERMAL_HPP
+#define CUBE_THERMAL_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "procfs.hpp"
+
+struct sensors_chip_name;
+
+enum class thermal_kind { package, core, other };
+
+/**
+ * \brief One temperature input as reported by libsensors
+ */
+struct thermal_channel {
+    std::string chip;
+    std::string label;
+    thermal_kind kind { thermal_kind::other };
+    int core { -0x1 };
+    double celsius { 0.0 };
+    bool valid { false };
+};
+
+/**
+ * \brief Persistent libsensors session
+ *      Chips and temperature inputs are resolved once by init(), refresh() afterwards only
+ *      re-reads the cached inputs: straight from the hwmon sysfs file through an open
+ *      descriptor when possible, through sensors_get_value() otherwise.
+ *      Note that "compute" statements from sensors.conf only apply to the libsensors path
+ */
+class thermal {
+public:
+    static auto init() -> bool;
+    static auto refresh() -> std::size_t;
+    static auto channels() -> std::vector<thermal_channel> const &;
+    static auto package() -> thermal_channel const *;
+    static auto hottest_core() -> thermal_channel const *;
+
+private:
+    struct handle {
+        sensors_chip_name const * chip { nullptr };
+        int subfeature { -0x1 };
+        proc_file input;
+    };
+
+    static inline std::once_flag initialized;
+    static inline bool available { false };
+    static inline std::vector<handle> handles;
+    static inline std::vector<thermal_channel> inputs;
+
+    static auto discover() -> void;
+    static auto shutdown() -> void;
+    static auto classify(thermal_channel & channel) -> void;
+};
+
+#endif //CUBE_THERMAL_HPP
@@ -0,0 +1,243 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <map>
+#include <bit>
+#include <tuple>
+#include <cstdio>
+#include <sched.h>
+#include <algorithm>
+
+#include "cpu.hpp"
+#include "cpuid.hpp"
+#include "procfs.hpp"
+#include "features.hpp"
+#include "topology.hpp"
+
+/**
+ * \brief Low bits of an APIC ID
+ * @param bits Width of the field
+ * @return mask with the lowest bits set
+ */
+static auto low_mask(std::uint32_t bits) -> std::uint32_t {
+    return bits >= 0x20 ? ~0x0U : (0x1U << bits) - 0x1;
+}
+
+auto cpu_topology::core_count() const -> std::size_t {
+    std::size_t count = 0x0;
+    for (topology_package const & package : packages) {
+        for (topology_die const & die : package.dies) count += die.cores.size();
+    }
+    return count;
+}
+
+auto cpu_topology::find(int cpu) const -> logical_cpu const * {
+    for (logical_cpu const & entry : cpus) if (entry.cpu == cpu) return &entry;
+    return nullptr;
+}
+
+auto topology::name(core_type type) -> char const * {
+    switch (type) {
+        case core_type::performance: return "P-core";
+        case core_type::efficiency: return "E-core";
+        default: return "-";
+    }
+}
+
+/**
+ * \brief Reads the x2APIC ID and the field widths of the CPU the calling thread is pinned to
+ *      Leaf 1FH (V2 extended topology, knows dies, modules and tiles) is preferred over 0BH; every
+ *      subleaf's EAX[4:0] is the shift that turns the APIC ID into the ID of the next level up.
+ *      Without either leaf the 8 bit initial APIC ID of leaf 1 is used with the logical processor
+ *      count as the package width, and SMT siblings cannot be told apart from cores
+ * @return shifts of the SMT, die and package levels
+ */
+auto topology::read_shifts() -> topology::shifts {
+    topology::shifts result;
+    std::uint32_t max_leaf = cpuid_snapshot::live(0x0).eax;
+
+    for (std::uint32_t leaf : { 0x1FU, 0xBU }) {
+        if (max_leaf < leaf || cpuid_snapshot::live(leaf).ebx == 0x0) continue;
+
+        std::uint32_t previous = 0x0;
+        bool has_die = false;
+        for (std::uint32_t subleaf = 0x0; subleaf < 0x10; ++subleaf) {
+            cpuid_regs level = cpuid_snapshot::live(leaf, subleaf);
+            std::uint32_t type = (level.ecx >> 0x8) & 0xFF;
+            if (type == 0x0) break;
+
+            std::uint32_t shift = level.eax & 0x1F;
+            if (type == 0x1) result.smt = shift;
+            if (type == 0x5) {
+                result.die = previous;
+                has_die = true;
+            }
+            previous = shift;
+            result.apic = level.edx;
+        }
+        result.package = previous;
+        if (!has_die) result.die = result.package;
+        result.source = (leaf == 0x1F) ? "1FH" : "0BH";
+        return result;
+    }
+
+    cpuid_regs features = cpuid_snapshot::live(0x1);
+    std::uint32_t logical = ((features.edx >> 0x1C) & 0x1) ? (features.ebx >> 0x10) & 0xFF : 0x1;
+    result.apic = features.ebx >> 0x18;
+    result.package = static_cast<std::uint32_t>(std::bit_width(std::max(logical, 0x1U) - 0x1));
+    result.die = result.package;
+    result.source = "01H";
+    return result;
+}
+
+/**
+ * \brief Groups the logical CPUs into packages, dies and cores
+ * @param layout Topology with cpus filled in
+ */
+auto topology::build_tree(cpu_topology & layout) -> void {
+    std::sort(layout.cpus.begin(), layout.cpus.end(), [](logical_cpu const & a, logical_cpu const & b) {
+        return std::tie(a.package, a.die, a.core, a.thread, a.cpu) < std::tie(b.package, b.die, b.core, b.thread, b.cpu);
+    });
+
+    for (logical_cpu const & entry : layout.cpus) {
+        if (layout.packages.empty() || layout.packages.back().id != entry.package) {
+            layout.packages.push_back({ entry.package, { } });
+        }
+        std::vector<topology_die> & dies = layout.packages.back().dies;
+        if (dies.empty() || dies.back().id != entry.die) dies.push_back({ entry.die, { } });
+
+        std::vector<topology_core> & cores = dies.back().cores;
+        if (cores.empty() || cores.back().id != entry.core) cores.push_back({ entry.core, entry.type, { } });
+        cores.back().threads.push_back(entry.cpu);
+    }
+}
+
+/**
+ * \brief Compares the CPUID derived grouping with the kernel's view in /sys/devices/system/cpu/cpuN/topology
+ *      Packages and dies are compared as partitions (the numbering may differ), SMT siblings as CPU lists
+ * @param layout Topology to annotate with mismatches
+ */
+auto topology::cross_check(cpu_topology & layout) -> void {
+    auto read_number = [](int cpu, char const * file) -> long long {
+        std::string path = std::string(CPU_SYSFS) + "/cpu" + std::to_string(cpu) + "/topology/" + file;
+        proc_file source(path.c_str(), 0x40);
+        if (!source.is_open()) return -0x1;
+        std::string_view text = source.read();
+        return text.empty() ? -0x1 : proc_scanner(text).next_i64();
+    };
+
+    auto compare = [&layout](char const * what, std::vector<std::pair<std::uint64_t, long long>> const & pairs) {
+        std::map<std::uint64_t, long long> forward;
+        std::map<long long, std::uint64_t> backward;
+        for (auto const & [ours, theirs] : pairs) {
+            if (theirs < 0x0) continue;
+            auto [f, f_new] = forward.emplace(ours, theirs);
+            auto [b, b_new] = backward.emplace(theirs, ours);
+            if ((!f_new && f->second != theirs) || (!b_new && b->second != ours)) {
+                layout.mismatches.push_back(std::string(what) + " grouping differs from sysfs");
+                return;
+            }
+        }
+    };
+
+    std::vector<std::pair<std::uint64_t, long long>> packages, dies;
+    for (logical_cpu const & entry : layout.cpus) {
+        long long package = read_number(entry.cpu, "physical_package_id");
+        long long die = read_number(entry.cpu, "die_id");
+        packages.emplace_back(entry.package, package);
+        if (package >= 0x0 && die >= 0x0) {
+            dies.emplace_back((static_cast<std::uint64_t>(entry.package) << 0x20) | entry.die, (package << 0x20) | die);
+        }
+
+        std::string path = std::string(CPU_SYSFS) + "/cpu" + std::to_string(entry.cpu) + "/topology/thread_siblings_list";
+        proc_file siblings_file(path.c_str(), 0x100);
+        if (!siblings_file.is_open()) continue;
+        std::vector<int> siblings = proc_scanner(siblings_file.read()).next_cpu_list();
+
+        std::vector<int> ours;
+        for (logical_cpu const & other : layout.cpus) {
+            if (other.package == entry.package && other.die == entry.die && other.core == entry.core) ours.push_back(other.cpu);
+        }
+        std::sort(ours.begin(), ours.end());
+        std::erase_if(siblings, [&layout](int id) { return layout.find(id) == nullptr; });
+
+        if (ours != siblings) {
+            layout.mismatches.push_back("cpu" + std::to_string(entry.cpu) + ": SMT siblings " + format_cpu_list(ours) +
+                                        " from CPUID, " + format_cpu_list(siblings) + " from sysfs");
+        }
+    }
+    compare("package", packages);
+    compare("die", dies);
+}
+
+/**
+ * \brief Pins to every online CPU in turn and decodes its APIC ID, then cross-checks against sysfs
+ *      Hybrid parts report the core type per CPU in leaf 1AH EAX[31:24] (20H Atom, 40H Core)
+ * @return topology of the online CPUs; the calling thread's affinity is restored afterwards
+ */
+auto topology::enumerate() -> cpu_topology {
+    cpu_topology layout;
+    cpu_set_t original;
+    if (sched_getaffinity(0x0, sizeof(original), &original) != 0x0) return layout;
+
+    bool hybrid = cpu_features::supported().has(feature::hybrid) && cpuid_snapshot::get().max_leaf() >= 0x1A;
+
+    for (int id : cpu::online_cpus()) {
+        if (!cpu::pin_thread(id)) continue;
+
+        topology::shifts fields = topology::read_shifts();
+        logical_cpu entry;
+        entry.cpu = id;
+        entry.apic = fields.apic;
+        entry.package = fields.package >= 0x20 ? 0x0 : fields.apic >> fields.package;
+        entry.die = (fields.die >= 0x20 ? 0x0 : fields.apic >> fields.die) & low_mask(fields.package - fields.die);
+        entry.core = (fields.apic >> fields.smt) & low_mask(fields.die - fields.smt);
+        entry.thread = fields.apic & low_mask(fields.smt);
+
+        if (hybrid) {
+            std::uint32_t type = cpuid_snapshot::live(0x1A).eax >> 0x18;
+            entry.type = (type == 0x40) ? core_type::performance : (type == 0x20) ? core_type::efficiency : core_type::unknown;
+        }
+        layout.source = fields.source;
+        layout.cpus.push_back(entry);
+    }
+    sched_setaffinity(0x0, sizeof(original), &original);
+
+    topology::build_tree(layout);
+    topology::cross_check(layout);
+    return layout;
+}
+
+/**
+ * \brief Prints the tree, the per-CPU table and the result of the sysfs cross-check
+ * @param layout Output of enumerate()
+ */
+auto topology::print(cpu_topology const & layout) -> void {
+    std::size_t dies = 0x0;
+    for (topology_package const & package : layout.packages) dies += package.dies.size();
+
+    std::printf("Topology from CPUID leaf %s: %zu package(s), %zu die(s), %zu core(s), %zu thread(s)\n",
+                layout.source, layout.packages.size(), dies, layout.core_count(), layout.cpus.size());
+
+    for (topology_package const & package : layout.packages) {
+        std::printf("Package %u\n", package.id);
+        for (topology_die const & die : package.dies) {
+            std::printf("  Die %u\n", die.id);
+            for (topology_core const & core : die.cores) {
+                std::printf("    Core %-4u %-7s CPUs %s\n", core.id, topology::name(core.type), format_cpu_list(core.threads).c_str());
+            }
+        }
+    }
+
+    std::printf("\n%5s %11s %8s %5s %5s %7s %s\n", "CPU", "x2APIC", "Package", "Die", "Core", "Thread", "Type");
+    for (logical_cpu const & entry : layout.cpus) {
+        std::printf("%5d  0x%08x %8u %5u %5u %7u %s\n", entry.cpu, entry.apic, entry.package, entry.die,
+                    entry.core, entry.thread, topology::name(entry.type));
+    }
+
+    if (layout.mismatches.empty()) std::printf("\nsysfs agrees with CPUID\n");
+    for (std::string const & mismatch : layout.mismatches) std::printf("\nsysfs mismatch: %s", mismatch.c_str());
+    if (!layout.mismatches.empty()) std::printf("\n");
+}
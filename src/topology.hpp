@@ -0,0 +1,86 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_TOPOLOGY_HPP
+#define CUBE_TOPOLOGY_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define CPU_SYSFS "/sys/devices/system/cpu"
+
+/**
+ * \brief Hybrid core type from CPUID leaf 1AH
+ */
+enum class core_type : std::uint8_t { unknown, performance, efficiency };
+
+/**
+ * \brief One online logical CPU, IDs are decoded from its x2APIC ID
+ *      package is system wide, die is relative to the package, core to the die, thread to the core
+ */
+struct logical_cpu {
+    int cpu { -0x1 };
+    std::uint32_t apic { 0x0 };
+    std::uint32_t package { 0x0 };
+    std::uint32_t die { 0x0 };
+    std::uint32_t core { 0x0 };
+    std::uint32_t thread { 0x0 };
+    core_type type { core_type::unknown };
+};
+
+struct topology_core {
+    std::uint32_t id { 0x0 };
+    core_type type { core_type::unknown };
+    std::vector<int> threads;
+};
+
+struct topology_die {
+    std::uint32_t id { 0x0 };
+    std::vector<topology_core> cores;
+};
+
+struct topology_package {
+    std::uint32_t id { 0x0 };
+    std::vector<topology_die> dies;
+};
+
+/**
+ * \brief Package -> die -> core -> SMT thread tree of the online CPUs
+ *      source names the CPUID leaf the APIC ID fields came from (1FH, 0BH or 01H);
+ *      mismatches lists every disagreement with /sys/devices/system/cpu
+ */
+struct cpu_topology {
+    std::vector<logical_cpu> cpus;
+    std::vector<topology_package> packages;
+    std::vector<std::string> mismatches;
+    char const * source { "" };
+
+    [[nodiscard]] auto core_count() const -> std::size_t;
+    [[nodiscard]] auto find(int cpu) const -> logical_cpu const *;
+};
+
+class topology {
+public:
+    static auto enumerate() -> cpu_topology;
+    static auto print(cpu_topology const & layout) -> void;
+    static auto name(core_type type) -> char const *;
+
+private:
+    struct shifts {
+        std::uint32_t apic { 0x0 };
+        std::uint32_t smt { 0x0 };
+        std::uint32_t die { 0x0 };
+        std::uint32_t package { 0x0 };
+        char const * source { "" };
+    };
+
+    static auto read_shifts() -> shifts;
+    static auto build_tree(cpu_topology & layout) -> void;
+    static auto cross_check(cpu_topology & layout) -> void;
+};
+
+#endif //CUBE_TOPOLOGY_HPP
@@ -0,0 +1,86 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "cpu.hpp"
+#include "tsc_clock.hpp"
+
+namespace cube {
+    /**
+     * \brief Runs the calibration exactly once and caches the result for the whole process
+     * @return calibration data shared by every tsc_clock call
+     */
+    auto tsc_clock::calibration() -> tsc_calibration const & {
+        static tsc_calibration const cached = [] {
+            tsc_calibration result;
+            result.invariant = cpu::supports_invariantTSC();
+
+            double tick;
+            if (cpu::extract_leaf_15H(&tick)) {
+                result.source = tsc_source::leaf_15h;
+            } else if (cpu::read_HW_tick_from_name(&tick)) {
+                result.source = tsc_source::brand_string;
+            } else {
+                tick = cpu::measure_TSC_tick();
+                result.source = tsc_source::measured;
+            }
+
+            result.hz = 1.0 / tick;
+            result.mult = static_cast<std::uint64_t>(std::llround(std::ldexp(1.e9 / result.hz, static_cast<int>(result.shift))));
+            result.granularity = cpu::measure_clock_granularity();
+            return result;
+        }();
+        return cached;
+    }
+
+    /**
+     * \brief Human readable name of a calibration source
+     * @param source Calibration source
+     * @return static string
+     */
+    auto tsc_clock::source_name(tsc_source source) -> char const * {
+        switch (source) {
+            case tsc_source::leaf_15h: return "leaf 15H";
+            case tsc_source::brand_string: return "model name string";
+            case tsc_source::measured: return "measurement";
+        }
+        return "unknown";
+    }
+
+    /**
+     * \brief Prints the calibration and a sanity check against std::chrono::steady_clock
+     * @return 0x0 when the TSC is invariant, 0x1 otherwise (usable as exit status)
+     */
+    auto tsc_clock::print() -> int {
+        tsc_calibration const & c = tsc_clock::calibration();
+        double tick = 1.0 / c.hz;
+
+        std::printf("Invariant TSC: %s\n", c.invariant ? "True" : "False");
+        if (!c.invariant) std::printf("*** Without invariant TSC rdtsc is not a useful timer for wall clock time\n");
+
+        std::printf("From %s frequency %sz => %s\n",
+                    tsc_clock::source_name(c.source),
+                    cpu::format_SI(c.hz, 0x9, 'H').c_str(),
+                    cpu::format_SI(tick, 0x9, 's').c_str());
+
+        double measured = cpu::measure_TSC_tick();
+        std::printf("Sanity check against std::chrono::steady_clock gives frequency %sz => %s\n",
+                    cpu::format_SI(1. / measured, 0x9, 'H').c_str(),
+                    cpu::format_SI(measured, 0x9, 's').c_str());
+
+        double granularity = tick * static_cast<double>(c.granularity);
+        std::printf("Measured granularity = %llu tick%s => %sz, %s\n",
+                    static_cast<unsigned long long>(c.granularity), c.granularity != 0x1 ? "s" : "",
+                    cpu::format_SI(1. / granularity, 0x9, 'H').c_str(),
+                    cpu::format_SI(granularity, 0x9, 's').c_str());
+
+        std::printf("Conversion: ns = (ticks * %llu) >> %u\n",
+                    static_cast<unsigned long long>(c.mult), c.shift);
+        return c.invariant ? 0x0 : 0x1;
+    }
+}
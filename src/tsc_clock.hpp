@@ -0,0 +1,83 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_TSC_CLOCK_HPP
+#define CUBE_TSC_CLOCK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <x86intrin.h>
+
+namespace cube {
+    enum class tsc_source { leaf_15h, brand_string, measured };
+
+    /**
+     * \brief Result of the one-time TSC calibration
+     *      Nanoseconds are derived as (ticks * mult) >> shift, so a conversion costs one
+     *      128-bit multiply instead of a double division
+     */
+    struct tsc_calibration {
+        double hz { 0.0 };
+        tsc_source source { tsc_source::measured };
+        bool invariant { false };
+        std::uint64_t mult { 0x0 };
+        std::uint32_t shift { 0x20 };
+        std::uint64_t granularity { 0x0 };
+    };
+
+    /**
+     * \brief std::chrono clock on top of the time stamp counter
+     *      Calibration precedence: CPUID leaf 15H, then the frequency in the brand string,
+     *      then a measurement against steady_clock. The clock is only truly steady across
+     *      cores when calibration().invariant is true
+     */
+    class tsc_clock {
+    public:
+        using rep = std::int64_t;
+        using period = std::nano;
+        using duration = std::chrono::duration<rep, period>;
+        using time_point = std::chrono::time_point<tsc_clock>;
+        static constexpr bool is_steady = true;
+
+        static auto calibration() -> tsc_calibration const &;
+        static auto source_name(tsc_source source) -> char const *;
+        static auto print() -> int;
+
+        /**
+         * \brief Plain rdtsc, may be reordered with surrounding instructions
+         */
+        static auto ticks() noexcept -> std::uint64_t {
+            return __rdtsc();
+        }
+
+        /**
+         * \brief rdtscp waits for all earlier instructions, the lfence keeps later ones behind it
+         */
+        static auto ticks_serialized() noexcept -> std::uint64_t {
+            unsigned int aux;
+            std::uint64_t value = __rdtscp(&aux);
+            _mm_lfence();
+            return value;
+        }
+
+        static auto to_duration(std::uint64_t ticks) noexcept -> duration {
+            static tsc_calibration const & cached = tsc_clock::calibration();
+            return duration(static_cast<rep>((static_cast<unsigned __int128>(ticks) * cached.mult) >> cached.shift));
+        }
+
+        static auto now() noexcept -> time_point {
+            return time_point(tsc_clock::to_duration(tsc_clock::ticks_serialized()));
+        }
+
+        static auto now_unserialized() noexcept -> time_point {
+            return time_point(tsc_clock::to_duration(tsc_clock::ticks()));
+        }
+    };
+
+    static_assert(std::chrono::is_clock_v<tsc_clock>);
+}
+
+#endif //CUBE_TSC_CLOCK_HPP
@@ -0,0 +1,198 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#include <cmath>
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <thread>
+#include <sched.h>
+#include <algorithm>
+#include <x86intrin.h>
+
+#include "cpu.hpp"
+#include "tsc_sync.hpp"
+#include "tsc_clock.hpp"
+
+namespace {
+    struct alignas(0x40) sync_line {
+        std::atomic<std::uint64_t> turn { 0x0 };
+        std::atomic<std::uint64_t> remote { 0x0 };
+        char padding[0x40 - 0x2 * sizeof(std::atomic<std::uint64_t>)];
+    };
+
+    auto to_ns(double ticks) -> double {
+        return ticks * 1e9 / cube::tsc_clock::calibration().hz;
+    }
+}
+
+/**
+ * \brief rdtsc between two lfences, so it can neither start before the preceding load nor drift past the following store
+ */
+auto tsc_sync::fenced_read() noexcept -> std::uint64_t {
+    _mm_lfence();
+    std::uint64_t value = cpu::read_cycle_count();
+    _mm_lfence();
+    return value;
+}
+
+/**
+ * \brief Counts how often consecutive readings on one CPU went backwards
+ * @param cpu CPU to pin to
+ * @param reads Number of readings
+ * @return skew entry with backwards filled in, measured is false when the CPU could not be pinned
+ */
+auto tsc_sync::local(int cpu, std::size_t reads) -> tsc_skew {
+    tsc_skew skew;
+    skew.cpu = cpu;
+
+    std::thread probe([&skew, cpu, reads] {
+        if (!cpu::pin_thread(cpu)) return;
+        std::uint64_t previous = tsc_sync::fenced_read();
+        for (std::size_t i = 0x0; i < reads; ++i) {
+            std::uint64_t current = tsc_sync::fenced_read();
+            skew.backwards += current < previous;
+            previous = current;
+        }
+        skew.measured = true;
+    });
+    probe.join();
+    return skew;
+}
+
+/**
+ * \brief Runs the ping-pong between the reference and one remote CPU
+ *      Per round the reference reads a, hands over the line, the remote reads b and hands it back, the reference
+ *      reads c. With o the remote offset, a < b - o < c, so every round narrows o to (b - c, b - a); the first
+ *      rounds only warm the line up and are not counted
+ * @param reference CPU the offsets are relative to
+ * @param remote CPU to check
+ * @param options Number of rounds
+ * @return offset bounds and violations, measured is false when a CPU could not be pinned
+ */
+auto tsc_sync::measure(int reference, int remote, tsc_sync_options const & options) -> tsc_skew {
+    constexpr std::size_t warmup = 0x40;
+    sync_line line;
+    std::atomic<int> ready { 0x0 };
+    std::uint64_t const rounds = options.rounds + warmup;
+
+    std::thread echo([&line, &ready, remote, rounds] {
+        if (!cpu::pin_thread(remote)) {
+            ready.store(-0x1, std::memory_order_release);
+            return;
+        }
+        ready.store(0x1, std::memory_order_release);
+        for (std::uint64_t expected = 0x1; expected < 0x2 * rounds; expected += 0x2) {
+            while (line.turn.load(std::memory_order_acquire) != expected) { }
+            line.remote.store(tsc_sync::fenced_read(), std::memory_order_relaxed);
+            line.turn.store(expected + 0x1, std::memory_order_release);
+        }
+    });
+
+    cpu_set_t original;
+    sched_getaffinity(0x0, sizeof(original), &original);
+    bool pinned = cpu::pin_thread(reference);
+
+    int state;
+    while ((state = ready.load(std::memory_order_acquire)) == 0x0) { }
+
+    tsc_skew skew;
+    skew.cpu = remote;
+    skew.lower = std::numeric_limits<std::int64_t>::min();
+    skew.upper = std::numeric_limits<std::int64_t>::max();
+
+    if (state > 0x0) {
+        for (std::uint64_t round = 0x0; round < rounds; ++round) {
+            std::uint64_t before = tsc_sync::fenced_read();
+            line.turn.store(0x2 * round + 0x1, std::memory_order_release);
+            while (line.turn.load(std::memory_order_acquire) != 0x2 * round + 0x2) { }
+            std::uint64_t after = tsc_sync::fenced_read();
+            std::uint64_t seen = line.remote.load(std::memory_order_relaxed);
+            if (round < warmup) continue;
+
+            skew.lower = std::max(skew.lower, static_cast<std::int64_t>(seen - after));
+            skew.upper = std::min(skew.upper, static_cast<std::int64_t>(seen - before));
+            skew.violations += seen < before || seen > after;
+        }
+        skew.measured = pinned;
+    } else {
+        skew.lower = skew.upper = 0x0;
+    }
+
+    echo.join();
+    sched_setaffinity(0x0, sizeof(original), &original);
+    return skew;
+}
+
+/**
+ * \brief Checks every online CPU against the first CPU of the topology
+ * @param layout Topology from topology::enumerate(), its order is the report order
+ * @param options Rounds and tolerance
+ * @return report with pass set, false as well when any CPU could not be measured
+ */
+auto tsc_sync::run(cpu_topology const & layout, tsc_sync_options const & options) -> tsc_sync_report {
+    tsc_sync_report report;
+    report.invariant = cube::tsc_clock::calibration().invariant;
+    if (layout.cpus.empty()) return report;
+
+    report.reference = layout.cpus.front().cpu;
+    report.pass = report.invariant;
+
+    for (logical_cpu const & entry : layout.cpus) {
+        tsc_skew local = tsc_sync::local(entry.cpu, options.rounds * 0x10);
+        tsc_skew skew = entry.cpu == report.reference ? local : tsc_sync::measure(report.reference, entry.cpu, options);
+        skew.backwards = local.backwards;
+        skew.measured = skew.measured && local.measured;
+
+        if (!skew.measured || skew.backwards || to_ns(static_cast<double>(skew.proven())) > options.tolerance_ns) report.pass = false;
+        report.cpus.push_back(skew);
+    }
+    return report;
+}
+
+/**
+ * \brief Prints the offset of every CPU and the verdict
+ *      Offsets are the midpoint of the bounds, ± is half their width (about half a line round trip);
+ *      "proven" is the part of the skew no ordering of the rounds can explain away
+ * @param layout Topology used for the run
+ * @param report Output of run()
+ * @param options Tolerance the verdict used
+ * @return 0x0 when the TSCs are invariant and every CPU is synchronized within the tolerance, 0x1 otherwise
+ */
+auto tsc_sync::print(cpu_topology const & layout, tsc_sync_report const & report, tsc_sync_options const & options) -> int {
+    cube::tsc_calibration const & clock = cube::tsc_clock::calibration();
+    std::printf("TSC %.3f GHz, %s, reference CPU %d, %zu rounds per CPU, tolerance %.0f ns\n", clock.hz / 1e9,
+                report.invariant ? "invariant" : "NOT invariant", report.reference, options.rounds, options.tolerance_ns);
+    std::printf("%5s %4s %5s %12s %8s %12s %11s %10s\n", "CPU", "Pkg", "Core", "Offset ns", "+/- ns", "Proven ns", "Violations", "Backwards");
+
+    double worst_offset = 0.0, worst_proven = 0.0;
+    std::uint64_t violations = 0x0, backwards = 0x0;
+    std::size_t skipped = 0x0;
+
+    for (tsc_skew const & skew : report.cpus) {
+        logical_cpu const * entry = layout.find(skew.cpu);
+        if (!skew.measured) {
+            std::printf("%5d %4u %5u %12s\n", skew.cpu, entry->package, entry->core, "not pinnable");
+            ++skipped;
+            continue;
+        }
+
+        double offset = to_ns(skew.offset()), proven = to_ns(static_cast<double>(skew.proven()));
+        worst_offset = std::max(worst_offset, std::abs(offset));
+        worst_proven = std::max(worst_proven, proven);
+        violations += skew.violations;
+        backwards += skew.backwards;
+        std::printf("%5d %4u %5u %12.1f %8.1f %12.1f %11llu %10llu\n", skew.cpu, entry->package, entry->core, offset,
+                    to_ns(skew.uncertainty()), proven, static_cast<unsigned long long>(skew.violations),
+                    static_cast<unsigned long long>(skew.backwards));
+    }
+
+    std::printf("\nMax offset %.1f ns, max proven skew %.1f ns, %llu causality violations, %llu backward steps",
+                worst_offset, worst_proven, static_cast<unsigned long long>(violations), static_cast<unsigned long long>(backwards));
+    if (skipped) std::printf(", %zu CPUs not checked (they fail the run)", skipped);
+    std::printf("\n%s\n", report.pass ? "PASS" : "FAIL");
+    if (report.cpus.size() < 0x2) std::printf("only one CPU is online, nothing to compare across CPUs\n");
+    return report.pass ? 0x0 : 0x1;
+}
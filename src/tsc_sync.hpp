@@ -0,0 +1,75 @@
+/*
+ * (C)opyright 2022 Ramiz Abbasov <ramizna@code.edu.az>
+ * See LICENSE file for license details
+ */
+
+#pragma once
+#ifndef CUBE_TSC_SYNC_HPP
+#define CUBE_TSC_SYNC_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "topology.hpp"
+
+/**
+ * \brief Rounds per checked CPU and the proven skew a CPU may show and still pass
+ *      tolerance_ns defaults to 0: proven() already discounts the line round trip, so any non-zero proven skew
+ *      is a real offset between the counters. Raise it only to accept a known, small offset
+ */
+struct tsc_sync_options {
+    std::size_t rounds { 0x2710 };
+    double tolerance_ns { 0.0 };
+};
+
+/**
+ * \brief TSC offset of one CPU relative to the reference CPU, in ticks
+ *      Every round bounds the offset from both sides: lower = max(remote - reference after),
+ *      upper = min(remote - reference before). violations counts rounds where the remote reading was not
+ *      between the two reference readings, backwards counts local reads that went back in time
+ */
+struct tsc_skew {
+    int cpu { -0x1 };
+    std::int64_t lower { 0x0 };
+    std::int64_t upper { 0x0 };
+    std::uint64_t violations { 0x0 };
+    std::uint64_t backwards { 0x0 };
+    bool measured { false };
+
+    [[nodiscard]] auto offset() const -> double { return (static_cast<double>(lower) + static_cast<double>(upper)) / 2.0; }
+    [[nodiscard]] auto uncertainty() const -> double { return (static_cast<double>(upper) - static_cast<double>(lower)) / 2.0; }
+
+    /**
+     * \brief Smallest skew consistent with every round, 0 when the bounds contain 0
+     */
+    [[nodiscard]] auto proven() const -> std::int64_t { return lower > 0x0 ? lower : upper < 0x0 ? -upper : 0x0; }
+};
+
+/**
+ * \brief Outcome of a run, CPUs in topology order; the reference CPU has offset 0 and only the local check
+ *      pass requires an invariant TSC and every CPU measured: a CPU that could not be pinned fails the run
+ */
+struct tsc_sync_report {
+    int reference { -0x1 };
+    std::vector<tsc_skew> cpus;
+    bool invariant { false };
+    bool pass { false };
+};
+
+/**
+ * \brief Cross-CPU TSC synchronization check
+ *      A thread on the reference CPU and one on the checked CPU bounce a cache line; each side takes a
+ *      fenced cpu::read_cycle_count() around its turn, so in reference time the remote reading must fall
+ *      between the two reference readings. A reading outside is a causality violation: time observed on one
+ *      CPU went backwards when moving to the other
+ */
+class tsc_sync {
+public:
+    static auto fenced_read() noexcept -> std::uint64_t;
+    static auto measure(int reference, int remote, tsc_sync_options const & options) -> tsc_skew;
+    static auto local(int cpu, std::size_t reads) -> tsc_skew;
+    static auto run(cpu_topology const & layout, tsc_sync_options const & options) -> tsc_sync_report;
+    static auto print(cpu_topology const & layout, tsc_sync_report const & report, tsc_sync_options const & options) -> int;
+};
+
+#endif //CUBE_TSC_SYNC_HPP
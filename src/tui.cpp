@@ -3,63 +3,453 @@
  * See LICENSE file for license details
  */
 
-#include <string>
-#include <thread>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
 #include <ncurses.h>
 
-#include "cpu.hpp"
 #include "tui.hpp"
+#include "perf.hpp"
+#include "cgroup.hpp"
+#include "memory.hpp"
+#include "sampler.hpp"
+#include "thermal.hpp"
+#include "recorder.hpp"
 
 /**
- * \brief Prints the "|" according to percentage argument
+ * \brief Draws "[|||||      42.0%]" straight into the cell buffer, the percentage right-aligned inside the bar
+ * @param out Cell buffer
+ * @param row Line
+ * @param col First column (the "[")
+ * @param width Total width including the brackets
  * @param percent Percentage value
- * @return final std::string as "|"
+ * @param pair Color pair of the bar
  */
-auto tui::progress_bar(const std::string& percent) -> std::string {
-    std::string result = "CPU [";
-    int _size = 0x32;
+auto tui::progress_bar(screen_buffer & out, int row, int col, int width, float percent, short pair) -> void {
+    int inner = width - 0x2;
+    if (inner < 0x1) return;
 
-    int boundaries = static_cast<int>((std::stof(percent) / 0x64) * static_cast<float>(_size));
+    float clamped = std::clamp(percent, 0.0f, 100.0f);
+    int filled = static_cast<int>(clamped / 100.0f * static_cast<float>(inner) + 0.5f);
 
-    for (size_t i = 0x0; i < _size; ++i){
-        if (i <= boundaries) result += "|";
-        else result += " ";
+    out.put(row, col, L'[', A_BOLD);
+    out.fill(row, col + 0x1, filled, L'|', A_BOLD, pair);
+    out.put(row, col + inner + 0x1, L']', A_BOLD);
+
+    char label[0x10];
+    int length = std::snprintf(label, sizeof(label), "%.1f%%", static_cast<double>(clamped));
+    if (length > 0x0 && length <= inner) out.print(row, col + inner + 0x1 - length, label, A_BOLD);
+}
+
+/**
+ * \brief Composes the whole frame from the latest collector snapshots; nothing here blocks or reads /proc
+ * @param out Cell buffer, already cleared
+ */
+auto tui::write_console(screen_buffer & out) -> void {
+    out.print(0x1, 0x3, "CPU", A_BOLD, 0x1);
+    int width = std::min(0x34, out.cols() - 0x14);
+    tui::progress_bar(out, 0x1, 0x7, width, sampler::aggregate(), 0x1);
+
+    thermal_channel const * channel = thermal::package();
+    if (channel) out.printf(0x1, 0x8 + width, A_BOLD, 0x3, "%.1f °C", channel->celsius);
+    else out.print(0x1, 0x8 + width, "N/A", A_BOLD, 0x3);
+
+    int row = tui::write_counters(out, 0x2);
+    row = tui::write_memory(out, row);
+    row = tui::write_cgroup(out, row);
+    tui::write_grid(out, row);
+}
+
+/**
+ * \brief Prints the system-wide IPC and LLC/branch MPKI under the utilization bar, the per-CPU IPC sits in the grid
+ *      When the counters cannot be opened the reason is printed once instead
+ * @param out Cell buffer
+ * @param row First row to use
+ * @return first row after the counters
+ */
+auto tui::write_counters(screen_buffer & out, int row) -> int {
+    if (!perf::init()) {
+        out.printf(row, 0x3, A_NORMAL, 0x2, "PMU unavailable: %s", perf::status().c_str());
+        return row + 0x1;
+    }
+
+    perf_sample const & sample = perf::total();
+    if (!sample.valid) out.print(row, 0x3, "IPC    -", A_NORMAL, 0x2);
+    else out.printf(row, 0x3, A_NORMAL, 0x2, "IPC %4.2f  LLC MPKI %6.2f  BR MPKI %6.2f", sample.ipc(),
+                    sample.mpki(perf_counter::llc_misses), sample.mpki(perf_counter::branch_misses));
+    return row + 0x1;
+}
+
+/**
+ * \brief Prints memory usage with the reclaim and swap rates, so reclaim storms show up next to the CPUs they stall
+ * @param out Cell buffer
+ * @param row First row to use
+ * @return first row after the memory line
+ */
+auto tui::write_memory(screen_buffer & out, int row) -> int {
+    if (!memory::init()) return row;
+
+    memory_info const & info = memory::info();
+    memory_rates const & rates = memory::rates();
+    constexpr double gib = 1024.0 * 1024.0 * 1024.0;
+    out.printf(row, 0x3, A_NORMAL, 0x2, "MEM %.1f/%.1f GiB  swap %.1f GiB  flt %.0f/s  maj %.0f/s  scan %.0f/s  si/so %.0f/%.0f",
+               info.used() / gib, info.total / gib, (info.swap_total - std::min(info.swap_free, info.swap_total)) / gib,
+               rates[vmstat_counter::page_faults], rates[vmstat_counter::major_faults],
+               rates[vmstat_counter::scan_kswapd] + rates[vmstat_counter::scan_direct],
+               rates[vmstat_counter::swap_in], rates[vmstat_counter::swap_out]);
+    return row + 0x1;
+}
+
+/**
+ * \brief Inside a limited cgroup (a container), usage against the quota, CFS throttling and memory against memory.max;
+ *      the host-wide figures above overstate what this group can get. Throttling turns the line red
+ * @param out Cell buffer
+ * @param row First row to use
+ * @return first row after the cgroup line, row when the group has no limits
+ */
+auto tui::write_cgroup(screen_buffer & out, int row) -> int {
+    if (!cgroup::init() || !cgroup::self().limited()) return row;
+
+    cgroup_stats const & self = cgroup::self();
+    constexpr double gib = 1024.0 * 1024.0 * 1024.0;
+    int col = 0x3 + out.printf(row, 0x3, A_NORMAL, 0x2, "CG  %.2f CPUs = %.0f%% of %s  ", self.cores_used, self.quota_percent,
+                                self.quota_cores() > 0.0 ? "quota" : "cpuset");
+    col += out.printf(row, col, self.throttled_percent > 0.0 ? A_BOLD : A_NORMAL, self.throttled_percent > 0.0 ? 0x3 : 0x2,
+                      "throttled %.0f%% %.0f ms/s  ", self.throttled_percent, self.throttled_ms_per_second);
+    if (self.memory_max != cgroup_stats::unlimited) {
+        out.printf(row, col, A_NORMAL, 0x2, "mem %.1f/%.1f GiB", static_cast<double>(self.memory_current) / gib,
+                   static_cast<double>(self.memory_max) / gib);
+    }
+    return row + 0x1;
+}
+
+/**
+ * \brief Fits the per-CPU entries into the terminal
+ *      A cell is "label [bar] sparkline ipc"; as many columns as the minimum cell width allows, the spare width
+ *      goes half to the bar and half to the sparkline. With collapsing on and more entries than rows, consecutive
+ *      CPUs are merged into groups until everything fits; otherwise the grid scrolls
+ * @param cpus Number of CPUs
+ * @param rows Lines available
+ * @param cols Columns available
+ * @param ipc Whether cells reserve room for the IPC column
+ * @return grid geometry
+ */
+auto tui::layout(std::size_t cpus, int rows, int cols, bool ipc) -> core_grid {
+    core_grid grid;
+    int digits = 0x1;
+    for (std::size_t last = cpus > 0x1 ? cpus - 0x1 : 0x0; last >= 0xA; last /= 0xA) ++digits;
+    grid.ipc_width = ipc ? 0x5 : 0x0;
+
+    auto fit = [&](std::size_t group) {
+        grid.group = group;
+        grid.entries = (cpus + group - 0x1) / group;
+        grid.label_width = group == 0x1 ? digits : digits * 0x2 + 0x1;
+        int minimum = grid.label_width + 0x1 + 0xC + 0x1 + 0x8 + grid.ipc_width + 0x2;
+        grid.columns = std::clamp(cols / minimum, 0x1, static_cast<int>(std::max<std::size_t>(grid.entries, 0x1)));
+        grid.total_rows = static_cast<int>((grid.entries + static_cast<std::size_t>(grid.columns) - 0x1) / static_cast<std::size_t>(grid.columns));
+
+        grid.cell_width = cols / grid.columns;
+        int spare = std::max(grid.cell_width - minimum, 0x0);
+        grid.bar_width = 0xC + spare / 0x2;
+        grid.spark_width = std::min(0x8 + spare - spare / 0x2, 0x3C);
+    };
+
+    fit(0x1);
+    if (tui::collapse && rows > 0x0) {
+        while (grid.total_rows > rows && grid.group < cpus) fit(grid.group + std::max<std::size_t>(grid.group / 0x4, 0x1));
     }
 
-    result += percent.substr(0x0, 0x4) + "%]";
-    return result;
+    grid.rows = std::min(rows, grid.total_rows);
+    grid.first_row = std::clamp(tui::scroll, 0x0, std::max(grid.total_rows - grid.rows, 0x0));
+    return grid;
 }
 
 /**
- * \brief Does the writing part to console
- * @param win Takes WINDOW object instance
+ * \brief History as block elements (one sample per cell) or braille (two samples per cell, four dot rows each)
+ *      Outside a UTF-8 locale both fall back to an ASCII ramp
+ * @param newest_first Percentages, index 0 is the newest; drawn right-aligned with the newest at the right edge
+ * @param count Number of samples available
  */
-auto tui::write_console(WINDOW * win) -> void {
-    wattron(win, A_BOLD);
-    wattron(win, COLOR_PAIR(0x1));
-    mvwprintw(win, 0x1, 0x3, "%s", (tui::progress_bar(cpu::cpu_percentage())).c_str());
-    wattron(win, COLOR_PAIR(0x3));
-    mvwprintw(win, 0x1, 0xF, "%s", (cpu::print_thermal_state()).c_str());
+auto tui::sparkline(screen_buffer & out, int row, int col, int width, float const * newest_first, std::size_t count) -> void {
+    static wchar_t const blocks[0x9] { L' ', L'\u2581', L'\u2582', L'\u2583', L'\u2584', L'\u2585', L'\u2586', L'\u2587', L'\u2588' };
+    static wchar_t const ascii[0x9] { L' ', L'.', L':', L'-', L'=', L'+', L'*', L'#', L'@' };
+    static bool const unicode = MB_CUR_MAX > 0x1;
+    static int const left_dots[0x5] { 0x0, 0x40, 0x44, 0x46, 0x47 };
+    static int const right_dots[0x5] { 0x0, 0x80, 0xA0, 0xB0, 0xB8 };
+
+    auto level = [&](std::size_t age, int steps) {
+        if (age >= count) return 0x0;
+        float value = std::clamp(newest_first[age], 0.0f, 100.0f);
+        return value > 0.0f ? std::max(static_cast<int>(std::lround(value / 100.0f * static_cast<float>(steps))), 0x1) : 0x0;
+    };
+
+    for (int cell = 0x0; cell < width; ++cell) {
+        auto age = static_cast<std::size_t>(width - 0x1 - cell);
+        if (tui::braille && unicode) {
+            int dots = left_dots[level(age * 0x2 + 0x1, 0x4)] | right_dots[level(age * 0x2, 0x4)];
+            out.put(row, col + cell, static_cast<wchar_t>(0x2800 + dots), A_NORMAL, 0x1);
+        } else {
+            out.put(row, col + cell, (unicode ? blocks : ascii)[level(age, 0x8)], A_NORMAL, 0x1);
+        }
+    }
 }
 
 /**
- * \brief Endless while loop for updating value and printing it to the screen
- *      Exits when user presses "CTRL+C" or whatever the binding is
+ * \brief Load spread across CPUs on one line, then the grid of per-CPU bars and sparklines below it
+ *      Works from buffers that only grow, so a frame allocates nothing once the terminal size is stable;
+ *      the cost is one sampler frame plus the visible history, independent of how the grid scrolls
+ * @param out Cell buffer
+ * @param row First row to use
  */
-[[noreturn]] auto tui::draw() -> void {
+auto tui::write_grid(screen_buffer & out, int row) -> void {
+    std::size_t cpus = sampler::cpus();
+    if (cpus == 0x0 || row >= out.rows() - 0x2) return;
+
+    tui::current.resize(cpus + 0x1);
+    tui::recent.resize(sampler::capacity);
+    tui::merged.resize(sampler::capacity);
+    if (!sampler::frame(tui::current.data(), tui::current.size())) return;
+
+    float low = 100.0f, high = 0.0f;
+    double sum = 0.0, squares = 0.0;
+    for (std::size_t cpu = 0x1; cpu <= cpus; ++cpu) {
+        float value = tui::current[cpu];
+        low = std::min(low, value);
+        high = std::max(high, value);
+        sum += value;
+        squares += static_cast<double>(value) * value;
+    }
+    double mean = sum / static_cast<double>(cpus);
+    double deviation = std::sqrt(std::max(squares / static_cast<double>(cpus) - mean * mean, 0.0));
+    out.printf(row, 0x3, A_NORMAL, 0x0, "%zu CPUs  min %.1f%%  max %.1f%%  mean %.1f%%  stdev %.1f", cpus,
+               static_cast<double>(low), static_cast<double>(high), mean, deviation);
+
+    core_grid grid = tui::layout(cpus, out.rows() - row - 0x2, out.cols() - 0x2, perf::init());
+    tui::scroll = grid.first_row;
+    tui::page = std::max(grid.rows, 0x1);
+    if (grid.total_rows > grid.rows) {
+        out.printf(row, out.cols() - 0x18, A_NORMAL, 0x0, "rows %d-%d of %d", grid.first_row + 0x1,
+                   grid.first_row + grid.rows, grid.total_rows);
+    }
+
+    std::size_t samples = static_cast<std::size_t>(grid.spark_width) * (tui::braille ? 0x2 : 0x1);
+    std::vector<perf_sample> const & counters = perf::cores();
+
+    for (int line = 0x0; line < grid.rows; ++line) {
+        for (int column = 0x0; column < grid.columns; ++column) {
+            std::size_t entry = static_cast<std::size_t>(column) * static_cast<std::size_t>(grid.total_rows)
+                                + static_cast<std::size_t>(grid.first_row + line);
+            if (entry >= grid.entries) continue;
+
+            std::size_t first = entry * grid.group;
+            std::size_t last = std::min(first + grid.group, cpus) - 0x1;
+            auto members = static_cast<float>(last - first + 0x1);
+
+            float value = 0.0f;
+            std::fill_n(tui::merged.begin(), samples, 0.0f);
+            std::size_t available = samples;
+            for (std::size_t cpu = first; cpu <= last; ++cpu) {
+                value += tui::current[cpu + 0x1] / members;
+                available = std::min(available, sampler::history(cpu + 0x1, tui::recent.data(), samples));
+                for (std::size_t i = 0x0; i < samples; ++i) tui::merged[i] += tui::recent[i] / members;
+            }
+
+            int y = row + 0x1 + line;
+            int x = 0x1 + column * grid.cell_width;
+            if (grid.group == 0x1) out.printf(y, x, A_NORMAL, 0x0, "%*zu", grid.label_width, first);
+            else out.printf(y, x, A_NORMAL, 0x0, "%zu-%zu", first, last);
+
+            short pair = value >= 80.0f ? 0x3 : value >= 50.0f ? 0x2 : 0x1;
+            x += grid.label_width + 0x1;
+            tui::progress_bar(out, y, x, grid.bar_width, value, pair);
+            x += grid.bar_width + 0x1;
+            tui::sparkline(out, y, x, grid.spark_width, tui::merged.data(), available);
+
+            if (grid.ipc_width && grid.group == 0x1) {
+                auto sample = std::find_if(counters.begin(), counters.end(), [first](perf_sample const & counter) {
+                    return counter.cpu == static_cast<int>(first);
+                });
+                if (sample != counters.end() && sample->valid) {
+                    out.printf(y, x + grid.spark_width + 0x1, A_NORMAL, 0x2, "%4.2f", sample->ipc());
+                }
+            }
+        }
+    }
+}
+
+auto tui::setup_colors() -> void {
     start_color();
-    int xMax;
-    [[maybe_unused]] int yMax;
-    getmaxyx(stdscr, yMax, xMax);
-    WINDOW * sys_win = newwin(0x11, xMax - 0x1, 0x0, 0x0);
     init_pair(0x1, COLOR_GREEN, COLOR_BLACK);
     init_pair(0x2, COLOR_YELLOW, COLOR_BLACK);
     init_pair(0x3, COLOR_RED, COLOR_BLACK);
+    keypad(stdscr, TRUE);
+    curs_set(0x0);
+}
+
+/**
+ * \brief Collectors with their own one second cadence: the temperature inputs and the counter groups,
+ *      whose IPC is only meaningful over a fixed interval
+ */
+auto tui::refresh_slow() -> void {
+    if (thermal::init()) thermal::refresh();
+    if (perf::init()) perf::refresh();
+    if (memory::init()) memory::refresh();
+    if (cgroup::init()) cgroup::refresh();
+}
+
+/**
+ * \brief Render loop: compose from snapshots, flush the changed cells, then wait for keys until the next frame
+ *      Sampling runs on the sampler thread, so the frame rate does not depend on it.
+ *      Keys: q quits, + and - change the frame rate; a resize repaints everything
+ * @param options Frame rate
+ */
+auto tui::draw(tui_options const & options) -> void {
+    tui::setup_colors();
+    sampler::start();
+
+    screen_buffer screen;
+    screen.resize(LINES, COLS);
+    int fps = std::clamp(options.fps, 0x1, 0x3C);
+    auto next_slow = std::chrono::steady_clock::now();
+
+    while (true) {
+        auto frame = std::chrono::steady_clock::now();
+        if (frame >= next_slow) {
+            tui::refresh_slow();
+            next_slow = frame + std::chrono::seconds(0x1);
+        }
+
+        screen.clear();
+        tui::write_console(screen);
+        screen.printf(screen.rows() - 0x1, 0x3, A_NORMAL, 0x0, "q quit  +/- frame rate (%d fps)  arrows/PgUp/PgDn scroll  "
+                      "c collapse %s  b braille %s", fps, tui::collapse ? "on" : "off", tui::braille ? "on" : "off");
+        screen.flush();
+
+        auto deadline = frame + std::chrono::microseconds(0xF4240 / fps);
+        while (true) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0x0) break;
+
+            timeout(static_cast<int>(remaining.count()));
+            int key = getch();
+            if (key == ERR) break;
+            if (key == 'q' || key == 'Q') return;
+            if (key == '+') fps = std::min(fps + 0x1, 0x3C);
+            if (key == '-') fps = std::max(fps - 0x1, 0x1);
+            if (key == 'c' || key == 'C') tui::collapse = !tui::collapse;
+            if (key == 'b' || key == 'B') tui::braille = !tui::braille;
+            if (key == KEY_UP) tui::scroll = std::max(tui::scroll - 0x1, 0x0);
+            if (key == KEY_DOWN) ++tui::scroll;
+            if (key == KEY_PPAGE) tui::scroll = std::max(tui::scroll - tui::page, 0x0);
+            if (key == KEY_NPAGE) tui::scroll += tui::page;
+            if (key == KEY_HOME) tui::scroll = 0x0;
+            if (key == KEY_RESIZE) {
+                clear();
+                screen.resize(LINES, COLS);
+                screen.invalidate();
+            }
+        }
+    }
+}
+
+/**
+ * \brief Scrubs through a recording: the aggregate bar and the per-CPU grid of one frame at a time
+ *      The grid is laid out like the live one, each sparkline holds the frames leading up to the current one.
+ *      Left/Right step one frame, [/] one minute of frames, Home/End jump to the ends; arrows and PgUp/PgDn
+ *      scroll the grid, c and b toggle collapsing and braille, q quits
+ * @param record Decoded ring file, see timeseries_file::load()
+ */
+auto tui::replay(recording const & record) -> void {
+    if (record.frames.empty()) return;
+    tui::setup_colors();
+
+    screen_buffer screen;
+    auto last = static_cast<long>(record.frames.size()) - 0x1;
+    long minute = std::max<long>(0xEA60 / std::max<std::uint32_t>(record.interval_ms, 0x1), 0x1);
+    long position = last;
 
     while (true) {
-        tui::write_console(sys_win);
-        wrefresh(sys_win);
-        refresh();
-        std::this_thread::sleep_for(std::chrono::seconds(0x1));
+        recorded_frame const & frame = record.frames[static_cast<std::size_t>(position)];
+        std::time_t seconds = frame.unix_ms / 0x3E8;
+        char stamp[0x40];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+
+        screen.resize(LINES, COLS);
+        screen.clear();
+        int col = screen.printf(0x0, 0x3, A_NORMAL, 0x2, "%s.%03lld  frame %ld/%ld", stamp,
+                                static_cast<long long>(frame.unix_ms % 0x3E8), position + 0x1, last + 0x1);
+        if (record.corrupt_blocks) screen.printf(0x0, 0x3 + col, A_NORMAL, 0x2, "  %zu damaged blocks skipped", record.corrupt_blocks);
+
+        screen.print(0x2, 0x3, "CPU", A_BOLD, 0x1);
+        tui::progress_bar(screen, 0x2, 0x8, std::min(0x34, screen.cols() - 0xA), frame.values.front(), 0x1);
+
+        std::size_t cpus = frame.values.size() - 0x1;
+        core_grid grid = tui::layout(cpus, screen.rows() - 0x6, screen.cols() - 0x2, false);
+        tui::scroll = grid.first_row;
+        tui::page = std::max(grid.rows, 0x1);
+        if (grid.total_rows > grid.rows) {
+            screen.printf(0x3, screen.cols() - 0x18, A_NORMAL, 0x0, "rows %d-%d of %d", grid.first_row + 0x1,
+                          grid.first_row + grid.rows, grid.total_rows);
+        }
+
+        std::size_t samples = static_cast<std::size_t>(grid.spark_width) * (tui::braille ? 0x2 : 0x1);
+        std::size_t available = std::min(samples, static_cast<std::size_t>(position) + 0x1);
+        tui::merged.resize(std::max(tui::merged.size(), samples));
+
+        for (int line = 0x0; line < grid.rows; ++line) {
+            for (int column = 0x0; column < grid.columns; ++column) {
+                std::size_t entry = static_cast<std::size_t>(column) * static_cast<std::size_t>(grid.total_rows)
+                                    + static_cast<std::size_t>(grid.first_row + line);
+                if (entry >= grid.entries) continue;
+
+                std::size_t first = entry * grid.group;
+                std::size_t end = std::min(first + grid.group, cpus);
+                auto members = static_cast<float>(end - first);
+
+                std::fill_n(tui::merged.begin(), samples, 0.0f);
+                for (std::size_t age = 0x0; age < available; ++age) {
+                    std::vector<float> const & values = record.frames[static_cast<std::size_t>(position) - age].values;
+                    for (std::size_t cpu = first; cpu < end && cpu + 0x1 < values.size(); ++cpu) {
+                        tui::merged[age] += values[cpu + 0x1] / members;
+                    }
+                }
+                float value = tui::merged[0x0];
+
+                int y = 0x4 + line;
+                int x = 0x1 + column * grid.cell_width;
+                if (grid.group == 0x1) screen.printf(y, x, A_NORMAL, 0x0, "%*zu", grid.label_width, first);
+                else screen.printf(y, x, A_NORMAL, 0x0, "%zu-%zu", first, end - 0x1);
+
+                short pair = value >= 80.0f ? 0x3 : value >= 50.0f ? 0x2 : 0x1;
+                x += grid.label_width + 0x1;
+                tui::progress_bar(screen, y, x, grid.bar_width, value, pair);
+                tui::sparkline(screen, y, x + grid.bar_width + 0x1, grid.spark_width, tui::merged.data(), available);
+            }
+        }
+
+        screen.printf(screen.rows() - 0x1, 0x3, A_NORMAL, 0x0, "q quit  Left/Right frame  [/] minute  Home/End ends  "
+                      "arrows/PgUp/PgDn scroll  c collapse %s  b braille %s", tui::collapse ? "on" : "off", tui::braille ? "on" : "off");
+        screen.flush();
+
+        int key = getch();
+        if (key == 'q' || key == 'Q') break;
+        if (key == KEY_LEFT) position -= 0x1;
+        if (key == KEY_RIGHT) position += 0x1;
+        if (key == ']') position += minute;
+        if (key == '[') position -= minute;
+        if (key == KEY_HOME) position = 0x0;
+        if (key == KEY_END) position = last;
+        if (key == 'c' || key == 'C') tui::collapse = !tui::collapse;
+        if (key == 'b' || key == 'B') tui::braille = !tui::braille;
+        if (key == KEY_UP) tui::scroll = std::max(tui::scroll - 0x1, 0x0);
+        if (key == KEY_DOWN) ++tui::scroll;
+        if (key == KEY_PPAGE) tui::scroll = std::max(tui::scroll - tui::page, 0x0);
+        if (key == KEY_NPAGE) tui::scroll += tui::page;
+        if (key == KEY_RESIZE) {
+            clear();
+            screen.invalidate();
+        }
+        position = std::clamp(position, 0x0L, last);
     }
 }
@@ -6,11 +6,65 @@
 #ifndef CUBE_TUI_HPP
 #define CUBE_TUI_HPP
 
+#include <chrono>
+#include <vector>
+#include <cstddef>
+
+#include "screen.hpp"
+
+struct recording;
+
+/**
+ * \brief Render loop settings
+ *      fps is the redraw rate, independent of the sampler interval; clamped to 1..60
+ */
+struct tui_options {
+    int fps { 0xA };
+};
+
+/**
+ * \brief Geometry of the per-CPU grid for one terminal size
+ *      Entries run down the columns; with collapsing, one entry stands for group consecutive CPUs.
+ *      total_rows can exceed rows, first_row is the scroll offset into it
+ */
+struct core_grid {
+    int columns { 0x1 };
+    int rows { 0x0 };
+    int total_rows { 0x0 };
+    int first_row { 0x0 };
+    int cell_width { 0x0 };
+    int label_width { 0x0 };
+    int bar_width { 0x0 };
+    int spark_width { 0x0 };
+    int ipc_width { 0x0 };
+    std::size_t group { 0x1 };
+    std::size_t entries { 0x0 };
+};
+
 class tui {
 public:
-    [[noreturn]] static auto draw() -> void;
-    static auto write_console(WINDOW * win) -> void;
-    static auto progress_bar(const std::string& percent) -> std::string;
+    static auto draw(tui_options const & options) -> void;
+    static auto replay(recording const & record) -> void;
+    static auto write_console(screen_buffer & out) -> void;
+    static auto write_counters(screen_buffer & out, int row) -> int;
+    static auto write_memory(screen_buffer & out, int row) -> int;
+    static auto write_cgroup(screen_buffer & out, int row) -> int;
+    static auto write_grid(screen_buffer & out, int row) -> void;
+    static auto layout(std::size_t cpus, int rows, int cols, bool ipc) -> core_grid;
+    static auto progress_bar(screen_buffer & out, int row, int col, int width, float percent, short pair) -> void;
+    static auto sparkline(screen_buffer & out, int row, int col, int width, float const * newest_first, std::size_t count) -> void;
+
+private:
+    static inline int scroll { 0x0 };
+    static inline int page { 0x1 };
+    static inline bool collapse { false };
+    static inline bool braille { false };
+    static inline std::vector<float> current;
+    static inline std::vector<float> recent;
+    static inline std::vector<float> merged;
+
+    static auto setup_colors() -> void;
+    static auto refresh_slow() -> void;
 };
 
 #endif //CUBE_TUI_HPP
@@ -4,24 +4,20 @@
  */
 
 #include <iostream>
-#include <fstream>
 #include <iomanip>
 
 #include "uptime.hpp"
+#include "procfs.hpp"
 #include "cpu.hpp"
 
 /**
  * \brief Prints the information about uptime by reading the "/proc/uptime" file
  */
 [[maybe_unused]] auto uptime::uptime_display() -> void {
-    std::ifstream uptime_file(UPTIME);
+    static proc_file uptime_file(UPTIME, 0x80);
     if (!uptime_file.is_open()) cpu::fatal_error("Error: Failed to open /proc/uptime");
 
-    std::string line;
-    std::getline(uptime_file, line);
-    std::istringstream iss(line);
-    std::uint64_t uptime_seconds;
-    iss >> uptime_seconds;
+    std::uint64_t uptime_seconds = proc_scanner(uptime_file.read()).next_u64();
 
     std::uint64_t hours = uptime_seconds / 3600;
     std::uint64_t minutes = (uptime_seconds / 60) % 60;